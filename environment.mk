@@ -1,6 +1,16 @@
 
 _REPO_ROOT           := $(shell git rev-parse --show-toplevel)
 
+# Native (x86) builds and runs (see fragments/native.mk) do not need
+# Bladerunner. If every goal on the command line is a native goal, set
+# BSG_NATIVE_ONLY and skip the checks (and fragments) that require it.
+_BSG_NATIVE_GOALS    := native native.clean %.native %.native.log %.native.o %.so
+ifneq ($(MAKECMDGOALS),)
+ifeq ($(filter-out $(_BSG_NATIVE_GOALS),$(MAKECMDGOALS)),)
+BSG_NATIVE_ONLY      := 1
+endif
+endif
+
 # Check if we are running the gloablly installed COSIM ob brg-vip
 ifdef BRG_BSG_BLADERUNNER_DIR
 -include $(BRG_BSG_BLADERUNNER_DIR)/project.mk
@@ -54,6 +64,7 @@ endif # Matches: ifdef _BSG_MANYCORE_DIR
 undefine _BSG_MANYCORE_DIR
 endif # Matches: ifneq ("$(wildcard $(CL_DIR)/../project.mk)","")
 
+ifndef BSG_NATIVE_ONLY
 # If BASEJUMP_STL_DIR is not defined at this point, raise an error.
 ifndef BASEJUMP_STL_DIR
 $(error $(shell echo -e "$(RED)BSG MAKE ERROR: BASEJUMP_STL_DIR environment variable undefined. Defining is not recommended. Are you running from within Bladerunner?$(NC)"))
@@ -63,6 +74,7 @@ endif
 ifndef BSG_MANYCORE_DIR
 $(error $(shell echo -e "$(RED)BSG MAKE ERROR: BSG_MANYCORE_DIR environment variable undefined. Defining is not recommended. Are you running from within Bladerunner?$(NC)"))
 endif
+endif # Matches: ifndef BSG_NATIVE_ONLY
 
 # TODO: Check if exists
 RISCV_BIN_DIR=$(BSG_MANYCORE_DIR)/software/riscv-tools/riscv-install/bin/
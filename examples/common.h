@@ -32,6 +32,8 @@
 
 #include <cstdlib>
 #include <cstdio>
+#include <cstdint>
+#include <cstring>
 #include <cstdbool>
 #include <cfloat>
 
@@ -40,6 +42,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdint.h>
+#include <string.h>
 #include <stdbool.h>
 #include <float.h>
 
@@ -75,6 +78,16 @@
 #define bsg_pr_test_pass_fail(success_condition)                        \
         printf("BSG REGRESSION TEST %s\n", ((success_condition) ? BSG_GREEN("PASSED") : BSG_RED("FAILED")))
 
+/*
+ * The size of DMEM on each tile, and how much of it a kernel may fill
+ * with data staged from DRAM. The rest is left for the stack and the
+ * kernel's globals. Hosts reject problem sizes whose staged data does
+ * not fit, since the native backend's large stacks would hide the
+ * overrun.
+ */
+#define BSG_TILE_DMEM_BYTES 4096
+#define BSG_TILE_DMEM_DATA_BYTES 3072
+
 #ifdef __cplusplus
 extern "C" {
 void cosim_main(uint32_t *exit_code, char * args);
@@ -145,6 +158,38 @@ struct arguments_path{
         char *name; // Name of Test to Run
 };
 
+/*
+  arguments_size: Runtime problem-size options. These are accepted in addition
+  to the <Path> and <Name> arguments of argp_path, so that one host executable
+  can be run across a range of problem sizes. Each host fills in its defaults
+  before calling argp_parse, and only uses the fields that apply to it:
+
+    --size=N   Problem size. Sets the length of 1-D problems and M, N and K
+               of 2-D problems (Later --m/--n/--k override it).
+    --m=M, --n=N, --k=K
+               Matrix dimensions: (M x K) * (K x N) = (M x N).
+    --iters=I  Number of timed iterations (where the kernel supports them).
+    --filter=F Filter length (convolutions).
+    --stride=S Filter stride (convolutions).
+    --batch=B, --cin=C, --cout=K
+               Batch size, and input and output channels (convolutions).
+    --seed=S   Seed for the random input data.
+*/
+struct arguments_size{
+        struct arguments_path path;
+        uint32_t size;
+        uint32_t m;
+        uint32_t n;
+        uint32_t k;
+        uint32_t iters;
+        uint32_t filter;
+        uint32_t stride;
+        uint32_t batch;
+        uint32_t cin;
+        uint32_t cout;
+        uint32_t seed;
+};
+
 /*
   args_doc: A description of the non-option command-line arguments that we
   accept.
@@ -166,6 +211,34 @@ static struct argp_option opts_path_py[] = {
         {0}};
 static struct argp_option opts_none[] = {{0}};
 
+// Keys for long-only options (i.e. not printable characters)
+enum {
+        ARGP_KEY_SIZE = 0x1000,
+        ARGP_KEY_M,
+        ARGP_KEY_N,
+        ARGP_KEY_K,
+        ARGP_KEY_ITERS,
+        ARGP_KEY_FILTER,
+        ARGP_KEY_STRIDE,
+        ARGP_KEY_BATCH,
+        ARGP_KEY_CIN,
+        ARGP_KEY_COUT,
+        ARGP_KEY_SEED,
+};
+static struct argp_option opts_size[] = {
+        {"size", ARGP_KEY_SIZE, "N", 0, "Problem size (Sets M, N and K)"},
+        {"m", ARGP_KEY_M, "M", 0, "Rows of A and C"},
+        {"n", ARGP_KEY_N, "N", 0, "Columns of B and C"},
+        {"k", ARGP_KEY_K, "K", 0, "Columns of A, rows of B"},
+        {"iters", ARGP_KEY_ITERS, "I", 0, "Number of timed iterations"},
+        {"filter", ARGP_KEY_FILTER, "F", 0, "Filter length"},
+        {"stride", ARGP_KEY_STRIDE, "S", 0, "Filter stride"},
+        {"batch", ARGP_KEY_BATCH, "B", 0, "Batch size"},
+        {"cin", ARGP_KEY_CIN, "C", 0, "Input channels"},
+        {"cout", ARGP_KEY_COUT, "K", 0, "Output channels"},
+        {"seed", ARGP_KEY_SEED, "S", 0, "Random number generator seed"},
+        {0}};
+
 static error_t parse_name (int key, char *arg, struct argp_state *state){
         struct arguments_name *args = (struct arguments_name *)state->input;
  
@@ -238,6 +311,65 @@ static error_t parse_path_py (int key, char *arg, struct argp_state *state){
         return parse_path(key, arg, state);
 }
 
+// Parse a positive 32-bit option value, or exit with a usage error
+static uint32_t parse_uint32 (const char *arg, struct argp_state *state){
+        char *end;
+        unsigned long long v = strtoull(arg, &end, 0);
+        if (*arg == '-' || *end != '\0' || v == 0 || v > UINT32_MAX)
+                argp_error(state, "Invalid value: %s", arg);
+        return (uint32_t) v;
+}
+
+static error_t parse_size (int key, char *arg, struct argp_state *state){
+        struct arguments_size *args = (struct arguments_size *)state->input;
+
+        switch (key)
+                {
+                case ARGP_KEY_INIT:
+                        // argp_path parses <Path> and <Name> into args->path
+                        state->child_inputs[0] = &args->path;
+                        break;
+                case ARGP_KEY_SIZE:
+                        args->size = parse_uint32(arg, state);
+                        args->m = args->n = args->k = args->size;
+                        break;
+                case ARGP_KEY_M:
+                        args->m = parse_uint32(arg, state);
+                        break;
+                case ARGP_KEY_N:
+                        args->n = parse_uint32(arg, state);
+                        break;
+                case ARGP_KEY_K:
+                        args->k = parse_uint32(arg, state);
+                        break;
+                case ARGP_KEY_ITERS:
+                        args->iters = parse_uint32(arg, state);
+                        break;
+                case ARGP_KEY_FILTER:
+                        args->filter = parse_uint32(arg, state);
+                        break;
+                case ARGP_KEY_STRIDE:
+                        args->stride = parse_uint32(arg, state);
+                        break;
+                case ARGP_KEY_BATCH:
+                        args->batch = parse_uint32(arg, state);
+                        break;
+                case ARGP_KEY_CIN:
+                        args->cin = parse_uint32(arg, state);
+                        break;
+                case ARGP_KEY_COUT:
+                        args->cout = parse_uint32(arg, state);
+                        break;
+                case ARGP_KEY_SEED:
+                        // 0 is a valid seed
+                        args->seed = strcmp(arg, "0") ? parse_uint32(arg, state) : 0;
+                        break;
+                default:
+                        return ARGP_ERR_UNKNOWN;
+                }
+        return 0;
+}
+
 static error_t parse_none (int key, char *arg, struct argp_state *state){
  
         switch (key) 
@@ -252,9 +384,14 @@ static error_t parse_none (int key, char *arg, struct argp_state *state){
         return 0;
 }
 
-static struct argp argp_name = {opts_name, parse_name, desc_name, doc};
-static struct argp argp_path = {opts_path, parse_path, desc_path, doc};
-static struct argp argp_path_py = {opts_path_py, parse_path_py, desc_path_py, doc};
-static struct argp argp_none = {opts_none, parse_none, desc_none, doc};
+static struct argp argp_name __attribute__((unused)) = {opts_name, parse_name, desc_name, doc};
+static struct argp argp_path __attribute__((unused)) = {opts_path, parse_path, desc_path, doc};
+static struct argp argp_path_py __attribute__((unused)) = {opts_path_py, parse_path_py, desc_path_py, doc};
+static struct argp argp_none __attribute__((unused)) = {opts_none, parse_none, desc_none, doc};
+
+static struct argp_child children_size[] = {
+        {&argp_path, 0, 0, 0},
+        {0}};
+static struct argp argp_size __attribute__((unused)) = {opts_size, parse_size, 0, doc, children_size};
 
 #endif
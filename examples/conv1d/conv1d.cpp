@@ -27,26 +27,15 @@
 
 #include "conv1d.hpp"
 
+// Default filter length (--filter)
 #define C_F_LENGTH 4
-#define C_A_LENGTH 128
+// Default input vector length (--size)
+#define DEFAULT_A_LENGTH 128
 #define C_PAD_LENGTH 8
+// Default stride (--stride)
 #define C_STEP_LENGTH 2
-
-// Compute the sum of squared error between matricies A and B (M x N)
-template <typename T>
-double matrix_sse (const T *A, const T *B, uint64_t M, uint64_t N) {
-        double sum = 0;
-        for (uint64_t y = 0; y < M; y ++) {
-                for (uint64_t x = 0; x < N; x ++) {
-                        T diff = A[y * N + x] - B[y * N + x];
-                        if(std::isnan(diff)){
-                                return diff;
-                        }
-                        sum += diff * diff;
-                }
-        }
-        return sum;
-}
+// Outputs computed by each tile group. The grid grows with the size.
+#define BLOCK_SIZE 1024
 
 uint32_t compute_M(uint32_t N, uint32_t F, uint32_t P, uint32_t S)
 {
@@ -80,12 +69,16 @@ void conv1d(const TA *A, const uint32_t A_LENGTH,
 
 int kernel_conv1d(int argc, char **argv)
 {       
-        bsg_pr_test_info("Running CUDA Conv1D Kernel on a 2x2 tile group.\n\n");
+        bsg_pr_test_info("Running CUDA Conv1D Kernel on a grid of 2x2 tile groups.\n\n");
         char *elf, *test_name;
-        struct arguments_path args = { NULL, NULL };
-        argp_parse(&argp_path, argc, argv, 0, 0, &args);
-        elf = args.path;
-        test_name = args.name;
+        struct arguments_size args = {{NULL, NULL}};
+        args.size = DEFAULT_A_LENGTH;
+        args.filter = C_F_LENGTH;
+        args.stride = C_STEP_LENGTH;
+        args.seed = 42;
+        argp_parse(&argp_size, argc, argv, 0, 0, &args);
+        elf = args.path.path;
+        test_name = args.path.name;
 
         int rc;
         hb_mc_device_t manycore, *mc = &manycore;
@@ -103,65 +96,90 @@ int kernel_conv1d(int argc, char **argv)
                 return rc;
         }
 
-        // Initialize the random number generators
+        // Initialize the random number generators (one stream per input)
         std::numeric_limits<int8_t> lim_int8; // Used to get INT_MIN and INT_MAX in C++
-        std::numeric_limits<uint32_t> lim_uint32; // Used to get INT_MIN and INT_MAX in C++
-        std::default_random_engine generator;
-        generator.seed(42);
-        std::uniform_real_distribution<float> data_distribution(lim_int8.min(),lim_int8.max());
-        std::uniform_real_distribution<float> filter_distribution(lim_int8.min(),lim_int8.max());
+        host_random data_random(args.seed, 0), filter_random(args.seed, 1);
         
         // N: Number of elements in the 1-D input vector, A
-        uint32_t N = C_A_LENGTH;
+        uint32_t N = args.size;
         // F: Number of filter coefficients in 1-D filter, F
-        uint32_t F = C_F_LENGTH;
+        uint32_t F = args.filter;
         // P: Padding (symmetric, number of elements on both side of the input)
         uint32_t P = C_PAD_LENGTH;
         // S: Step size of convolution
-        uint32_t S = C_STEP_LENGTH;
+        uint32_t S = args.stride;
+        if (F > N + 2 * P) {
+                bsg_pr_test_err("The filter must be no longer than the padded input.\n");
+                return HB_MC_INVALID;
+        }
         uint32_t M = compute_M(N, F, P, S);
         
         size_t A_size = sizeof(float) * N;
         size_t F_size = sizeof(float) * F;
         size_t B_size = sizeof(float) * M;
         
-        float A_host[N];
-        float filter_host[F];
-        float B_expected[M], B_result[M];
+        host_buffer<float> A_host(N);
+        host_buffer<float> filter_host(F);
+        host_buffer<float> B_expected(M), B_result(M);
+
+        // Reserve device memory for A, F and B, and allocate them from it
+        device_arena arena(mc);
+        rc = arena.init(device_arena::footprint({A_size, F_size, B_size}));
+        if(rc != HB_MC_SUCCESS)
+        {
+                bsg_pr_test_err("Failed to reserve device memory.\n");
+                return rc;
+        }
 
         eva_t A_device, B_device, filter_device;
-        rc = hb_mc_device_malloc(mc, A_size, &A_device);
+        rc = arena.alloc(A_size, &A_device);
         if(rc != HB_MC_SUCCESS)
         {
                 bsg_pr_test_err("Failed to allocate A on the manycore.\n");
                 return rc;
         }
 
-        rc = hb_mc_device_malloc(mc, F_size, &filter_device);
+        rc = arena.alloc(F_size, &filter_device);
         if(rc != HB_MC_SUCCESS)
         {
                 bsg_pr_test_err("Failed to allocate F on the manycore.\n");
                 return rc;
         }
         
-        rc = hb_mc_device_malloc(mc, B_size, &B_device);
+        rc = arena.alloc(B_size, &B_device);
         if(rc != HB_MC_SUCCESS)
         {
                 bsg_pr_test_err("Failed to allocate B on the manycore.\n");
                 return rc;
         }
 
-        for(int i = 0; i < sizeof(A_host) / sizeof(A_host[0]); i++)
+        // Load A, the filter and the known-correct result B from the
+        // dataset cache, or generate them.
+        host_dataset cache("conv1d", "float", {N, F, P, S}, args.seed);
+        if (!cache.load({{"A", A_host.data(), A_size},
+                         {"F", filter_host.data(), F_size},
+                         {"B", B_expected.data(), B_size}})) {
+                data_random.uniform(A_host.data(), A_host.size(),
+                                    (float) lim_int8.min(), (float) lim_int8.max());
+                filter_random.uniform(filter_host.data(), filter_host.size(),
+                                      (float) lim_int8.min(), (float) lim_int8.max());
+
+                conv1d(A_host.data(), N, filter_host.data(), F, P, S, B_expected.data());
+
+                cache.store({{"A", A_host.data(), A_size},
+                             {"F", filter_host.data(), F_size},
+                             {"B", B_expected.data(), B_size}});
+        }
+
+        for(size_t i = 0; i < A_host.size(); i++)
         {
-                A_host[i] = data_distribution(generator);
-                bsg_pr_test_info("A_host[%d] = %.9f \n",
+                bsg_pr_test_info("A_host[%zu] = %.9f \n",
                                  i, A_host[i]);
         }
 
-        for(int i = 0; i < sizeof(filter_host) / sizeof(filter_host[0]); i++)
+        for(size_t i = 0; i < filter_host.size(); i++)
         {
-                filter_host[i] = filter_distribution(generator);
-                bsg_pr_test_info("filter_host[%d] = %.9f \n",
+                bsg_pr_test_info("filter_host[%zu] = %.9f \n",
                                  i, filter_host[i]);
         }
         
@@ -184,14 +202,37 @@ int kernel_conv1d(int argc, char **argv)
                 return rc;
         }
 
-        uint32_t block_size = M;
+        // v1 stages the filter and the input window of each chunk of
+        // outputs in DMEM buffers, which are sized for filters of up
+        // to 16 elements and strides of up to 2.
+        if ((!strcmp("v1", test_name) || !strcmp("v2", test_name)) && (F > 16 || S > 2)) {
+                bsg_pr_test_err("%s requires a filter of at most 16 elements and a stride of at most 2.\n",
+                                test_name);
+                return HB_MC_INVALID;
+        }
+
+        // v2 has a kernel specialized for each common filter length,
+        // and falls back to kernel_conv1d for the others.
+        const char *kernel_name = "kernel_conv1d";
+        if (!strcmp("v2", test_name)) {
+                switch (F) {
+                case 3: kernel_name = "kernel_conv1d_f3"; break;
+                case 5: kernel_name = "kernel_conv1d_f5"; break;
+                case 7: kernel_name = "kernel_conv1d_f7"; break;
+                case 9: kernel_name = "kernel_conv1d_f9"; break;
+                default: break;
+                }
+        }
+        bsg_pr_test_info("Filter length %u: running %s\n", F, kernel_name);
+
+        uint32_t block_size = BLOCK_SIZE;
 
         hb_mc_dimension_t tilegroup_dim = { .x = 2, .y = 2 };
-        hb_mc_dimension_t grid_dim = { .x = 1, .y = 1 };
+        hb_mc_dimension_t grid_dim = { .x = (M + block_size - 1) / block_size, .y = 1 };
 
         uint32_t cuda_argv[] = { A_device, N, filter_device, F, P, B_device, S, block_size };
         size_t cuda_argc = sizeof(cuda_argv) / sizeof(cuda_argv[0]);
-        rc = hb_mc_kernel_enqueue(mc, grid_dim, tilegroup_dim, "kernel_conv1d", cuda_argc, cuda_argv);
+        rc = hb_mc_kernel_enqueue(mc, grid_dim, tilegroup_dim, kernel_name, cuda_argc, cuda_argv);
         if(rc != HB_MC_SUCCESS)
         {
                 bsg_pr_test_err("Failed to initialize grid.\n");
@@ -205,7 +246,7 @@ int kernel_conv1d(int argc, char **argv)
                 return rc;
         }
 
-        rc = hb_mc_device_memcpy(mc, (void *) B_result, 
+        rc = hb_mc_device_memcpy(mc, (void *) B_result.data(), 
                                  (void *) ((intptr_t) B_device), 
                                  B_size, HB_MC_MEMCPY_TO_HOST);
         if(rc != HB_MC_SUCCESS)
@@ -221,18 +262,12 @@ int kernel_conv1d(int argc, char **argv)
                 return rc;
         }
 
-        conv1d(A_host, N, filter_host, F, P, S, B_expected);
-
-        float sse;
-        sse = matrix_sse(B_expected, B_result, 1, M);
-
-        if(std::isnan(sse) || sse > .01)
-        {
-                bsg_pr_test_err(BSG_RED("Result mismatch! SSE: %f\n"), sse);
-                return HB_MC_FAIL;
-        }
-        bsg_pr_test_info(BSG_GREEN("Result match! (SSE: %f)\n"), sse);
-        return HB_MC_SUCCESS;
+        // Each output is a sum of F products of magnitude at most
+        // lim_int8.min() squared, which the kernels sum in a different
+        // order than the host (and may contract into FMAs).
+        double mag = (double) F * lim_int8.min() * lim_int8.min();
+        return verify_result("B", B_expected.data(), B_result.data(), 1, M,
+                             host_verify_sum_tolerance<float>(F, mag));
 }
 
 #ifdef COSIM
@@ -35,11 +35,15 @@
 #include <cstdlib>
 #include <cstdio>
 #include <cmath>
-#include <random>
 #include <limits>
 #include <bsg_manycore_errno.h>
 #include <bsg_manycore_cuda.h>
 
 #include "../common.h"
+#include "../host_buffer.hpp"
+#include "../device_arena.hpp"
+#include "../host_verify.hpp"
+#include "../host_random.hpp"
+#include "../host_dataset.hpp"
 
 #endif
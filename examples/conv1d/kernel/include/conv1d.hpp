@@ -0,0 +1,141 @@
+#ifndef __CONV1D_HPP
+#define __CONV1D_HPP
+#include <bsg_memcpy.hpp>
+#include <cstdint>
+#include <algorithm>
+
+/*
+ * Helpers for the 1D convolution kernels. A is a vector of N elements,
+ * the filter has F elements, P is the (symmetric) padding, and S is the
+ * stride.
+ */
+
+// Outputs per chunk
+#define CONV1D_CHUNK 128
+
+// The largest filter and stride supported. The DMEM buffers are sized
+// for them.
+#define CONV1D_MAX_F 16
+#define CONV1D_MAX_S 2
+
+// Elements of the input window of a chunk
+#define CONV1D_WINDOW ((CONV1D_CHUNK - 1) * CONV1D_MAX_S + CONV1D_MAX_F)
+
+// The inner loop of tile_conv1d v7: computes B_len outputs of an
+// unpadded convolution of A, four at a time. The last iteration
+// computes the remaining 1 - 3 outputs by entering the switch
+// statements part way through.
+int conv1d_float_manual(const float *A,
+                        const uint32_t /* A_len */,
+                        const float *F,
+                        const uint8_t F_len,
+                        const uint8_t stride,
+                        float *B,
+                        const uint32_t B_len)
+{
+        uint32_t step = stride << 2;
+
+        register float sum0, sum1, sum2, sum3;
+        register float a0, a1, a2, a3;
+        uint32_t ii = 0;
+        uint32_t oi = 0;
+
+        while(oi < B_len)
+        {
+                // 0 computes four outputs, 3 - 1 compute that many
+                register uint32_t to_compute = B_len - oi < 4 ? B_len - oi : 0;
+#ifdef __riscv
+                asm ("fmv.s.x %0,zero\n\t"
+                     "fmv.s.x %1,zero\n\t"
+                     "fmv.s.x %2,zero\n\t"
+                     "fmv.s.x %3,zero\n\t"
+                     : "=f" (sum0),
+                       "=f" (sum1),
+                       "=f" (sum2),
+                       "=f" (sum3));
+#else
+                sum0 = 0.0f;
+                sum1 = 0.0f;
+                sum2 = 0.0f;
+                sum3 = 0.0f;
+#endif
+                for(uint32_t fi = 0; fi < F_len; fi++)
+                {
+                        float f = F[fi];
+                        uint32_t stride_offset = 0;
+                        switch(to_compute)
+                        {
+                        case 0:
+                                a0 = A[ii + fi];
+                                stride_offset += stride;
+                                // fall through
+                        case 3:
+                                a1 = A[ii + fi + stride_offset];
+                                stride_offset += stride;
+                                // fall through
+                        case 2:
+                                a2 = A[ii + fi + stride_offset];
+                                stride_offset += stride;
+                                // fall through
+                        case 1:
+                                a3 = A[ii + fi + stride_offset];
+                                stride_offset += stride;
+                                // fall through
+                        default:
+                                break;
+                        }
+
+                        switch(to_compute)
+                        {
+                        case 0:
+                                sum0 += f * a0;
+                                // fall through
+                        case 3:
+                                sum1 += f * a1;
+                                // fall through
+                        case 2:
+                                sum2 += f * a2;
+                                // fall through
+                        case 1:
+                                sum3 += f * a3;
+                                // fall through
+                        default:
+                                break;
+                        }
+                }
+                switch(to_compute)
+                {
+                case 0:
+                        B[oi++] = sum0;
+                        // fall through
+                case 3:
+                        B[oi++] = sum1;
+                        // fall through
+                case 2:
+                        B[oi++] = sum2;
+                        // fall through
+                case 1:
+                        B[oi++] = sum3;
+                        // fall through
+                default:
+                        break;
+                }
+                ii += step;
+        }
+        return 0;
+}
+
+// Copy elements [a, a + n) of A (N elements) into window. Elements
+// outside of A are zero (padding).
+void window_load(float *window, const float *A, int N, int a, int n)
+{
+        // The elements of the window that are inside of A
+        int lo = std::min(std::max(-a, 0), n);
+        int hi = std::max(std::min(N - a, n), lo);
+
+        std::fill(window, window + lo, 0.0f);
+        bsg_memcpy_dram_to_dmem(&window[lo], &A[a + lo], (hi - lo) * sizeof(float));
+        std::fill(window + hi, window + n, 0.0f);
+}
+
+#endif //__CONV1D_HPP
@@ -6,12 +6,13 @@
 // before bsg_manycore.h and bsg_tile_group_barrier.h are
 // included. bsg_tiles_X and bsg_tiles_Y must also be defined for
 // legacy reasons, but they are deprecated.
-#define BSG_TILE_GROUP_X_DIM 1
-#define BSG_TILE_GROUP_Y_DIM 1
+#define BSG_TILE_GROUP_X_DIM 2
+#define BSG_TILE_GROUP_Y_DIM 2
 #define bsg_tiles_X BSG_TILE_GROUP_X_DIM
 #define bsg_tiles_Y BSG_TILE_GROUP_Y_DIM
 #include <bsg_manycore.h>
 #include <bsg_tile_group_barrier.h>
+#include <algorithm>
 
 INIT_TILE_GROUP_BARRIER(r_barrier, c_barrier, 0, bsg_tiles_X - 1, 0, bsg_tiles_Y - 1);
 
@@ -35,10 +36,12 @@ extern "C" {
                   Since each index in the output vector is independent from the other indices, the tiles
                   step through their assigned indices, computung the result.
                 */
+                bsg_cuda_print_stat_kernel_start();
+
                 const int tile_group_idx = __bsg_grid_dim_x * __bsg_tile_group_id_y + __bsg_tile_group_id_x;
                 const int start = tile_group_idx * block_size;
-                const int end = start + block_size;
                 const int M = 1 + (N - F + 2 * P) / S;
+                const int end = std::min(start + block_size, M);
                 const int num_cores = bsg_tiles_X * bsg_tiles_Y;
                 for(int i = start + __bsg_id; i < end; i += num_cores)
                         {
@@ -56,6 +59,8 @@ extern "C" {
                                 B[i] = res;
                         }
                 bsg_tile_group_barrier(&r_barrier, &c_barrier);
+
+                bsg_cuda_print_stat_kernel_end();
                 return 0;
         }
 
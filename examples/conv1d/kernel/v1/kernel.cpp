@@ -0,0 +1,86 @@
+// Takes a vector A of length N and a 1D filter of size F, padding
+// size P, and stride S.  Performs 1D convolution of A with the filter
+// and stores the result in B of size M = 1 + (N - F + 2P) / S.
+//
+// Each tile computes a contiguous slice of its tile group's block of
+// outputs, CONV1D_CHUNK outputs at a time: it copies the input window
+// of the chunk (the chunk plus its halo) into DMEM, with the zero
+// padding written out, and runs the 4-way register-blocked inner loop
+// of tile_conv1d (v7) on it.
+
+// BSG_TILE_GROUP_X_DIM and BSG_TILE_GROUP_Y_DIM must be defined
+// before bsg_manycore.h and bsg_tile_group_barrier.h are
+// included. bsg_tiles_X and bsg_tiles_Y must also be defined for
+// legacy reasons, but they are deprecated.
+#define BSG_TILE_GROUP_X_DIM 2
+#define BSG_TILE_GROUP_Y_DIM 2
+#define bsg_tiles_X BSG_TILE_GROUP_X_DIM
+#define bsg_tiles_Y BSG_TILE_GROUP_Y_DIM
+#include <bsg_manycore.h>
+#include <bsg_tile_group_barrier.h>
+#include <cstdint>
+#include <algorithm>
+
+INIT_TILE_GROUP_BARRIER(r_barrier, c_barrier, 0, bsg_tiles_X - 1, 0, bsg_tiles_Y - 1);
+
+#include <conv1d.hpp>
+
+extern "C" {
+        __attribute__((noinline))
+        int kernel_conv1d(const float *A,
+                          const int N,
+                          const float *filter,
+                          const int F,
+                          const int P,
+                          float *B,
+                          const int S,
+                          const int block_size)
+        {
+                float filter_local[CONV1D_MAX_F];
+                float window[CONV1D_WINDOW];
+                float output[CONV1D_CHUNK];
+
+                // The DMEM buffers are only large enough for
+                // CONV1D_MAX_F and CONV1D_MAX_S
+                if (F > CONV1D_MAX_F || S > CONV1D_MAX_S) {
+                        bsg_print_hexadecimal(0xC0DEC1D1);
+                        bsg_tile_group_barrier(&r_barrier, &c_barrier);
+                        return -1;
+                }
+
+                bsg_cuda_print_stat_kernel_start();
+
+                bsg_memcpy_dram_to_dmem(filter_local, filter, F * sizeof(float));
+
+                // The block of outputs of this tile group, as in v0,
+                // and the contiguous slice of it computed by this tile
+                const int tile_group_idx = __bsg_grid_dim_x * __bsg_tile_group_id_y + __bsg_tile_group_id_x;
+                const int M = 1 + (N - F + 2 * P) / S;
+                const int num_cores = bsg_tiles_X * bsg_tiles_Y;
+                const int start = std::min(tile_group_idx * block_size, M);
+                const int end = std::min(start + block_size, M);
+                const int slice = (end - start + num_cores - 1) / num_cores;
+                const int tile_start = std::min(start + __bsg_id * slice, end);
+                const int tile_end = std::min(tile_start + slice, end);
+
+                for(int i = tile_start; i < tile_end; i += CONV1D_CHUNK)
+                        {
+                                int n = std::min(CONV1D_CHUNK, tile_end - i);
+
+                                // Stage the input window of this chunk
+                                window_load(window, A, N, i * S - P, (n - 1) * S + F);
+
+                                conv1d_float_manual(window, (n - 1) * S + F,
+                                                    filter_local, F, S,
+                                                    output, n);
+
+                                bsg_memcpy_dmem_to_dram(&B[i], output, n * sizeof(float));
+                        }
+
+                bsg_tile_group_barrier(&r_barrier, &c_barrier);
+
+                bsg_cuda_print_stat_kernel_end();
+                return 0;
+        }
+
+}
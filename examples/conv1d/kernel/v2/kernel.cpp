@@ -0,0 +1,223 @@
+// Takes a vector A of length N and a 1D filter of size F, padding
+// size P, and stride S.  Performs 1D convolution of A with the filter
+// and stores the result in B of size M = 1 + (N - F + 2P) / S.
+//
+// This is v1, with one kernel per common filter length
+// (kernel_conv1d_f3, _f5, _f7 and _f9). In these, the filter length
+// is a constant, the inner loop is fully unrolled, and the filter is
+// held in FP registers while a chunk of outputs is computed. The host
+// falls back to kernel_conv1d (the inner loop of v1) for other filter
+// lengths.
+
+// BSG_TILE_GROUP_X_DIM and BSG_TILE_GROUP_Y_DIM must be defined
+// before bsg_manycore.h and bsg_tile_group_barrier.h are
+// included. bsg_tiles_X and bsg_tiles_Y must also be defined for
+// legacy reasons, but they are deprecated.
+#define BSG_TILE_GROUP_X_DIM 2
+#define BSG_TILE_GROUP_Y_DIM 2
+#define bsg_tiles_X BSG_TILE_GROUP_X_DIM
+#define bsg_tiles_Y BSG_TILE_GROUP_Y_DIM
+#include <bsg_manycore.h>
+#include <bsg_tile_group_barrier.h>
+#include <cstdint>
+#include <algorithm>
+
+INIT_TILE_GROUP_BARRIER(r_barrier, c_barrier, 0, bsg_tiles_X - 1, 0, bsg_tiles_Y - 1);
+
+#include <conv1d.hpp>
+
+// The inner loop of conv1d_float_manual, for a filter of F_LEN
+// elements: computes B_len outputs of an unpadded convolution of A,
+// four at a time. The filter is loaded into FP registers once.
+template <uint32_t F_LEN>
+int conv1d_float_fixed(const float *A,
+                       const float *F,
+                       const uint32_t stride,
+                       float *B,
+                       const uint32_t B_len)
+{
+        float f[F_LEN];
+#pragma GCC unroll 16
+        for(uint32_t fi = 0; fi < F_LEN; fi++)
+                f[fi] = F[fi];
+
+        const uint32_t step = stride << 2;
+        uint32_t ii = 0;
+        uint32_t oi = 0;
+
+        for(; oi + 4 <= B_len; oi += 4, ii += step)
+        {
+                const float *a0 = &A[ii];
+                const float *a1 = a0 + stride;
+                const float *a2 = a1 + stride;
+                const float *a3 = a2 + stride;
+                float sum0 = f[0] * a0[0];
+                float sum1 = f[0] * a1[0];
+                float sum2 = f[0] * a2[0];
+                float sum3 = f[0] * a3[0];
+#pragma GCC unroll 16
+                for(uint32_t fi = 1; fi < F_LEN; fi++)
+                {
+                        sum0 += f[fi] * a0[fi];
+                        sum1 += f[fi] * a1[fi];
+                        sum2 += f[fi] * a2[fi];
+                        sum3 += f[fi] * a3[fi];
+                }
+                B[oi + 0] = sum0;
+                B[oi + 1] = sum1;
+                B[oi + 2] = sum2;
+                B[oi + 3] = sum3;
+        }
+
+        // The remaining 1 - 3 outputs
+        for(; oi < B_len; oi++, ii += stride)
+        {
+                float sum = f[0] * A[ii];
+#pragma GCC unroll 16
+                for(uint32_t fi = 1; fi < F_LEN; fi++)
+                        sum += f[fi] * A[ii + fi];
+                B[oi] = sum;
+        }
+        return 0;
+}
+
+// Compute n outputs from window with the inner loop for F_LEN, or with
+// conv1d_float_manual for any filter length (F_LEN = 0)
+template <uint32_t F_LEN>
+int conv1d_chunk(const float *window, const float *filter, int /* F */, int S,
+                 float *output, int n)
+{
+        return conv1d_float_fixed<F_LEN>(window, filter, S, output, n);
+}
+
+template <>
+int conv1d_chunk<0>(const float *window, const float *filter, int F, int S,
+                    float *output, int n)
+{
+        return conv1d_float_manual(window, (n - 1) * S + F, filter, F, S, output, n);
+}
+
+template <uint32_t F_LEN>
+int conv1d(const float *A,
+           const int N,
+           const float *filter,
+           const int F,
+           const int P,
+           float *B,
+           const int S,
+           const int block_size)
+{
+        float filter_local[CONV1D_MAX_F];
+        float window[CONV1D_WINDOW];
+        float output[CONV1D_CHUNK];
+
+        // The DMEM buffers are only large enough for
+        // CONV1D_MAX_F and CONV1D_MAX_S, and the specialized
+        // kernels only compute filters of F_LEN elements
+        if (F > CONV1D_MAX_F || S > CONV1D_MAX_S || (F_LEN && F != F_LEN)) {
+                bsg_print_hexadecimal(0xC0DEC1D1);
+                bsg_tile_group_barrier(&r_barrier, &c_barrier);
+                return -1;
+        }
+
+        bsg_cuda_print_stat_kernel_start();
+
+        bsg_memcpy_dram_to_dmem(filter_local, filter, F * sizeof(float));
+
+        // The block of outputs of this tile group, as in v0,
+        // and the contiguous slice of it computed by this tile
+        const int tile_group_idx = __bsg_grid_dim_x * __bsg_tile_group_id_y + __bsg_tile_group_id_x;
+        const int M = 1 + (N - F + 2 * P) / S;
+        const int num_cores = bsg_tiles_X * bsg_tiles_Y;
+        const int start = std::min(tile_group_idx * block_size, M);
+        const int end = std::min(start + block_size, M);
+        const int slice = (end - start + num_cores - 1) / num_cores;
+        const int tile_start = std::min(start + __bsg_id * slice, end);
+        const int tile_end = std::min(tile_start + slice, end);
+
+        for(int i = tile_start; i < tile_end; i += CONV1D_CHUNK)
+                {
+                        int n = std::min(CONV1D_CHUNK, tile_end - i);
+
+                        // Stage the input window of this chunk
+                        window_load(window, A, N, i * S - P, (n - 1) * S + F);
+
+                        conv1d_chunk<F_LEN>(window, filter_local, F, S, output, n);
+
+                        bsg_memcpy_dmem_to_dram(&B[i], output, n * sizeof(float));
+                }
+
+        bsg_tile_group_barrier(&r_barrier, &c_barrier);
+
+        bsg_cuda_print_stat_kernel_end();
+        return 0;
+}
+
+extern "C" {
+        // Any filter length
+        __attribute__((noinline))
+        int kernel_conv1d(const float *A,
+                          const int N,
+                          const float *filter,
+                          const int F,
+                          const int P,
+                          float *B,
+                          const int S,
+                          const int block_size)
+        {
+                return conv1d<0>(A, N, filter, F, P, B, S, block_size);
+        }
+
+        // Filters of 3, 5, 7 and 9 elements
+        __attribute__((noinline))
+        int kernel_conv1d_f3(const float *A,
+                             const int N,
+                             const float *filter,
+                             const int F,
+                             const int P,
+                             float *B,
+                             const int S,
+                             const int block_size)
+        {
+                return conv1d<3>(A, N, filter, F, P, B, S, block_size);
+        }
+
+        __attribute__((noinline))
+        int kernel_conv1d_f5(const float *A,
+                             const int N,
+                             const float *filter,
+                             const int F,
+                             const int P,
+                             float *B,
+                             const int S,
+                             const int block_size)
+        {
+                return conv1d<5>(A, N, filter, F, P, B, S, block_size);
+        }
+
+        __attribute__((noinline))
+        int kernel_conv1d_f7(const float *A,
+                             const int N,
+                             const float *filter,
+                             const int F,
+                             const int P,
+                             float *B,
+                             const int S,
+                             const int block_size)
+        {
+                return conv1d<7>(A, N, filter, F, P, B, S, block_size);
+        }
+
+        __attribute__((noinline))
+        int kernel_conv1d_f9(const float *A,
+                             const int N,
+                             const float *filter,
+                             const int F,
+                             const int P,
+                             float *B,
+                             const int S,
+                             const int block_size)
+        {
+                return conv1d<9>(A, N, filter, F, P, B, S, block_size);
+        }
+}
@@ -0,0 +1,128 @@
+#ifndef __CONV2D_HPP
+#define __CONV2D_HPP
+#include <bsg_memcpy.hpp>
+#include <algorithm>
+
+/*
+ * Helpers for the 2D convolution kernels. A is an M x N matrix, the
+ * filter is Fy x Fx, P is the (symmetric) padding, and Sy and Sx are
+ * the vertical and horizontal strides.
+ */
+
+// Outputs per block, in each dimension
+#define CONV2D_TILE_Y 4
+#define CONV2D_TILE_X 4
+
+// The largest filter (in each dimension) and stride supported. The
+// DMEM buffers are sized for them.
+#define CONV2D_MAX_F 8
+#define CONV2D_MAX_S 2
+
+// Rows and columns of the input window of a block
+#define CONV2D_WINDOW_Y ((CONV2D_TILE_Y - 1) * CONV2D_MAX_S + CONV2D_MAX_F)
+#define CONV2D_WINDOW_X ((CONV2D_TILE_X - 1) * CONV2D_MAX_S + CONV2D_MAX_F)
+
+constexpr int output_dim(int N, int F, int P, int S)
+{
+        return 1 + (N - F + 2 * P) / S;
+}
+
+// Copy rows [ay, ay + wy) and columns [ax, ax + wx) of A (M x N) into
+// window, which has pitch columns. Elements outside of A are zero
+// (padding).
+void window_load(float *window, int pitch, const float *A, int M, int N,
+                 int ay, int ax, int wy, int wx)
+{
+        // The columns of the window that are inside of A
+        int lo = std::min(std::max(-ax, 0), wx);
+        int hi = std::max(std::min(N - ax, wx), lo);
+
+        for (int y = 0; y < wy; y++) {
+                float *row = &window[y * pitch];
+                if (ay + y < 0 || ay + y >= M) {
+                        std::fill(row, row + wx, 0.0f);
+                        continue;
+                }
+
+                std::fill(row, row + lo, 0.0f);
+                bsg_memcpy_dram_to_dmem(&row[lo], &A[(ay + y) * N + ax + lo],
+                                        (hi - lo) * sizeof(float));
+                std::fill(row + hi, row + wx, 0.0f);
+        }
+}
+
+// Add the convolution of the staged input window (CONV2D_WINDOW_X
+// columns) with filter f to the ty x tx outputs of res, which has
+// CONV2D_TILE_X columns
+void conv2d_block(float *res, const float *window, const float *f,
+                  int Fy, int Fx, int Sy, int Sx, int ty, int tx)
+{
+        for (int ly = 0; ly < ty; ly++)
+                for (int lx = 0; lx < tx; lx++) {
+                        const float *w = &window[ly * Sy * CONV2D_WINDOW_X + lx * Sx];
+
+                        float sum = res[ly * CONV2D_TILE_X + lx];
+                        for (int fy = 0; fy < Fy; fy++)
+                                for (int fx = 0; fx < Fx; fx++)
+                                        sum += f[fy * Fx + fx] * w[fy * CONV2D_WINDOW_X + fx];
+                        res[ly * CONV2D_TILE_X + lx] = sum;
+                }
+}
+
+// The direct convolution of the block_size_y x block_size_x outputs of
+// this tile group. Each tile computes blocks of CONV2D_TILE_Y x
+// CONV2D_TILE_X outputs: for each block, it first copies the input
+// window of the block (the block plus its halo) from DRAM into DMEM,
+// with the zero padding written out, so that the inner loop reads every
+// input from DMEM and has no bounds checks. The filter is copied into
+// DMEM once.
+int conv2d_direct(const float *A, int M, int N,
+                  const float *filter, int Fy, int Fx, int P,
+                  float *B, int Sy, int Sx,
+                  int block_size_y, int block_size_x)
+{
+        float filter_local[CONV2D_MAX_F * CONV2D_MAX_F];
+        float window[CONV2D_WINDOW_Y * CONV2D_WINDOW_X];
+        float res[CONV2D_TILE_Y * CONV2D_TILE_X];
+
+        // The DMEM buffers are only large enough for CONV2D_MAX_F and
+        // CONV2D_MAX_S
+        if (Fy > CONV2D_MAX_F || Fx > CONV2D_MAX_F ||
+            Sy > CONV2D_MAX_S || Sx > CONV2D_MAX_S) {
+                bsg_print_hexadecimal(0xC0DEC2D1);
+                return -1;
+        }
+
+        bsg_memcpy_dram_to_dmem(filter_local, filter, Fy * Fx * sizeof(float));
+
+        int result_y = output_dim(M, Fy, P, Sy);
+        int result_x = output_dim(N, Fx, P, Sx);
+
+        int start_y = __bsg_tile_group_id_y * block_size_y;
+        int start_x = __bsg_tile_group_id_x * block_size_x;
+        int end_y = std::min(start_y + block_size_y, result_y);
+        int end_x = std::min(start_x + block_size_x, result_x);
+
+        for (int by = start_y + __bsg_y * CONV2D_TILE_Y; by < end_y; by += bsg_tiles_Y * CONV2D_TILE_Y)
+                for (int bx = start_x + __bsg_x * CONV2D_TILE_X; bx < end_x; bx += bsg_tiles_X * CONV2D_TILE_X) {
+                        int ty = std::min(CONV2D_TILE_Y, end_y - by);
+                        int tx = std::min(CONV2D_TILE_X, end_x - bx);
+
+                        // Stage the input window of this block
+                        window_load(window, CONV2D_WINDOW_X, A, M, N,
+                                    by * Sy - P, bx * Sx - P,
+                                    (ty - 1) * Sy + Fy, (tx - 1) * Sx + Fx);
+
+                        std::fill(res, res + CONV2D_TILE_Y * CONV2D_TILE_X, 0.0f);
+                        conv2d_block(res, window, filter_local, Fy, Fx, Sy, Sx, ty, tx);
+
+                        for (int ly = 0; ly < ty; ly++)
+                                bsg_memcpy_dmem_to_dram(&B[(by + ly) * result_x + bx],
+                                                        &res[ly * CONV2D_TILE_X],
+                                                        tx * sizeof(float));
+                }
+
+        return 0;
+}
+
+#endif //__CONV2D_HPP
@@ -6,8 +6,8 @@
 // before bsg_manycore.h and bsg_tile_group_barrier.h are
 // included. bsg_tiles_X and bsg_tiles_Y must also be defined for
 // legacy reasons, but they are deprecated.
-#define BSG_TILE_GROUP_X_DIM 1
-#define BSG_TILE_GROUP_Y_DIM 1
+#define BSG_TILE_GROUP_X_DIM 2
+#define BSG_TILE_GROUP_Y_DIM 2
 #define bsg_tiles_X BSG_TILE_GROUP_X_DIM
 #define bsg_tiles_Y BSG_TILE_GROUP_Y_DIM
 #include <bsg_manycore.h>
@@ -36,6 +36,8 @@ extern "C" {
                           const int block_size_y,
                           const int block_size_x)
         {
+                bsg_cuda_print_stat_kernel_start();
+
                 int result_y = output_dim(M, Fy, P, Sy);
                 int result_x = output_dim(N, Fx, P, Sx);
 
@@ -67,6 +69,8 @@ extern "C" {
                         }
 
                 bsg_tile_group_barrier(&r_barrier, &c_barrier);
+
+                bsg_cuda_print_stat_kernel_end();
                 return 0;
         }
 
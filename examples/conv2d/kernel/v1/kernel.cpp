@@ -0,0 +1,53 @@
+// Takes an MxN matrix A and a FyxFx filter, a padding P, a vertical
+// stride Sy and a horizontal stride Sx, and stores the result of the
+// 2D convolution in B, as in v0.
+//
+// Each tile computes blocks of CONV2D_TILE_Y x CONV2D_TILE_X outputs.
+// For each block, the tile first copies the input window of the block
+// (the block plus its halo) from DRAM into DMEM, with the zero padding
+// written out, so that the inner loop reads every input from DMEM and
+// has no bounds checks. The filter is copied into DMEM once. See
+// conv2d_direct in conv2d.hpp.
+
+// BSG_TILE_GROUP_X_DIM and BSG_TILE_GROUP_Y_DIM must be defined
+// before bsg_manycore.h and bsg_tile_group_barrier.h are
+// included. bsg_tiles_X and bsg_tiles_Y must also be defined for
+// legacy reasons, but they are deprecated.
+#define BSG_TILE_GROUP_X_DIM 2
+#define BSG_TILE_GROUP_Y_DIM 2
+#define bsg_tiles_X BSG_TILE_GROUP_X_DIM
+#define bsg_tiles_Y BSG_TILE_GROUP_Y_DIM
+#include <bsg_manycore.h>
+#include <bsg_tile_group_barrier.h>
+INIT_TILE_GROUP_BARRIER(r_barrier, c_barrier, 0, bsg_tiles_X - 1, 0, bsg_tiles_Y - 1);
+
+#include <conv2d.hpp>
+
+extern "C" {
+        __attribute__((noinline))
+        int kernel_conv2d(const float *A,
+                          const int M,
+                          const int N,
+                          const float *filter,
+                          const int Fy,
+                          const int Fx,
+                          const int P,
+                          float *B,
+                          const int Sy,
+                          const int Sx,
+                          const int block_size_y,
+                          const int block_size_x)
+        {
+                int rc;
+                bsg_cuda_print_stat_kernel_start();
+
+                rc = conv2d_direct(A, M, N, filter, Fy, Fx, P, B, Sy, Sx,
+                                   block_size_y, block_size_x);
+
+                bsg_tile_group_barrier(&r_barrier, &c_barrier);
+
+                bsg_cuda_print_stat_kernel_end();
+                return rc;
+        }
+
+}
@@ -0,0 +1,154 @@
+// Takes an MxN matrix A and a FyxFx filter, a padding P, a vertical
+// stride Sy and a horizontal stride Sx, and stores the result of the
+// 2D convolution in B, as in v0.
+//
+// The convolution is lowered to a matrix multiplication (im2col),
+// CONV2D_IM2COL_N outputs at a time. The tile stages the input window
+// of the outputs in DMEM, as in v1, and copies the Fy x Fx inputs of
+// each output into a row of a CONV2D_IM2COL_N x (Fy * Fx) matrix in
+// DMEM. The outputs are the product of the filter (a 1 x (Fy * Fx)
+// matrix) and that matrix, computed with the register-blocked matrix
+// multiplication of tile_matrix_matrix_multiply (v6). The whole im2col
+// matrix is never stored in DRAM.
+//
+// kernel_conv2d is the direct convolution of v1. The host runs it
+// when the filter is larger than CONV2D_IM2COL_MAX_F, or when the
+// stride is at least the filter size, so that no input would be used
+// by more than one output.
+
+// BSG_TILE_GROUP_X_DIM and BSG_TILE_GROUP_Y_DIM must be defined
+// before bsg_manycore.h and bsg_tile_group_barrier.h are
+// included. bsg_tiles_X and bsg_tiles_Y must also be defined for
+// legacy reasons, but they are deprecated.
+#define BSG_TILE_GROUP_X_DIM 2
+#define BSG_TILE_GROUP_Y_DIM 2
+#define bsg_tiles_X BSG_TILE_GROUP_X_DIM
+#define bsg_tiles_Y BSG_TILE_GROUP_Y_DIM
+#include <bsg_manycore.h>
+#include <bsg_tile_group_barrier.h>
+INIT_TILE_GROUP_BARRIER(r_barrier, c_barrier, 0, bsg_tiles_X - 1, 0, bsg_tiles_Y - 1);
+
+#include <conv2d.hpp>
+#include <bsg_matrix_multiply.hpp>
+
+// Outputs per matrix multiplication in kernel_conv2d_im2col (a multiple
+// of the unrolling factor of the matrix multiplication, 4)
+#define CONV2D_IM2COL_N 8
+
+// The largest filter (in each dimension) supported by
+// kernel_conv2d_im2col. The im2col matrix takes CONV2D_IM2COL_N *
+// CONV2D_IM2COL_MAX_F^2 elements of DMEM.
+#define CONV2D_IM2COL_MAX_F 5
+
+// Columns of the input window of kernel_conv2d_im2col
+#define CONV2D_IM2COL_WINDOW_X ((CONV2D_IM2COL_N - 1) * CONV2D_MAX_S + CONV2D_IM2COL_MAX_F)
+
+extern "C" {
+        __attribute__((noinline))
+        int kernel_conv2d(const float *A,
+                          const int M,
+                          const int N,
+                          const float *filter,
+                          const int Fy,
+                          const int Fx,
+                          const int P,
+                          float *B,
+                          const int Sy,
+                          const int Sx,
+                          const int block_size_y,
+                          const int block_size_x)
+        {
+                int rc;
+                bsg_cuda_print_stat_kernel_start();
+
+                rc = conv2d_direct(A, M, N, filter, Fy, Fx, P, B, Sy, Sx,
+                                   block_size_y, block_size_x);
+
+                bsg_tile_group_barrier(&r_barrier, &c_barrier);
+
+                bsg_cuda_print_stat_kernel_end();
+                return rc;
+        }
+
+        __attribute__((noinline))
+        int kernel_conv2d_im2col(const float *A,
+                                 const int M,
+                                 const int N,
+                                 const float *filter,
+                                 const int Fy,
+                                 const int Fx,
+                                 const int P,
+                                 float *B,
+                                 const int Sy,
+                                 const int Sx,
+                                 const int block_size_y,
+                                 const int block_size_x)
+        {
+                const int K = Fy * Fx;
+                float filter_local[CONV2D_IM2COL_MAX_F * CONV2D_IM2COL_MAX_F];
+                float window[CONV2D_IM2COL_MAX_F * CONV2D_IM2COL_WINDOW_X];
+                float patches[CONV2D_IM2COL_N * CONV2D_IM2COL_MAX_F * CONV2D_IM2COL_MAX_F];
+                float output[CONV2D_IM2COL_N];
+
+                // The DMEM buffers are only large enough for
+                // CONV2D_IM2COL_MAX_F and CONV2D_MAX_S
+                if (Fy > CONV2D_IM2COL_MAX_F || Fx > CONV2D_IM2COL_MAX_F ||
+                    Sy > CONV2D_MAX_S || Sx > CONV2D_MAX_S) {
+                        bsg_print_hexadecimal(0xC0DEC2D2);
+                        bsg_tile_group_barrier(&r_barrier, &c_barrier);
+                        return -1;
+                }
+
+                bsg_cuda_print_stat_kernel_start();
+
+                bsg_memcpy_dram_to_dmem(filter_local, filter, K * sizeof(float));
+
+                int result_y = output_dim(M, Fy, P, Sy);
+                int result_x = output_dim(N, Fx, P, Sx);
+
+                int start_y = __bsg_tile_group_id_y * block_size_y;
+                int start_x = __bsg_tile_group_id_x * block_size_x;
+                int end_y = std::min(start_y + block_size_y, result_y);
+                int end_x = std::min(start_x + block_size_x, result_x);
+
+                // Each tile computes runs of CONV2D_IM2COL_N outputs
+                // of a row of the block, round-robin.
+                const int runs_x = (end_x - start_x + CONV2D_IM2COL_N - 1) / CONV2D_IM2COL_N;
+                const int runs = (end_y - start_y) * runs_x;
+                for(int r = __bsg_id; r < runs; r += bsg_tiles_X * bsg_tiles_Y)
+                        {
+                                int by = start_y + r / runs_x;
+                                int bx = start_x + (r % runs_x) * CONV2D_IM2COL_N;
+                                int n = std::min(CONV2D_IM2COL_N, end_x - bx);
+
+                                // Stage the input window of the outputs
+                                window_load(window, CONV2D_IM2COL_WINDOW_X, A, M, N,
+                                            by * Sy - P, bx * Sx - P,
+                                            Fy, (n - 1) * Sx + Fx);
+
+                                // Lower: row j of patches is the window
+                                // of output j. The rows past n are zero,
+                                // so that the matrix multiplication
+                                // computes a multiple of 4 outputs.
+                                float *p = patches;
+                                for(int j = 0; j < n; j++)
+                                        for(int fy = 0; fy < Fy; fy++)
+                                                for(int fx = 0; fx < Fx; fx++)
+                                                        *p++ = window[fy * CONV2D_IM2COL_WINDOW_X + j * Sx + fx];
+                                int n4 = (n + 3) & ~3;
+                                std::fill(p, &patches[n4 * K], 0.0f);
+
+                                // output (1 x n4) = filter (1 x K) * patches^T (K x n4)
+                                kernel_matrix_multiply_transpose_nomul_unroll<4>(filter_local, patches, output,
+                                                                                 1, K, n4);
+
+                                bsg_memcpy_dmem_to_dram(&B[by * result_x + bx], output, n * sizeof(float));
+                        }
+
+                bsg_tile_group_barrier(&r_barrier, &c_barrier);
+
+                bsg_cuda_print_stat_kernel_end();
+                return 0;
+        }
+
+}
@@ -0,0 +1,111 @@
+// Takes a batch of Nb images of Cin channels, A (Nb x Cin x M x N, in
+// NCHW order), and Cout filters of Cin channels (Cout x Cin x Fy x Fx),
+// a padding P, a vertical stride Sy and a horizontal stride Sx, and
+// stores the 2D convolutions in B (Nb x Cout x output_dim(M, Fy, P,
+// Sy) x output_dim(N, Fx, P, Sx)), as in v0 but summed over the input
+// channels.
+//
+// Each tile computes one output channel: the output channels are
+// partitioned across the tile groups of the grid, bsg_tiles_X *
+// bsg_tiles_Y per tile group. The tile copies the filter of its
+// output channel (its slice of the weights) into DMEM once, and
+// streams the images through DMEM as in v1: for each block of
+// CONV2D_TILE_Y x CONV2D_TILE_X outputs, it stages the zero-padded
+// input window of each input channel in turn, and accumulates it.
+
+// BSG_TILE_GROUP_X_DIM and BSG_TILE_GROUP_Y_DIM must be defined
+// before bsg_manycore.h and bsg_tile_group_barrier.h are
+// included. bsg_tiles_X and bsg_tiles_Y must also be defined for
+// legacy reasons, but they are deprecated.
+#define BSG_TILE_GROUP_X_DIM 2
+#define BSG_TILE_GROUP_Y_DIM 2
+#define bsg_tiles_X BSG_TILE_GROUP_X_DIM
+#define bsg_tiles_Y BSG_TILE_GROUP_Y_DIM
+#include <bsg_manycore.h>
+#include <bsg_tile_group_barrier.h>
+INIT_TILE_GROUP_BARRIER(r_barrier, c_barrier, 0, bsg_tiles_X - 1, 0, bsg_tiles_Y - 1);
+
+#include <conv2d.hpp>
+
+// The largest filter slice (Cin * Fy * Fx weights) supported
+#define CONV2D_MAX_WEIGHTS 256
+
+extern "C" {
+        __attribute__((noinline))
+        int kernel_conv2d(const float *A,
+                          const int Nb,
+                          const int Cin,
+                          const int M,
+                          const int N,
+                          const float *filter,
+                          const int Cout,
+                          const int Fy,
+                          const int Fx,
+                          const int P,
+                          float *B,
+                          const int Sy,
+                          const int Sx)
+        {
+                float filter_local[CONV2D_MAX_WEIGHTS];
+                float window[CONV2D_WINDOW_Y * CONV2D_WINDOW_X];
+                float res[CONV2D_TILE_Y * CONV2D_TILE_X];
+
+                // The DMEM buffers are only large enough for
+                // CONV2D_MAX_WEIGHTS, CONV2D_MAX_F and CONV2D_MAX_S
+                const int K = Fy * Fx;
+                if (Cin * K > CONV2D_MAX_WEIGHTS ||
+                    Fy > CONV2D_MAX_F || Fx > CONV2D_MAX_F ||
+                    Sy > CONV2D_MAX_S || Sx > CONV2D_MAX_S) {
+                        bsg_print_hexadecimal(0xC0DEC2D3);
+                        bsg_tile_group_barrier(&r_barrier, &c_barrier);
+                        return -1;
+                }
+
+                bsg_cuda_print_stat_kernel_start();
+
+                int result_y = output_dim(M, Fy, P, Sy);
+                int result_x = output_dim(N, Fx, P, Sx);
+
+                // The output channel of this tile
+                int co = __bsg_tile_group_id * bsg_tiles_X * bsg_tiles_Y + __bsg_id;
+                if (co < Cout) {
+                        // The filter slice stays in DMEM for the whole batch
+                        bsg_memcpy_dram_to_dmem(filter_local, &filter[co * Cin * K],
+                                                Cin * K * sizeof(float));
+
+                        for(int n = 0; n < Nb; n++)
+                                for(int by = 0; by < result_y; by += CONV2D_TILE_Y)
+                                        for(int bx = 0; bx < result_x; bx += CONV2D_TILE_X)
+                                        {
+                                                int ty = std::min(CONV2D_TILE_Y, result_y - by);
+                                                int tx = std::min(CONV2D_TILE_X, result_x - bx);
+
+                                                std::fill(res, res + CONV2D_TILE_Y * CONV2D_TILE_X, 0.0f);
+                                                for(int ci = 0; ci < Cin; ci++)
+                                                {
+                                                        // Stage the input window of this block,
+                                                        // in input channel ci
+                                                        window_load(window, CONV2D_WINDOW_X,
+                                                                    &A[(n * Cin + ci) * M * N], M, N,
+                                                                    by * Sy - P, bx * Sx - P,
+                                                                    (ty - 1) * Sy + Fy, (tx - 1) * Sx + Fx);
+
+                                                        conv2d_block(res, window, &filter_local[ci * K],
+                                                                     Fy, Fx, Sy, Sx, ty, tx);
+                                                }
+
+                                                float *out = &B[(n * Cout + co) * result_y * result_x];
+                                                for(int ly = 0; ly < ty; ly++)
+                                                        bsg_memcpy_dmem_to_dram(&out[(by + ly) * result_x + bx],
+                                                                                &res[ly * CONV2D_TILE_X],
+                                                                                tx * sizeof(float));
+                                        }
+                }
+
+                bsg_tile_group_barrier(&r_barrier, &c_barrier);
+
+                bsg_cuda_print_stat_kernel_end();
+                return 0;
+        }
+
+}
@@ -0,0 +1,178 @@
+// Copyright (c) 2020, University of Washington All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+// 
+// Redistributions of source code must retain the above copyright notice, this list
+// of conditions and the following disclaimer.
+// 
+// Redistributions in binary form must reproduce the above copyright notice, this
+// list of conditions and the following disclaimer in the documentation and/or
+// other materials provided with the distribution.
+// 
+// Neither the name of the copyright holder nor the names of its contributors may
+// be used to endorse or promote products derived from this software without
+// specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+// ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef __DEVICE_ARENA_HPP
+#define __DEVICE_ARENA_HPP
+
+#include <cstdint>
+#include <algorithm>
+#include <initializer_list>
+#include <iterator>
+#include <map>
+#include <bsg_manycore_errno.h>
+#include <bsg_manycore_cuda.h>
+#include "common.h"
+
+/*
+ * A host-side arena for device memory.
+ *
+ * init() reserves one region of device DRAM with hb_mc_device_malloc()
+ * (call it after hb_mc_device_program_init()). alloc() and free() then
+ * sub-allocate that region without calling the device allocator:
+ * allocations are DEVICE_ARENA_ALIGN-byte aligned and come from a
+ * first-fit free list that coalesces freed neighbours. reset() frees
+ * every allocation at once, so a series of tests (e.g. over data types
+ * or sizes) can re-allocate their buffers from a clean arena without
+ * fragmenting it.
+ *
+ * The region is released by hb_mc_device_finish(). report() prints the
+ * high-water mark, i.e. the peak number of bytes allocated from the
+ * arena (including alignment), which is how large init() needed to be.
+ */
+
+#define DEVICE_ARENA_ALIGN 64
+
+class device_arena {
+public:
+        explicit device_arena(hb_mc_device_t *device) : device(device) {}
+
+        // The number of bytes to reserve so that buffers of the given
+        // sizes can all be allocated at once.
+        static size_t footprint(std::initializer_list<size_t> sizes) {
+                size_t bytes = DEVICE_ARENA_ALIGN; // Alignment of the region
+                for (size_t sz : sizes)
+                        bytes += round_up(sz);
+                return bytes;
+        }
+
+        // Reserve bytes bytes of device memory
+        int init(size_t bytes) {
+                if (size)
+                        return HB_MC_INITIALIZED_TWICE;
+
+                int rc = hb_mc_device_malloc(device, bytes, &base);
+                if (rc != HB_MC_SUCCESS) {
+                        bsg_pr_test_err("failed to reserve %zu bytes of device memory.\n", bytes);
+                        return rc;
+                }
+                size = bytes;
+                reset();
+                return HB_MC_SUCCESS;
+        }
+
+        // Allocate bytes bytes from the arena
+        int alloc(size_t bytes, eva_t *eva) {
+                if (!size)
+                        return HB_MC_UNINITIALIZED;
+
+                size_t need = round_up(bytes ? bytes : 1);
+                for (auto it = free_list.begin(); it != free_list.end(); ++it) {
+                        uint64_t start = round_up(it->first);
+                        uint64_t end = it->first + it->second;
+                        if (start + need > end)
+                                continue;
+
+                        // Split the free block around the allocation
+                        uint64_t lo = it->first;
+                        free_list.erase(it);
+                        if (start > lo)
+                                free_list[lo] = start - lo;
+                        if (end > start + need)
+                                free_list[start + need] = end - (start + need);
+
+                        allocated[start] = need;
+                        used += need;
+                        high_water = std::max(high_water, used);
+                        allocations++;
+                        *eva = static_cast<eva_t>(start);
+                        return HB_MC_SUCCESS;
+                }
+
+                bsg_pr_test_err("device arena: cannot allocate %zu bytes "
+                                "(%zu of %zu bytes in use).\n", bytes, used, size);
+                return HB_MC_NOMEM;
+        }
+
+        // Return an allocation to the arena
+        int free(eva_t eva) {
+                auto it = allocated.find(eva);
+                if (it == allocated.end())
+                        return HB_MC_INVALID;
+
+                uint64_t start = it->first, end = start + it->second;
+                used -= it->second;
+                allocated.erase(it);
+
+                // Coalesce with the free blocks on either side
+                auto next = free_list.lower_bound(start);
+                if (next != free_list.end() && next->first == end) {
+                        end += next->second;
+                        next = free_list.erase(next);
+                }
+                if (next != free_list.begin()) {
+                        auto prev = std::prev(next);
+                        if (prev->first + prev->second == start) {
+                                start = prev->first;
+                                free_list.erase(prev);
+                        }
+                }
+                free_list[start] = end - start;
+                return HB_MC_SUCCESS;
+        }
+
+        // Free every allocation
+        void reset() {
+                allocated.clear();
+                free_list.clear();
+                free_list[base] = size;
+                used = 0;
+        }
+
+        size_t bytes_in_use() const { return used; }
+        size_t high_water_mark() const { return high_water; }
+
+        void report(const char *name) const {
+                bsg_pr_test_info("%s: %zu allocations, high-water mark %zu of %zu bytes\n",
+                                 name, allocations, high_water, size);
+        }
+
+private:
+        hb_mc_device_t *device;
+        eva_t base = 0;
+        size_t size = 0;
+
+        // Free blocks and live allocations, by start address
+        std::map<uint64_t, uint64_t> free_list, allocated;
+
+        size_t used = 0, high_water = 0, allocations = 0;
+
+        static uint64_t round_up(uint64_t x) {
+                return (x + DEVICE_ARENA_ALIGN - 1) / DEVICE_ARENA_ALIGN * DEVICE_ARENA_ALIGN;
+        }
+};
+
+#endif // __DEVICE_ARENA_HPP
@@ -32,45 +32,10 @@
  * Grid dimensions are determined by how much of a load we want for each tile group (block_size_y/x)
  */
 
-// Matrix sizes:
-#define A_HEIGHT 32
-#define A_WIDTH  64
-#define B_HEIGHT A_WIDTH
-#define B_WIDTH  16
-#define C_HEIGHT A_HEIGHT
-#define C_WIDTH  B_WIDTH
-#define NUM_ITER 4
-
-// Host Matrix multiplication code (to compare results)
-template <typename TA, typename TB, typename TC>
-void matrix_mult (TA *A, TB *B, TC *C, uint64_t M, uint64_t N, uint64_t P) {
-        for (uint64_t y = 0; y < M; y ++) {
-                for (uint64_t x = 0; x < P; x ++) {
-                        TC res = 0.0f;
-                        for (uint64_t k = 0; k < N; k++) {
-                                res += A[y * N + k] * B[k * P + x];
-                        }
-                        C[y * P + x] = res;
-                }
-        }
-        return;
-}
-
-// Compute the sum of squared error between matricies A and B (M x N)
-template <typename T>
-double matrix_sse (const T *A, const T *B, uint64_t M, uint64_t N) {
-        double sum = 0;
-        for (uint64_t y = 0; y < M; y ++) {
-                for (uint64_t x = 0; x < N; x ++) {
-                        T diff = A[y * N + x] - B[y * N + x];
-                        if(std::isnan(diff)){
-                                return diff;
-                        }
-                        sum += diff * diff;
-                }
-        }
-        return sum;
-}
+// Default matrix sizes (--m, --k and --n set A_HEIGHT, A_WIDTH and B_WIDTH):
+#define DEFAULT_A_HEIGHT 32
+#define DEFAULT_A_WIDTH  64
+#define DEFAULT_B_WIDTH  16
 
 // Print matrix A (M x N). This works well for small matricies.
 template <typename T>
@@ -89,11 +54,19 @@ int kernel_matrix_matrix_multiply (int argc, char **argv) {
 
         int rc;
         char *bin_path, *test_name;
-        struct arguments_path args = {NULL, NULL};
+        struct arguments_size args = {{NULL, NULL}};
+        args.m = DEFAULT_A_HEIGHT;
+        args.k = DEFAULT_A_WIDTH;
+        args.n = DEFAULT_B_WIDTH;
+        args.seed = 42;
 
-        argp_parse (&argp_path, argc, argv, 0, 0, &args);
-        bin_path = args.path;
-        test_name = args.name;
+        argp_parse (&argp_size, argc, argv, 0, 0, &args);
+        bin_path = args.path.path;
+        test_name = args.path.name;
+
+        const uint32_t A_HEIGHT = args.m, A_WIDTH = args.k, B_WIDTH = args.n;
+        const uint32_t B_HEIGHT = A_WIDTH;
+        const uint32_t C_HEIGHT = A_HEIGHT, C_WIDTH = B_WIDTH;
 
         bsg_pr_test_info("Running the CUDA Tile-Group Matrix-Matrix "
                          "Multiplication Kernel.\n\n");
@@ -104,56 +77,81 @@ int kernel_matrix_matrix_multiply (int argc, char **argv) {
         uint32_t block_size_x = 0;
         uint32_t block_size_y = 0;
         hb_mc_dimension_t tg_dim = { .x = 0, .y = 0 };
-        if(!strcmp("v0", test_name) || !strcmp("v1", test_name)){
+        if(!strcmp("v0", test_name) || !strcmp("v1", test_name) ||
+           !strcmp("v2", test_name) || !strcmp("v3", test_name)){
                 block_size_x = 4;
                 block_size_y = 4;
                 tg_dim = { .x = 2, .y = 2 };
+        } else if(!strcmp("v4", test_name)){
+                // A 4x4 systolic array, where each tile computes 4x4
+                // elements of C
+                block_size_x = 16;
+                block_size_y = 16;
+                tg_dim = { .x = 4, .y = 4 };
         } else {
                 bsg_pr_test_err("Invalid version provided!.\n");
                 return HB_MC_INVALID;
         }
+
+        // v1 copies whole blocks of A, B and C through tile group shared
+        // memory, and A_WIDTH is split into blocks of BLOCK_WIDTH (4).
+        // v2 and v3 zero-pad partial blocks, and take any size.
+        if (!strcmp("v1", test_name) &&
+            (A_HEIGHT % block_size_y || B_WIDTH % block_size_x || A_WIDTH % 4)) {
+                bsg_pr_test_err("v1 requires M to be a multiple of %u, N to be a "
+                                "multiple of %u, and K to be a multiple of 4.\n",
+                                block_size_y, block_size_x);
+                return HB_MC_INVALID;
+        }
+
         hb_mc_dimension_t grid_dim = { .x = (B_WIDTH + block_size_x - 1) / block_size_x,
                                        .y = (A_HEIGHT + block_size_y - 1) / block_size_y };
 
-        // Initialize the random number generators
+        // A model of the DRAM traffic, not a measurement (see the
+        // kernel stats for that): v0 reads a row of A and a column of
+        // B from DRAM for every element of C. The others read the rows
+        // of A and columns of B of each tile group from DRAM once, so
+        // A is read once per tile group column and B once per tile
+        // group row.
+        uint64_t dram_loads = (uint64_t) A_HEIGHT * A_WIDTH * grid_dim.x +
+                (uint64_t) A_WIDTH * B_WIDTH * grid_dim.y;
+        if (!strcmp("v0", test_name))
+                dram_loads = 2ull * A_HEIGHT * A_WIDTH * B_WIDTH;
+        bsg_pr_test_info("%ux%u blocks: modelled %llu DRAM loads (of A and B) and %u DRAM stores (of C)\n",
+                         block_size_y, block_size_x, (unsigned long long) dram_loads,
+                         C_HEIGHT * C_WIDTH);
+
+        // Initialize the random number generators (one stream per input)
         std::numeric_limits<int8_t> lim; // Used to get INT_MIN and INT_MAX in C++
-        std::default_random_engine generator;
-        generator.seed(42);
-        std::uniform_real_distribution<float> distribution(lim.min(),lim.max());
+        host_random A_random(args.seed, 0), B_random(args.seed, 1);
 
         // Allocate A, B, BT, C and R (result) on the host
-        float A[A_HEIGHT * A_WIDTH];
-        float B[B_HEIGHT * B_WIDTH];
-        float C[C_HEIGHT * C_WIDTH];
-        float R[C_HEIGHT * C_WIDTH];
-
-        // Generate random numbers. Since the Manycore can't handle infinities,
-        // subnormal numbers, or NANs, filter those out.
-        auto res = distribution(generator);
-
-        for (uint64_t i = 0; i < A_HEIGHT * A_WIDTH; i++) {
-                do{
-                        res = distribution(generator);
-                }while(!std::isnormal(res) ||
-                       !std::isfinite(res) ||
-                       std::isnan(res));
-
-                A[i] = static_cast<float>(res);
+        host_buffer<float> A(A_HEIGHT * A_WIDTH);
+        host_buffer<float> B(B_HEIGHT * B_WIDTH);
+        host_buffer<float> C(C_HEIGHT * C_WIDTH);
+        host_buffer<float> R(C_HEIGHT * C_WIDTH);
+
+        // Load A, B and the known-correct result R from the dataset
+        // cache, or generate them.
+        host_dataset cache("group_matrix_matrix_multiply", "float",
+                           {A_HEIGHT, A_WIDTH, B_WIDTH}, args.seed);
+        if (!cache.load({{"A", A.data(), A.size_bytes()},
+                         {"B", B.data(), B.size_bytes()},
+                         {"R", R.data(), R.size_bytes()}})) {
+                // Generate random numbers. Since the Manycore can't
+                // handle infinities, subnormal numbers, or NANs,
+                // host_random filters those out.
+                A_random.uniform(A.data(), A.size(), (float) lim.min(), (float) lim.max());
+                B_random.uniform(B.data(), B.size(), (float) lim.min(), (float) lim.max());
+
+                // Generate the known-correct results on the host
+                matrix_mult (A.data(), B.data(), R.data(), A_HEIGHT, A_WIDTH, B_WIDTH);
+
+                cache.store({{"A", A.data(), A.size_bytes()},
+                             {"B", B.data(), B.size_bytes()},
+                             {"R", R.data(), R.size_bytes()}});
         }
 
-        for (uint64_t i = 0; i < B_HEIGHT * B_WIDTH; i++) {
-                do{
-                        res = distribution(generator);
-                }while(!std::isnormal(res) ||
-                       !std::isfinite(res) ||
-                       std::isnan(res));
-
-                B[i] = static_cast<float>(res);
-        }
-
-        // Generate the known-correct results on the host
-        matrix_mult (A, B, R, A_HEIGHT, A_WIDTH, B_WIDTH);
-
         // Initialize device, load binary and unfreeze tiles.
         hb_mc_device_t device;
         rc = hb_mc_device_init(&device, test_name, 0);
@@ -171,27 +169,37 @@ int kernel_matrix_matrix_multiply (int argc, char **argv) {
         }
 
 
+        // Reserve device memory for A, B and C, and allocate them from it
+        device_arena arena(&device);
+        rc = arena.init(device_arena::footprint({A_HEIGHT * A_WIDTH * sizeof(float),
+                                                 B_HEIGHT * B_WIDTH * sizeof(float),
+                                                 C_HEIGHT * C_WIDTH * sizeof(float)}));
+        if (rc != HB_MC_SUCCESS) {
+                bsg_pr_test_err("failed to reserve device memory.\n");
+                return rc;
+        }
+
         // Allocate memory on the device for A, B and C. Since sizeof(float) ==
         // sizeof(int32_t) > sizeof(int16_t) > sizeof(int8_t) we'll reuse the
         // same buffers for each test (if multiple tests are conducted)
         eva_t A_device, B_device, C_device;
 
         // Allocate A on the device
-        rc = hb_mc_device_malloc(&device, A_HEIGHT * A_WIDTH * sizeof(float), &A_device);
+        rc = arena.alloc(A_HEIGHT * A_WIDTH * sizeof(float), &A_device);
         if (rc != HB_MC_SUCCESS) {
                 bsg_pr_test_err("failed to allocate memory on device.\n");
                 return rc;
         }
 
         // Allocate B on the device
-        rc = hb_mc_device_malloc(&device, B_HEIGHT * B_WIDTH * sizeof(float), &B_device);
+        rc = arena.alloc(B_HEIGHT * B_WIDTH * sizeof(float), &B_device);
         if (rc != HB_MC_SUCCESS) {
                 bsg_pr_test_err("failed to allocate memory on device.\n");
                 return rc;
         }
 
         // Allocate C on the device
-        rc = hb_mc_device_malloc(&device, C_HEIGHT * C_WIDTH * sizeof(float), &C_device);
+        rc = arena.alloc(C_HEIGHT * C_WIDTH * sizeof(float), &C_device);
         if (rc != HB_MC_SUCCESS) {
                 bsg_pr_test_err("failed to allocate memory on device.\n");
                 return rc;
@@ -257,17 +265,13 @@ int kernel_matrix_matrix_multiply (int argc, char **argv) {
                 return rc;
         }
 
-        // Compare the known-correct matrix (R) and the result matrix (C)
-        float max = 0.1;
-        double sse = matrix_sse(R, C, C_HEIGHT, C_WIDTH);
-
-        if (std::isnan(sse) || sse > max) {
-                bsg_pr_test_info(BSG_RED("Matrix Mismatch. SSE: %f\n"), sse);
-                return HB_MC_FAIL;
-        }
-
-        bsg_pr_test_info(BSG_GREEN("Matrix Match.\n"));
-        return HB_MC_SUCCESS;
+        // Compare the known-correct matrix (R) and the result matrix (C).
+        // The kernels sum each element of C in blocks, so each is a sum
+        // of A_WIDTH products of magnitude at most lim.max() squared,
+        // in a different order than on the host.
+        double mag = (double) A_WIDTH * lim.max() * lim.max();
+        return verify_result("C", R.data(), C.data(), C_HEIGHT, C_WIDTH,
+                             host_verify_sum_tolerance<float>(A_WIDTH, mag));
 }
 
 #ifdef COSIM
@@ -292,7 +296,7 @@ void cosim_main(uint32_t *exit_code, char * args) {
 }
 #else
 int main(int argc, char ** argv) {
-        int rc = kernel_matrix_mul(argc, argv);
+        int rc = kernel_matrix_matrix_multiply(argc, argv);
         bsg_pr_test_pass_fail(rc == HB_MC_SUCCESS);
         return rc;
 }
@@ -0,0 +1,181 @@
+#ifndef __BLOCK_COPY_HPP
+#define __BLOCK_COPY_HPP
+#include <cstdint>
+
+/*
+ * Copies between blocks of a row-major matrix in DRAM and tile group
+ * shared memory. Each tile copies the elements of the block at (y, x)
+ * with y = __bsg_y (mod BSG_TILE_GROUP_Y_DIM) and x = __bsg_x (mod
+ * BSG_TILE_GROUP_X_DIM), like memcpy_block_to_shmem in Version 1, but:
+ *
+ * - The loads are issued F at a time, before the F stores that use
+ *   them, so F loads are in flight at a time instead of one.
+ *
+ * - The source and destination offsets are computed once and then
+ *   stepped from element to element, instead of being computed from
+ *   the coordinates of each element.
+ *
+ * This header must be included after bsg_manycore.h, with
+ * BSG_TILE_GROUP_X_DIM and BSG_TILE_GROUP_Y_DIM defined.
+ */
+
+// Iterates over the elements of a block_size_y x block_size_x block
+// copied by this tile, in row-major order, keeping the offset of each
+// element in a row-major matrix (ld elements per row) and in a
+// row-major or, if TRANSPOSE, column-major block.
+template <bool TRANSPOSE>
+class block_copy_iterator {
+        uint32_t nx, x;
+        uint32_t mat_x_step, mat_y_step;
+        uint32_t blk_x_step, blk_y_step;
+public:
+        uint32_t mat, blk;
+
+        block_copy_iterator(uint32_t ld, uint32_t nx,
+                            uint32_t block_size_y, uint32_t block_size_x) :
+                nx(nx), x(0),
+                mat_x_step(BSG_TILE_GROUP_X_DIM),
+                mat_y_step(BSG_TILE_GROUP_Y_DIM * ld - (nx - 1) * BSG_TILE_GROUP_X_DIM),
+                blk_x_step(TRANSPOSE ? BSG_TILE_GROUP_X_DIM * block_size_y : BSG_TILE_GROUP_X_DIM),
+                blk_y_step(TRANSPOSE ?
+                           BSG_TILE_GROUP_Y_DIM - (nx - 1) * BSG_TILE_GROUP_X_DIM * block_size_y :
+                           BSG_TILE_GROUP_Y_DIM * block_size_x - (nx - 1) * BSG_TILE_GROUP_X_DIM),
+                mat(__bsg_y * ld + __bsg_x),
+                blk(TRANSPOSE ? __bsg_x * block_size_y + __bsg_y : __bsg_y * block_size_x + __bsg_x) {}
+
+        // Column of the current element among this tile's columns
+        uint32_t column() const { return x; }
+
+        void next() {
+                if (++x == nx) {
+                        x = 0;
+                        mat += mat_y_step;
+                        blk += blk_y_step;
+                } else {
+                        mat += mat_x_step;
+                        blk += blk_x_step;
+                }
+        }
+};
+
+// Number of the indices i, i + step, i + 2 * step, ... that are less
+// than n
+inline uint32_t block_copy_count(uint32_t i, uint32_t n, uint32_t step) {
+        return n > i ? (n - i + step - 1) / step : 0;
+}
+
+/*
+ * Copy the block_size_y x block_size_x block of A (M x N) at block
+ * coordinates (sub_block_y, sub_block_x) into dst, or its transpose if
+ * TRANSPOSE. Elements outside of A are zero.
+ */
+template <uint32_t F, bool TRANSPOSE, typename T>
+void __attribute__ ((noinline)) block_copy_to_shmem (const T *A, T *dst, uint32_t M, uint32_t N,
+                                                      uint32_t block_size_y, uint32_t block_size_x,
+                                                      uint32_t sub_block_y, uint32_t sub_block_x) {
+        uint32_t start_y = sub_block_y * block_size_y;
+        uint32_t start_x = sub_block_x * block_size_x;
+
+        // This tile's rows and columns of the block, and how many of
+        // them are inside A
+        uint32_t ny = block_copy_count(__bsg_y, block_size_y, BSG_TILE_GROUP_Y_DIM);
+        uint32_t nx = block_copy_count(__bsg_x, block_size_x, BSG_TILE_GROUP_X_DIM);
+        uint32_t nyv = M > start_y ? block_copy_count(__bsg_y, M - start_y, BSG_TILE_GROUP_Y_DIM) : 0;
+        uint32_t nxv = N > start_x ? block_copy_count(__bsg_x, N - start_x, BSG_TILE_GROUP_X_DIM) : 0;
+        nyv = nyv < ny ? nyv : ny;
+        nxv = nxv < nx ? nxv : nx;
+        if (!nx)
+                return;
+
+        const T *src = &A[start_y * N + start_x];
+        block_copy_iterator<TRANSPOSE> it(N, nx, block_size_y, block_size_x);
+
+        // Elements before end are inside A, unless their column is
+        // not
+        uint32_t total = ny * nx, end = nyv * nx;
+        for (uint32_t i = 0; i < total; ) {
+                uint32_t n = total - i < F ? total - i : F;
+                // Zeroed so that the elements past n (which are never
+                // stored) are initialized
+                T val[F] = {};
+                uint32_t off[F] = {};
+
+                // Issue the loads...
+#pragma GCC unroll 32
+                for (uint32_t f = 0; f < F; ++f) {
+                        if (f < n) {
+                                if (i + f < end && it.column() < nxv)
+                                        val[f] = src[it.mat];
+                                off[f] = it.blk;
+                                it.next();
+                        }
+                }
+
+                asm volatile ("" ::: "memory");
+
+                // ...and then the stores that use them
+#pragma GCC unroll 32
+                for (uint32_t f = 0; f < F; ++f) {
+                        if (f < n)
+                                bsg_tile_group_shared_store (T, dst, off[f], val[f]);
+                }
+                i += n;
+        }
+}
+
+/*
+ * Copy src into the block_size_y x block_size_x block of A (M x N) at
+ * block coordinates (sub_block_y, sub_block_x). Elements outside of A
+ * are dropped.
+ */
+template <uint32_t F, typename T>
+void __attribute__ ((noinline)) block_copy_from_shmem (T *A, T *src, uint32_t M, uint32_t N,
+                                                        uint32_t block_size_y, uint32_t block_size_x,
+                                                        uint32_t sub_block_y, uint32_t sub_block_x) {
+        uint32_t start_y = sub_block_y * block_size_y;
+        uint32_t start_x = sub_block_x * block_size_x;
+
+        // This tile's rows and columns of the block that are inside A
+        uint32_t ny = M > start_y ? block_copy_count(__bsg_y, M - start_y, BSG_TILE_GROUP_Y_DIM) : 0;
+        uint32_t nx = N > start_x ? block_copy_count(__bsg_x, N - start_x, BSG_TILE_GROUP_X_DIM) : 0;
+        uint32_t by = block_copy_count(__bsg_y, block_size_y, BSG_TILE_GROUP_Y_DIM);
+        uint32_t bx = block_copy_count(__bsg_x, block_size_x, BSG_TILE_GROUP_X_DIM);
+        ny = ny < by ? ny : by;
+        nx = nx < bx ? nx : bx;
+        if (!nx)
+                return;
+
+        T *dst = &A[start_y * N + start_x];
+        block_copy_iterator<false> it(N, nx, block_size_y, block_size_x);
+
+        uint32_t total = ny * nx;
+        for (uint32_t i = 0; i < total; ) {
+                uint32_t n = total - i < F ? total - i : F;
+                // Zeroed so that the elements past n (which are never
+                // stored) are initialized
+                T val[F] = {};
+                uint32_t off[F] = {};
+
+                // Issue the (remote) loads...
+#pragma GCC unroll 32
+                for (uint32_t f = 0; f < F; ++f) {
+                        if (f < n) {
+                                bsg_tile_group_shared_load (T, src, it.blk, val[f]);
+                                off[f] = it.mat;
+                                it.next();
+                        }
+                }
+
+                asm volatile ("" ::: "memory");
+
+                // ...and then the stores that use them
+#pragma GCC unroll 32
+                for (uint32_t f = 0; f < F; ++f) {
+                        if (f < n)
+                                dst[off[f]] = val[f];
+                }
+                i += n;
+        }
+}
+
+#endif
@@ -0,0 +1,175 @@
+/*
+ * This kernel performs matrix multiplication, double-buffering the
+ * blocks of A and B in tile group shared memory (as Version 2), and
+ * copying the blocks with block_copy_to_shmem and
+ * block_copy_from_shmem (See block_copy.hpp).
+ *
+ * The copies into shared memory are tagged 1 and the copy out is
+ * tagged 2. To compare them with Version 2 in cycles per element, run
+ * `make kernel/v2/stats kernel/v3/stats` and divide the cycles of each
+ * tag by the elements that each tile copies: each tile group copies
+ * block_size_y * N + N * block_size_x elements in (tag 1, rounding N up
+ * to a multiple of BLOCK_WIDTH) and block_size_y * block_size_x out
+ * (tag 2), split between its tiles.
+ */
+
+// BSG_TILE_GROUP_X_DIM and BSG_TILE_GROUP_Y_DIM must be defined
+// before bsg_manycore.h and bsg_tile_group_barrier.h are
+// included. bsg_tiles_X and bsg_tiles_Y must also be defined for
+// legacy reasons, but they are deprecated.
+#define BSG_TILE_GROUP_X_DIM 2
+#define BSG_TILE_GROUP_Y_DIM 2
+#define bsg_tiles_X BSG_TILE_GROUP_X_DIM
+#define bsg_tiles_Y BSG_TILE_GROUP_Y_DIM
+#include <bsg_manycore.h>
+#include <bsg_tile_group_barrier.h>
+#include <cstdint>
+
+#include <matrix_multiply.hpp>
+#include <block_copy.hpp>
+
+// Width of the blocks of A (and height of the blocks of B) that are
+// copied into shared memory at a time
+#ifndef BLOCK_WIDTH
+#define BLOCK_WIDTH 4
+#endif
+
+// Loads in flight in block_copy_to_shmem and block_copy_from_shmem
+#ifndef BLOCK_COPY_FACTOR
+#define BLOCK_COPY_FACTOR 8
+#endif
+
+// I <3 Hacks! Since bsg_manycore_arch.h can't handle the awesomeness
+// of C++ templates I wrote this temporary replacement.
+#ifdef bsg_tile_group_remote_ptr
+#undef bsg_tile_group_remote_ptr
+#include <type_traits>
+#define bsg_tile_group_remote_ptr(__type,x,y,local_addr) \
+        ( (typename std::add_pointer<__type>::type)                     \
+        (   (REMOTE_EPA_PREFIX << REMOTE_EPA_MASK_SHIFTS)               \
+            | ((y) << Y_CORD_SHIFTS )                                   \
+            | ((x) << X_CORD_SHIFTS )                                   \
+            | ((uint32_t) (local_addr)   )                              \
+            )                                                           \
+                                                           )
+#endif
+
+INIT_TILE_GROUP_BARRIER(r_barrier, c_barrier,
+                        0, BSG_TILE_GROUP_X_DIM-1,
+                        0, BSG_TILE_GROUP_Y_DIM-1);
+
+
+template <uint32_t BW, typename TA, typename TB, typename TC>
+void __attribute__ ((noinline)) subblock_shmem_matrix_mul_transposed (TA *A, TB *B, TC *C, uint32_t block_size_y, uint32_t block_size_x, uint32_t block_num) {
+
+        for (uint32_t iter_y = __bsg_y; iter_y < block_size_y; iter_y += BSG_TILE_GROUP_Y_DIM) {
+                for (uint32_t iter_x = __bsg_x; iter_x < block_size_x; iter_x += BSG_TILE_GROUP_X_DIM) {
+
+                        TC sum = static_cast<TC>(0);
+                        TA lc_A;
+                        TB lc_B;
+                        TC lc_C;
+#pragma GCC unroll 8
+                        for (uint32_t k = 0; k < BW; k ++) {
+                                // lc_A <-- A[iter_y][k]
+                                bsg_tile_group_shared_load (TA, A, (iter_y * BW + k), lc_A);
+                                // lc_B <-- B[k][iter_x] remember, B is transposed
+                                bsg_tile_group_shared_load (TB, B, (iter_x * BW + k), lc_B);
+                                sum += lc_A * lc_B;
+                        }
+
+                        if (!block_num) {
+                                // C[iter_y][iter_x] <-- sum
+                                bsg_tile_group_shared_store (TC, C, (iter_y * block_size_x + iter_x), sum);
+                        }
+                        else {
+                                // C[iter_y][iter_x] += sum
+                                bsg_tile_group_shared_load (TC, C, (iter_y * block_size_x + iter_x), lc_C);
+                                bsg_tile_group_shared_store (TC, C, (iter_y * block_size_x + iter_x), lc_C + sum);
+                        }
+                }
+        }
+        return;
+}
+
+/*
+ * C (M x P) = A (M x N) * B (N x P), with one block_size_y x
+ * block_size_x block of C per tile group. A and B are copied into
+ * shared memory BW (a template parameter) columns/rows at a time, into
+ * two pairs of buffers: while the tile group computes with block
+ * block_num in one pair, it copies block block_num + 1 into the other,
+ * so the copies overlap with the computation and only one barrier is
+ * needed per block. The last block may be partial (N need not be a
+ * multiple of BW), and so may the blocks of C at the bottom and right
+ * edges: elements outside of A and B are zero, and elements outside of
+ * C are not written.
+ */
+template <uint32_t BW, typename TA, typename TB, typename TC>
+int __attribute__ ((noinline)) matrix_multiply_group_shared_mem_double_buffered(TA *A, TB *B, TC *C,
+                                                                                 uint32_t M, uint32_t N, uint32_t P,
+                                                                                 uint32_t block_size_y, uint32_t block_size_x) {
+
+        // declare tile-group shared memory: two buffers each for A
+        // and B, and one for C
+        bsg_tile_group_shared_mem (TA, sh_A0, (block_size_y * BW));
+        bsg_tile_group_shared_mem (TA, sh_A1, (block_size_y * BW));
+        bsg_tile_group_shared_mem (TB, sh_B0, (BW * block_size_x));
+        bsg_tile_group_shared_mem (TB, sh_B1, (BW * block_size_x));
+        bsg_tile_group_shared_mem (TC, sh_C, (block_size_y * block_size_x));
+
+        TA *sh_A[2] = {sh_A0, sh_A1};
+        TB *sh_B[2] = {sh_B0, sh_B1};
+
+        uint32_t num_blocks = (N + BW - 1) / BW;
+
+        bsg_cuda_print_stat_start(1);
+        block_copy_to_shmem<BLOCK_COPY_FACTOR, false> (A, sh_A[0], M, N, block_size_y, BW, __bsg_tile_group_id_y, 0);
+        block_copy_to_shmem<BLOCK_COPY_FACTOR, true> (B, sh_B[0], N, P, BW, block_size_x, 0, __bsg_tile_group_id_x);
+        bsg_cuda_print_stat_end(1);
+        bsg_tile_group_barrier (&r_barrier, &c_barrier);
+
+        for (uint32_t block_num = 0; block_num < num_blocks; block_num ++) {
+                uint32_t cur = block_num & 1, next = cur ^ 1;
+
+                // Prefetch the next block into the other buffers. The
+                // barrier at the end of the previous iteration
+                // guarantees that every tile is done reading them.
+                if (block_num + 1 < num_blocks) {
+                        bsg_cuda_print_stat_start(1);
+                        block_copy_to_shmem<BLOCK_COPY_FACTOR, false> (A, sh_A[next], M, N, block_size_y, BW, __bsg_tile_group_id_y, block_num + 1);
+                        block_copy_to_shmem<BLOCK_COPY_FACTOR, true> (B, sh_B[next], N, P, BW, block_size_x, block_num + 1, __bsg_tile_group_id_x);
+                        bsg_cuda_print_stat_end(1);
+                }
+
+                subblock_shmem_matrix_mul_transposed<BW> (sh_A[cur], sh_B[cur], sh_C, block_size_y, block_size_x, block_num);
+
+                bsg_tile_group_barrier (&r_barrier, &c_barrier);
+        }
+
+        bsg_cuda_print_stat_start(2);
+        block_copy_from_shmem<BLOCK_COPY_FACTOR> (C, sh_C, M, P, block_size_y, block_size_x, __bsg_tile_group_id_y, __bsg_tile_group_id_x);
+        bsg_cuda_print_stat_end(2);
+
+        return 0;
+}
+
+extern "C" {
+        int  __attribute__ ((noinline)) kernel_matrix_multiply(
+                      float *A, float *B, float *C,
+                      uint32_t A_HEIGHT, uint32_t A_WIDTH, uint32_t B_WIDTH,
+                      uint32_t block_size_y, uint32_t block_size_x) {
+                int rc;
+
+                bsg_cuda_print_stat_kernel_start();
+                bsg_cuda_print_stat_start(0);
+                rc = matrix_multiply_group_shared_mem_double_buffered<BLOCK_WIDTH>(A, B, C,
+                                                                                   A_HEIGHT, A_WIDTH, B_WIDTH,
+                                                                                   block_size_y, block_size_x);
+                bsg_cuda_print_stat_end(0);
+
+                bsg_tile_group_barrier(&r_barrier, &c_barrier);
+                bsg_cuda_print_stat_kernel_end();
+
+                return rc;
+        }
+}
@@ -0,0 +1,203 @@
+/*
+ * This kernel performs matrix multiplication on a systolic array of
+ * tiles. Each tile group computes a block of block_size_y x
+ * block_size_x (16 x 16) elements of C, and each of its tiles computes
+ * a SYS_TILE x SYS_TILE (4 x 4) sub-block, which it accumulates in
+ * registers.
+ *
+ * A and B are read in slots of SYS_TILE x SYS_TILE elements (columns
+ * k to k + SYS_TILE of A, and rows k to k + SYS_TILE of B). The tiles
+ * in column 0 load the slots of A of their rows from DRAM, and the
+ * tiles in row 0 load the slots of B of their columns. Every tile
+ * passes the slots of A to the tile on its right, and the slots of B
+ * to the tile below, through the credit-based FIFOs of
+ * bsg_circular_buffer.hpp (CreditSource and CreditDest), so A streams
+ * left-to-right and B top-to-bottom. Partial slots at the edges of A
+ * and B are zero-padded, so this kernel takes any size.
+ *
+ * Each element of A is read from DRAM once per tile group column of
+ * the grid, and each element of B once per tile group row. With
+ * 16 x 16 blocks, the model below gives a quarter of the DRAM loads of
+ * Version 1 (4 x 4 blocks):
+ *
+ *   Version 1: M * N * ceil(P / 4) + N * P * ceil(M / 4) loads
+ *   Version 4: M * N * ceil(P / 16) + N * P * ceil(M / 16) loads
+ *
+ * plus M * P stores of C. The host prints the modelled count for the
+ * version that runs. It has not been measured: to compare the versions,
+ * run `make kernel/v1/stats kernel/v4/stats` and compare the kernel
+ * cycles.
+ */
+
+// BSG_TILE_GROUP_X_DIM and BSG_TILE_GROUP_Y_DIM must be defined
+// before bsg_manycore.h and bsg_tile_group_barrier.h are
+// included. bsg_tiles_X and bsg_tiles_Y must also be defined for
+// legacy reasons, but they are deprecated.
+#define BSG_TILE_GROUP_X_DIM 4
+#define BSG_TILE_GROUP_Y_DIM 4
+#define bsg_tiles_X BSG_TILE_GROUP_X_DIM
+#define bsg_tiles_Y BSG_TILE_GROUP_Y_DIM
+#include <bsg_manycore.h>
+#include <bsg_tile_group_barrier.h>
+#include <cstdint>
+
+#include <bsg_circular_buffer.hpp>
+
+// Rows and columns of C computed by each tile, and columns of A (rows
+// of B) in each slot
+#define SYS_TILE 4
+
+// Elements per slot, and slots per FIFO
+#define SYS_SLOT (SYS_TILE * SYS_TILE)
+#define SYS_DEPTH 4
+
+INIT_TILE_GROUP_BARRIER(r_barrier, c_barrier,
+                        0, BSG_TILE_GROUP_X_DIM-1,
+                        0, BSG_TILE_GROUP_Y_DIM-1);
+
+// Channel ids: the FIFO to the right of tile (x, y), and the FIFO below
+// it
+constexpr unsigned int sys_right(unsigned int x, unsigned int y) {
+        return y * bsg_tiles_X + x;
+}
+
+constexpr unsigned int sys_down(unsigned int x, unsigned int y) {
+        return bsg_tiles_X * bsg_tiles_Y + y * bsg_tiles_X + x;
+}
+
+// Copy the SYS_TILE x SYS_TILE slot of A (M x N) at (y, x) into dst,
+// with zeros outside of A
+template <typename T>
+void __attribute__ ((noinline)) sys_load_slot(const T *A, T *dst, uint32_t M, uint32_t N, uint32_t y, uint32_t x) {
+        for (uint32_t r = 0; r < SYS_TILE; r++) {
+#pragma GCC unroll 4
+                for (uint32_t c = 0; c < SYS_TILE; c++) {
+                        dst[r * SYS_TILE + c] = (y + r < M && x + c < N) ?
+                                A[(y + r) * N + x + c] : static_cast<T>(0);
+                }
+        }
+}
+
+template <typename TA, typename TB, typename TC>
+int __attribute__ ((noinline)) matrix_multiply_systolic(const TA *A, const TB *B, TC *C,
+                                                         uint32_t M, uint32_t N, uint32_t P,
+                                                         uint32_t block_size_y, uint32_t block_size_x) {
+
+        // The rows of A and columns of B of this tile
+        const uint32_t y0 = __bsg_tile_group_id_y * block_size_y + __bsg_y * SYS_TILE;
+        const uint32_t x0 = __bsg_tile_group_id_x * block_size_x + __bsg_x * SYS_TILE;
+
+        const bool left = __bsg_x == 0, top = __bsg_y == 0;
+        const bool right = __bsg_x == bsg_tiles_X - 1, bottom = __bsg_y == bsg_tiles_Y - 1;
+
+        // Open ALL of the FIFOs of this tile, and THEN call init_wait
+        // on each of them.
+        CircularBuffer::CreditDest<TA, SYS_SLOT, SYS_DEPTH> A_in;
+        CircularBuffer::CreditDest<TB, SYS_SLOT, SYS_DEPTH> B_in;
+        CircularBuffer::CreditSource<TA, SYS_SLOT, SYS_DEPTH> A_out;
+        CircularBuffer::CreditSource<TB, SYS_SLOT, SYS_DEPTH> B_out;
+
+        if (!left)
+                A_in.open(sys_right(__bsg_x - 1, __bsg_y), __bsg_y, __bsg_x - 1);
+        if (!top)
+                B_in.open(sys_down(__bsg_x, __bsg_y - 1), __bsg_y - 1, __bsg_x);
+        if (!right)
+                A_out.open(sys_right(__bsg_x, __bsg_y), __bsg_y, __bsg_x + 1);
+        if (!bottom)
+                B_out.open(sys_down(__bsg_x, __bsg_y), __bsg_y + 1, __bsg_x);
+
+        if (!left)
+                A_in.init_wait();
+        if (!top)
+                B_in.init_wait();
+        if (!right)
+                A_out.init_wait();
+        if (!bottom)
+                B_out.init_wait();
+
+        TC sum[SYS_TILE][SYS_TILE];
+#pragma GCC unroll 4
+        for (uint32_t r = 0; r < SYS_TILE; r++) {
+#pragma GCC unroll 4
+                for (uint32_t c = 0; c < SYS_TILE; c++) {
+                        sum[r][c] = static_cast<TC>(0);
+                }
+        }
+
+        TA lc_A[SYS_SLOT];
+        TB lc_B[SYS_SLOT];
+        for (uint32_t k = 0; k < N; k += SYS_TILE) {
+                // Take the slots of A and B from DRAM at the edges, and
+                // from the neighbouring tiles elsewhere, and pass them on
+                const TA *sl_A = lc_A;
+                const TB *sl_B = lc_B;
+                if (left)
+                        sys_load_slot(A, lc_A, M, N, y0, k);
+                else
+                        sl_A = A_in.obtain_rd_ptr_wait();
+
+                if (top)
+                        sys_load_slot(B, lc_B, N, P, k, x0);
+                else
+                        sl_B = B_in.obtain_rd_ptr_wait();
+
+                if (!right)
+                        A_out.send(sl_A);
+                if (!bottom)
+                        B_out.send(sl_B);
+
+#pragma GCC unroll 4
+                for (uint32_t kk = 0; kk < SYS_TILE; kk++) {
+#pragma GCC unroll 4
+                        for (uint32_t r = 0; r < SYS_TILE; r++) {
+#pragma GCC unroll 4
+                                for (uint32_t c = 0; c < SYS_TILE; c++) {
+                                        sum[r][c] += sl_A[r * SYS_TILE + kk] * sl_B[kk * SYS_TILE + c];
+                                }
+                        }
+                }
+
+                if (!left)
+                        A_in.finish_rd_ptr();
+                if (!top)
+                        B_in.finish_rd_ptr();
+        }
+
+        for (uint32_t r = 0; r < SYS_TILE && y0 + r < M; r++) {
+                for (uint32_t c = 0; c < SYS_TILE && x0 + c < P; c++) {
+                        C[(y0 + r) * P + x0 + c] = sum[r][c];
+                }
+        }
+
+        return 0;
+}
+
+extern "C" {
+        int  __attribute__ ((noinline)) kernel_matrix_multiply(
+                      float *A, float *B, float *C,
+                      uint32_t A_HEIGHT, uint32_t A_WIDTH, uint32_t B_WIDTH,
+                      uint32_t block_size_y, uint32_t block_size_x) {
+                int rc;
+
+                // Each tile computes SYS_TILE x SYS_TILE elements of
+                // the block
+                if (block_size_y != bsg_tiles_Y * SYS_TILE ||
+                    block_size_x != bsg_tiles_X * SYS_TILE) {
+                        bsg_print_hexadecimal(0xC0DE5A04);
+                        bsg_tile_group_barrier(&r_barrier, &c_barrier);
+                        return -1;
+                }
+
+                bsg_cuda_print_stat_kernel_start();
+                bsg_cuda_print_stat_start(0);
+                rc = matrix_multiply_systolic(A, B, C,
+                                              A_HEIGHT, A_WIDTH, B_WIDTH,
+                                              block_size_y, block_size_x);
+                bsg_cuda_print_stat_end(0);
+
+                bsg_tile_group_barrier(&r_barrier, &c_barrier);
+                bsg_cuda_print_stat_kernel_end();
+
+                return rc;
+        }
+}
@@ -0,0 +1,241 @@
+// Copyright (c) 2020, University of Washington All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+// 
+// Redistributions of source code must retain the above copyright notice, this list
+// of conditions and the following disclaimer.
+// 
+// Redistributions in binary form must reproduce the above copyright notice, this
+// list of conditions and the following disclaimer in the documentation and/or
+// other materials provided with the distribution.
+// 
+// Neither the name of the copyright holder nor the names of its contributors may
+// be used to endorse or promote products derived from this software without
+// specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+// ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef __HOST_BUFFER_HPP
+#define __HOST_BUFFER_HPP
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <sys/mman.h>
+
+/*
+ * Heap-backed host buffers for the example host programs.
+ *
+ * host_buffer<T> replaces stack arrays (which overflow the stack after a
+ * few MB) and std::vector (which is not aligned, and allocates and
+ * zeroes new memory on every run_test call). Buffers are:
+ *
+ * - 64-byte (cache line) aligned.
+ *
+ * - Backed by huge pages when they are at least HOST_BUFFER_HUGE_SIZE
+ *   bytes: they are 2 MB aligned and madvise()d for transparent huge
+ *   pages, or allocated from hugetlbfs if the BSG_HOST_HUGETLB
+ *   environment variable is set (and hugetlbfs pages are available).
+ *
+ * - Returned to a process-wide pool when they are destroyed, and reused
+ *   for later buffers of similar size, so repeated tests do not churn
+ *   the allocator or re-fault their pages. At most HOST_BUFFER_POOL_MAX
+ *   bytes are kept in the pool.
+ *
+ * Like std::vector, new buffers are zero-initialized.
+ */
+
+#define HOST_BUFFER_ALIGN     64
+#define HOST_BUFFER_HUGE_SIZE (2ul << 20)
+
+#ifndef HOST_BUFFER_POOL_MAX
+#define HOST_BUFFER_POOL_MAX  (1ul << 30)
+#endif
+
+class host_buffer_pool {
+public:
+        static host_buffer_pool &instance() {
+                static host_buffer_pool pool;
+                return pool;
+        }
+
+        // Return a block of at least bytes bytes, and its capacity
+        void *acquire(size_t bytes, size_t *capacity) {
+                size_t cap = round_up(bytes ? bytes : 1);
+                {
+                        std::lock_guard<std::mutex> guard(mutex);
+                        // Reuse the smallest cached block that fits,
+                        // unless it is more than twice as large
+                        auto it = free_blocks.lower_bound(cap);
+                        if (it != free_blocks.end() && it->first <= 2 * cap) {
+                                void *p = it->second;
+                                *capacity = it->first;
+                                cached -= it->first;
+                                free_blocks.erase(it);
+                                memset(p, 0, bytes);
+                                return p;
+                        }
+                }
+
+                void *p = allocate(cap);
+                if (!p)
+                        return nullptr;
+                *capacity = cap;
+                return p;
+        }
+
+        // Give a block back to the pool
+        void release(void *p, size_t capacity) {
+                std::lock_guard<std::mutex> guard(mutex);
+                if (cached + capacity > HOST_BUFFER_POOL_MAX) {
+                        deallocate(p, capacity);
+                        return;
+                }
+                free_blocks.emplace(capacity, p);
+                cached += capacity;
+        }
+
+        // Free every cached block
+        void trim() {
+                std::lock_guard<std::mutex> guard(mutex);
+                for (auto &b : free_blocks)
+                        deallocate(b.second, b.first);
+                free_blocks.clear();
+                cached = 0;
+        }
+
+        ~host_buffer_pool() {
+                trim();
+        }
+
+private:
+        std::mutex mutex;
+        std::multimap<size_t, void *> free_blocks;
+        size_t cached = 0;
+
+        host_buffer_pool() {}
+        host_buffer_pool(const host_buffer_pool &) = delete;
+        host_buffer_pool &operator=(const host_buffer_pool &) = delete;
+
+        static size_t round_up(size_t bytes) {
+                size_t align = bytes >= HOST_BUFFER_HUGE_SIZE ?
+                        HOST_BUFFER_HUGE_SIZE : HOST_BUFFER_ALIGN;
+                return (bytes + align - 1) / align * align;
+        }
+
+        // Blocks are zero-filled on allocation
+        static void *allocate(size_t cap) {
+                if (cap < HOST_BUFFER_HUGE_SIZE) {
+                        void *p;
+                        if (posix_memalign(&p, HOST_BUFFER_ALIGN, cap))
+                                return nullptr;
+                        return memset(p, 0, cap);
+                }
+
+#ifdef MAP_HUGETLB
+                if (getenv("BSG_HOST_HUGETLB")) {
+                        void *p = mmap(nullptr, cap, PROT_READ | PROT_WRITE,
+                                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+                        if (p != MAP_FAILED)
+                                return p;
+                }
+#endif
+                // Over-allocate, and trim the mapping to a 2 MB
+                // aligned range so that it can use huge pages
+                size_t len = cap + HOST_BUFFER_HUGE_SIZE;
+                void *m = mmap(nullptr, len, PROT_READ | PROT_WRITE,
+                               MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+                if (m == MAP_FAILED)
+                        return nullptr;
+
+                uintptr_t base = reinterpret_cast<uintptr_t>(m);
+                uintptr_t p = (base + HOST_BUFFER_HUGE_SIZE - 1) & ~(HOST_BUFFER_HUGE_SIZE - 1);
+                if (p != base)
+                        munmap(m, p - base);
+                if (base + len != p + cap)
+                        munmap(reinterpret_cast<void *>(p + cap), base + len - (p + cap));
+#ifdef MADV_HUGEPAGE
+                madvise(reinterpret_cast<void *>(p), cap, MADV_HUGEPAGE);
+#endif
+                return reinterpret_cast<void *>(p);
+        }
+
+        static void deallocate(void *p, size_t cap) {
+                if (cap < HOST_BUFFER_HUGE_SIZE)
+                        free(p);
+                else
+                        munmap(p, cap);
+        }
+};
+
+template <typename T>
+class host_buffer {
+        static_assert(std::is_trivial<T>::value,
+                      "host_buffer elements must be trivial types");
+public:
+        host_buffer() : ptr(nullptr), n(0), capacity(0) {}
+
+        // Allocate n zero-initialized elements. Throws std::bad_alloc
+        // if the allocation fails.
+        explicit host_buffer(size_t n) : n(n) {
+                ptr = static_cast<T *>(host_buffer_pool::instance().acquire(n * sizeof(T), &capacity));
+                if (!ptr)
+                        throw std::bad_alloc();
+        }
+
+        host_buffer(host_buffer &&o) : ptr(o.ptr), n(o.n), capacity(o.capacity) {
+                o.ptr = nullptr;
+                o.n = o.capacity = 0;
+        }
+
+        host_buffer &operator=(host_buffer &&o) {
+                std::swap(ptr, o.ptr);
+                std::swap(n, o.n);
+                std::swap(capacity, o.capacity);
+                return *this;
+        }
+
+        host_buffer(const host_buffer &) = delete;
+        host_buffer &operator=(const host_buffer &) = delete;
+
+        ~host_buffer() {
+                if (ptr)
+                        host_buffer_pool::instance().release(ptr, capacity);
+        }
+
+        T *data() { return ptr; }
+        const T *data() const { return ptr; }
+
+        size_t size() const { return n; }
+        size_t size_bytes() const { return n * sizeof(T); }
+
+        T &operator[](size_t i) { return ptr[i]; }
+        const T &operator[](size_t i) const { return ptr[i]; }
+
+        T *begin() { return ptr; }
+        T *end() { return ptr + n; }
+        const T *begin() const { return ptr; }
+        const T *end() const { return ptr + n; }
+
+private:
+        T *ptr;
+        size_t n;
+        size_t capacity;
+};
+
+#endif // __HOST_BUFFER_HPP
@@ -0,0 +1,210 @@
+// Copyright (c) 2020, University of Washington All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+// 
+// Redistributions of source code must retain the above copyright notice, this list
+// of conditions and the following disclaimer.
+// 
+// Redistributions in binary form must reproduce the above copyright notice, this
+// list of conditions and the following disclaimer in the documentation and/or
+// other materials provided with the distribution.
+// 
+// Neither the name of the copyright holder nor the names of its contributors may
+// be used to endorse or promote products derived from this software without
+// specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+// ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef __HOST_DATASET_HPP
+#define __HOST_DATASET_HPP
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <initializer_list>
+#include <string>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "common.h"
+#include "host_thread.hpp"
+
+/*
+ * An on-disk cache of example inputs and reference outputs.
+ *
+ * A host that generates its inputs and computes the known-correct
+ * result on the host can instead load both from a cache file, keyed by
+ * the example, the data type, the problem dimensions and the seed:
+ *
+ *     host_dataset cache("conv2d", "float", {M, N}, args.seed);
+ *     if (!cache.load({{"A", A.data(), A.size_bytes()}, ...})) {
+ *             // generate A ..., compute R ...
+ *             cache.store({{"A", A.data(), A.size_bytes()}, ...});
+ *     }
+ *
+ * The cache is enabled by setting the BSG_DATASET_CACHE environment
+ * variable to a directory; otherwise load() fails and store() does
+ * nothing. A file holds a header, a table of named sections and then
+ * each section, page aligned. load() maps the file and copies each
+ * section (in parallel), and only succeeds if the file has exactly the
+ * requested sections, with the requested sizes. store() writes a
+ * temporary file and renames it, so concurrent runs never see a
+ * partial file.
+ */
+
+#define HOST_DATASET_MAGIC "BSGDATA1"
+#define HOST_DATASET_ALIGN 4096
+#define HOST_DATASET_NAME_LEN 24
+
+struct host_dataset_section {
+        const char *name;
+        void *data;
+        size_t bytes;
+};
+
+class host_dataset {
+        struct file_header {
+                char magic[8];
+                uint64_t count;
+        };
+
+        struct file_section {
+                char name[HOST_DATASET_NAME_LEN];
+                uint64_t offset;
+                uint64_t bytes;
+        };
+
+        std::string file;
+
+        static uint64_t align(uint64_t off) {
+                return (off + HOST_DATASET_ALIGN - 1) / HOST_DATASET_ALIGN * HOST_DATASET_ALIGN;
+        }
+
+public:
+        host_dataset(const char *example, const char *dtype,
+                     std::initializer_list<uint64_t> dims, uint64_t seed) {
+                const char *dir = getenv("BSG_DATASET_CACHE");
+                if (!dir || !*dir)
+                        return;
+                mkdir(dir, 0777);
+
+                file = std::string(dir) + "/" + example + "-" + dtype + "-";
+                const char *sep = "";
+                for (uint64_t d : dims) {
+                        file += sep + std::to_string(d);
+                        sep = "x";
+                }
+                file += "-" + std::to_string(seed) + ".bin";
+        }
+
+        bool enabled() const {
+                return !file.empty();
+        }
+
+        const char *path() const {
+                return file.c_str();
+        }
+
+        // Copy each section of the cache file into its data. Returns
+        // true on a hit.
+        bool load(std::initializer_list<host_dataset_section> sections) {
+                if (!enabled())
+                        return false;
+                int fd = open(file.c_str(), O_RDONLY);
+                if (fd < 0)
+                        return false;
+                struct stat st;
+                if (fstat(fd, &st) || static_cast<size_t>(st.st_size) < sizeof(file_header)) {
+                        close(fd);
+                        return false;
+                }
+                size_t len = st.st_size;
+                void *map = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+                close(fd);
+                if (map == MAP_FAILED)
+                        return false;
+
+                const char *base = static_cast<const char *>(map);
+                const file_header *hdr = reinterpret_cast<const file_header *>(base);
+                const file_section *tab = reinterpret_cast<const file_section *>(hdr + 1);
+                bool hit = !memcmp(hdr->magic, HOST_DATASET_MAGIC, sizeof(hdr->magic)) &&
+                        hdr->count == sections.size() &&
+                        sizeof(*hdr) + sections.size() * sizeof(*tab) <= len;
+
+                size_t i = 0;
+                for (auto it = sections.begin(); hit && it != sections.end(); ++it, ++i)
+                        hit = !strncmp(tab[i].name, it->name, HOST_DATASET_NAME_LEN) &&
+                                tab[i].bytes == it->bytes &&
+                                tab[i].offset + tab[i].bytes <= len;
+
+                i = 0;
+                for (auto it = sections.begin(); hit && it != sections.end(); ++it, ++i) {
+                        const char *src = base + tab[i].offset;
+                        char *dst = static_cast<char *>(it->data);
+                        host_parallel_for(it->bytes, HOST_DATASET_ALIGN, 1 << 20,
+                                          [&](size_t begin, size_t end) {
+                                                  memcpy(dst + begin, src + begin, end - begin);
+                                          });
+                }
+                munmap(map, len);
+
+                if (hit)
+                        bsg_pr_test_info("Loaded inputs and reference outputs from %s\n",
+                                         file.c_str());
+                return hit;
+        }
+
+        // Write the sections to the cache file. Returns true on success.
+        bool store(std::initializer_list<host_dataset_section> sections) {
+                if (!enabled())
+                        return false;
+                std::string tmp = file + ".tmp." + std::to_string(getpid());
+                FILE *f = fopen(tmp.c_str(), "wb");
+                if (!f)
+                        return false;
+
+                file_header hdr;
+                memcpy(hdr.magic, HOST_DATASET_MAGIC, sizeof(hdr.magic));
+                hdr.count = sections.size();
+                bool ok = fwrite(&hdr, sizeof(hdr), 1, f) == 1;
+
+                uint64_t off = align(sizeof(hdr) + sections.size() * sizeof(file_section));
+                for (auto &s : sections) {
+                        file_section sec;
+                        memset(&sec, 0, sizeof(sec));
+                        strncpy(sec.name, s.name, HOST_DATASET_NAME_LEN - 1);
+                        sec.offset = off;
+                        sec.bytes = s.bytes;
+                        ok = ok && fwrite(&sec, sizeof(sec), 1, f) == 1;
+                        off = align(off + s.bytes);
+                }
+
+                for (auto &s : sections) {
+                        ok = ok && !fseek(f, align(ftell(f)), SEEK_SET);
+                        ok = ok && fwrite(s.data, 1, s.bytes, f) == s.bytes;
+                }
+                ok = !fclose(f) && ok;
+
+                if (ok && !rename(tmp.c_str(), file.c_str())) {
+                        bsg_pr_test_info("Stored inputs and reference outputs in %s\n",
+                                         file.c_str());
+                        return true;
+                }
+                unlink(tmp.c_str());
+                return false;
+        }
+};
+
+#endif // __HOST_DATASET_HPP
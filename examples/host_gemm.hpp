@@ -0,0 +1,272 @@
+// Copyright (c) 2020, University of Washington All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+// 
+// Redistributions of source code must retain the above copyright notice, this list
+// of conditions and the following disclaimer.
+// 
+// Redistributions in binary form must reproduce the above copyright notice, this
+// list of conditions and the following disclaimer in the documentation and/or
+// other materials provided with the distribution.
+// 
+// Neither the name of the copyright holder nor the names of its contributors may
+// be used to endorse or promote products derived from this software without
+// specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+// ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef __HOST_GEMM_HPP
+#define __HOST_GEMM_HPP
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include "host_thread.hpp"
+
+/*
+ * Host reference GEMM, shared by the matrix multiplication examples.
+ *
+ * matrix_mult(A, B, C, M, N, P) computes C (M x P) = A (M x N) * B (N x
+ * P), all row-major. It is cache blocked (MC x KC panels of A, KC x NC
+ * panels of B), register blocked (an MR x NR micro-kernel written with
+ * GCC vector extensions, so it vectorizes for whatever SIMD width the
+ * host has) and split across threads by MC x NC tiles of C.
+ *
+ * The result matches the naive triple loop that the examples used to
+ * carry, and therefore the device kernels:
+ *
+ * - Floating-point products are accumulated into each element of C in
+ *   the same (ascending k) order, so results are bit-identical.
+ *
+ * - Integer products are accumulated in unsigned 32-bit (or 64-bit)
+ *   arithmetic and truncated to TC. Truncation is a ring homomorphism,
+ *   so this gives exactly the wraparound of a device kernel that
+ *   accumulates into an int8_t/int16_t/int32_t TC.
+ *
+ * The number of threads is host_threads() (see host_thread.hpp). Small
+ * problems are run on the calling thread.
+ */
+
+// Width of the SIMD vectors used by the micro-kernel, in bytes. This
+// should match the target: GCC lowers wider vectors poorly.
+#ifndef HOST_GEMM_VECTOR_BYTES
+#if defined(__AVX512F__)
+#define HOST_GEMM_VECTOR_BYTES 64
+#elif defined(__AVX__)
+#define HOST_GEMM_VECTOR_BYTES 32
+#else
+#define HOST_GEMM_VECTOR_BYTES 16
+#endif
+#endif
+
+// Rows of C computed by the micro-kernel
+#ifndef HOST_GEMM_MR
+#define HOST_GEMM_MR 4
+#endif
+
+// Cache block sizes: rows of A, the shared dimension, and columns of B
+#define HOST_GEMM_MC 128
+#define HOST_GEMM_KC 256
+#define HOST_GEMM_NC 256
+
+// Problems with fewer multiply-accumulates than this are not threaded
+#define HOST_GEMM_THREAD_MIN_MACS (1 << 20)
+
+// The type that products are accumulated in (see above)
+template <typename TC, bool = std::is_floating_point<TC>::value>
+struct host_gemm_acc {
+        typedef TC type;
+};
+
+template <typename TC>
+struct host_gemm_acc<TC, false> {
+        typedef typename std::conditional<(sizeof(TC) > sizeof(uint32_t)),
+                                          uint64_t, uint32_t>::type type;
+};
+
+template <typename TA, typename TB, typename TC>
+class host_gemm {
+        typedef typename host_gemm_acc<TC>::type acc_t;
+        typedef acc_t vec_t __attribute__((vector_size(HOST_GEMM_VECTOR_BYTES)));
+
+        enum : size_t {
+                VL = HOST_GEMM_VECTOR_BYTES / sizeof(acc_t),
+                MR = HOST_GEMM_MR,
+                NR = 2 * VL,
+                MC = HOST_GEMM_MC,
+                KC = HOST_GEMM_KC,
+                NC = (HOST_GEMM_NC + NR - 1) / NR * NR
+        };
+
+        const TA *A;
+        const TB *B;
+        TC *C;
+        const size_t M, N, P;
+
+        // Pack rows [ic, ic + mc) x columns [pc, pc + kc) of A into
+        // MR-row panels, each stored k-major and zero padded to MR rows.
+        void pack_a(acc_t *pa, size_t ic, size_t mc, size_t pc, size_t kc) const {
+                for (size_t ir = 0; ir < mc; ir += MR) {
+                        size_t mr = std::min<size_t>(MR, mc - ir);
+                        for (size_t k = 0; k < kc; ++k) {
+                                const TA *a = &A[(ic + ir) * N + pc + k];
+                                for (size_t i = 0; i < mr; ++i)
+                                        pa[i] = static_cast<acc_t>(a[i * N]);
+                                for (size_t i = mr; i < MR; ++i)
+                                        pa[i] = 0;
+                                pa += MR;
+                        }
+                }
+        }
+
+        // Pack rows [pc, pc + kc) x columns [jc, jc + nc) of B into
+        // NR-column panels, each stored k-major and zero padded to NR
+        // columns.
+        void pack_b(acc_t *pb, size_t pc, size_t kc, size_t jc, size_t nc) const {
+                for (size_t jr = 0; jr < nc; jr += NR) {
+                        size_t nr = std::min<size_t>(NR, nc - jr);
+                        for (size_t k = 0; k < kc; ++k) {
+                                const TB *b = &B[(pc + k) * P + jc + jr];
+                                for (size_t j = 0; j < nr; ++j)
+                                        pb[j] = static_cast<acc_t>(b[j]);
+                                for (size_t j = nr; j < NR; ++j)
+                                        pb[j] = 0;
+                                pb += NR;
+                        }
+                }
+        }
+
+        // c (MR x NR, row-major) += packed A panel * packed B panel
+        static void micro_kernel(size_t kc, const acc_t *pa, const acc_t *pb, acc_t *c) {
+                vec_t acc[MR][2];
+                for (size_t i = 0; i < MR; ++i) {
+                        memcpy(&acc[i][0], &c[i * NR], sizeof(vec_t));
+                        memcpy(&acc[i][1], &c[i * NR + VL], sizeof(vec_t));
+                }
+
+                for (size_t k = 0; k < kc; ++k, pa += MR, pb += NR) {
+                        vec_t b0, b1;
+                        memcpy(&b0, &pb[0], sizeof(vec_t));
+                        memcpy(&b1, &pb[VL], sizeof(vec_t));
+                        for (size_t i = 0; i < MR; ++i) {
+                                acc[i][0] += b0 * pa[i];
+                                acc[i][1] += b1 * pa[i];
+                        }
+                }
+
+                for (size_t i = 0; i < MR; ++i) {
+                        memcpy(&c[i * NR], &acc[i][0], sizeof(vec_t));
+                        memcpy(&c[i * NR + VL], &acc[i][1], sizeof(vec_t));
+                }
+        }
+
+        // Compute the tile C[ic, ic + mc) x [jc, jc + nc)
+        void tile(size_t ic, size_t mc, size_t jc, size_t nc,
+                  std::vector<acc_t> &pa, std::vector<acc_t> &pb) const {
+                acc_t c[MR * NR];
+                for (size_t pc = 0; pc < N; pc += KC) {
+                        size_t kc = std::min<size_t>(KC, N - pc);
+                        pack_b(pb.data(), pc, kc, jc, nc);
+                        pack_a(pa.data(), ic, mc, pc, kc);
+
+                        for (size_t jr = 0; jr < nc; jr += NR) {
+                                size_t nr = std::min<size_t>(NR, nc - jr);
+                                for (size_t ir = 0; ir < mc; ir += MR) {
+                                        size_t mr = std::min<size_t>(MR, mc - ir);
+                                        TC *ct = &C[(ic + ir) * P + jc + jr];
+
+                                        // Partial sums are kept in C
+                                        // between blocks of k
+                                        for (size_t i = 0; i < MR; ++i)
+                                                for (size_t j = 0; j < NR; ++j)
+                                                        c[i * NR + j] = (pc && i < mr && j < nr) ?
+                                                                static_cast<acc_t>(ct[i * P + j]) : 0;
+
+                                        micro_kernel(kc, &pa[ir * kc], &pb[jr * kc], c);
+
+                                        for (size_t i = 0; i < mr; ++i)
+                                                for (size_t j = 0; j < nr; ++j)
+                                                        ct[i * P + j] = static_cast<TC>(c[i * NR + j]);
+                                }
+                        }
+                }
+        }
+
+public:
+        host_gemm(const TA *A, const TB *B, TC *C, size_t M, size_t N, size_t P) :
+                A(A), B(B), C(C), M(M), N(N), P(P) {}
+
+        void run() const {
+                if (!M || !P)
+                        return;
+                if (!N) {
+                        std::fill(C, C + M * P, static_cast<TC>(0));
+                        return;
+                }
+
+                const size_t mtiles = (M + MC - 1) / MC;
+                const size_t ntiles = (P + NC - 1) / NC;
+                const size_t ntile = mtiles * ntiles;
+                std::atomic<size_t> next(0);
+
+                auto worker = [&]() {
+                        std::vector<acc_t> pa(((MC + MR - 1) / MR) * MR * KC);
+                        std::vector<acc_t> pb(NC * KC);
+                        for (size_t t = next++; t < ntile; t = next++) {
+                                size_t ic = (t / ntiles) * MC, jc = (t % ntiles) * NC;
+                                tile(ic, std::min<size_t>(MC, M - ic), jc, std::min<size_t>(NC, P - jc), pa, pb);
+                        }
+                };
+
+                size_t nthreads = std::min<size_t>(host_threads(), ntile);
+                if (static_cast<double>(M) * N * P < HOST_GEMM_THREAD_MIN_MACS)
+                        nthreads = 1;
+
+                std::vector<std::thread> pool;
+                for (size_t i = 1; i < nthreads; ++i)
+                        pool.emplace_back(worker);
+                worker();
+                for (auto &t : pool)
+                        t.join();
+        }
+};
+
+// Host Matrix multiplication code (to compare results): C (M x P) = A (M
+// x N) * B (N x P)
+template <typename TA, typename TB, typename TC>
+void matrix_mult (const TA *A, const TB *B, TC *C, uint64_t M, uint64_t N, uint64_t P) {
+        host_gemm<TA, TB, TC>(A, B, C, M, N, P).run();
+}
+
+// Host requantization code (to compare results with kernels that
+// accumulate in 32 bits and requantize): C[i] = saturate((acc[i] *
+// scale + 2^(shift - 1)) >> shift), saturated to the range of TC.
+template <typename TC>
+void matrix_requantize (const int32_t *acc, TC *C, uint64_t n, int32_t scale, uint32_t shift) {
+        const int64_t max = std::numeric_limits<TC>::max();
+        const int64_t min = std::numeric_limits<TC>::min();
+        for (uint64_t i = 0; i < n; ++i) {
+                int64_t v = static_cast<int64_t>(acc[i]) * scale;
+                if (shift)
+                        v = (v + (static_cast<int64_t>(1) << (shift - 1))) >> shift;
+                C[i] = static_cast<TC>(std::min(std::max(v, min), max));
+        }
+}
+
+#endif // __HOST_GEMM_HPP
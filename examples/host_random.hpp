@@ -0,0 +1,146 @@
+// Copyright (c) 2020, University of Washington All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+// 
+// Redistributions of source code must retain the above copyright notice, this list
+// of conditions and the following disclaimer.
+// 
+// Redistributions in binary form must reproduce the above copyright notice, this
+// list of conditions and the following disclaimer in the documentation and/or
+// other materials provided with the distribution.
+// 
+// Neither the name of the copyright holder nor the names of its contributors may
+// be used to endorse or promote products derived from this software without
+// specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+// ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef __HOST_RANDOM_HPP
+#define __HOST_RANDOM_HPP
+
+#include <cstdint>
+#include <cmath>
+#include <type_traits>
+#include "host_thread.hpp"
+
+/*
+ * Counter-based random input generation, shared by the examples.
+ *
+ * host_random(seed, stream) fills arrays with uniformly distributed
+ * values. Element i of the array is a function of (seed, stream, i)
+ * only: it is taken from Philox4x32-10 (Salmon et al., "Parallel Random
+ * Numbers: As Easy as 1, 2, 3", SC'11) with key seed and counter (i /
+ * 4, stream). The arrays are therefore filled in parallel, and contain
+ * the same values for a given seed whatever the number of threads.
+ * Give each input of an example its own stream.
+ *
+ * uniform(dst, n, lo, hi) draws integers from [lo, hi], and
+ * floating-point values from [lo, hi). The device cannot handle
+ * infinities, subnormal numbers or NaNs, and zero is rejected along
+ * with them: such a value is redrawn, from a counter with a nonzero
+ * attempt number in its last word.
+ */
+
+// Arrays with fewer elements than this are not threaded
+#define HOST_RANDOM_THREAD_MIN (1 << 16)
+
+class host_random {
+        const uint64_t seed;
+        const uint32_t stream;
+
+        static inline uint32_t mulhilo(uint32_t a, uint32_t b, uint32_t *hi) {
+                uint64_t p = static_cast<uint64_t>(a) * b;
+                *hi = p >> 32;
+                return static_cast<uint32_t>(p);
+        }
+
+public:
+        // Philox4x32-10: ctr is replaced with the four output words
+        static void philox(uint32_t ctr[4], uint64_t seed) {
+                uint32_t k0 = static_cast<uint32_t>(seed);
+                uint32_t k1 = static_cast<uint32_t>(seed >> 32);
+                for (int r = 0; r < 10; ++r) {
+                        uint32_t hi0, hi1;
+                        uint32_t lo0 = mulhilo(0xD2511F53, ctr[0], &hi0);
+                        uint32_t lo1 = mulhilo(0xCD9E8D57, ctr[2], &hi1);
+                        ctr[0] = hi1 ^ ctr[1] ^ k0;
+                        ctr[1] = lo1;
+                        ctr[2] = hi0 ^ ctr[3] ^ k1;
+                        ctr[3] = lo0;
+                        k0 += 0x9E3779B9;
+                        k1 += 0xBB67AE85;
+                }
+        }
+
+        host_random(uint64_t seed, uint32_t stream = 0) :
+                seed(seed), stream(stream) {}
+
+        // The 32-bit random word for element i, at the given attempt
+        uint32_t word(uint64_t i, uint32_t attempt = 0) const {
+                uint32_t ctr[4] = {static_cast<uint32_t>(i / 4),
+                                   static_cast<uint32_t>(i / 4 >> 32),
+                                   stream, attempt};
+                philox(ctr, seed);
+                return ctr[i % 4];
+        }
+
+        // A uniformly distributed element i
+        template <typename T>
+        T draw(uint64_t i, T lo, T hi) const {
+                return value(i, word(i), lo, hi);
+        }
+
+        // Fill dst[0, n) with uniformly distributed values
+        template <typename T>
+        void uniform(T *dst, size_t n, T lo, T hi) const {
+                host_parallel_for(n, 4, HOST_RANDOM_THREAD_MIN,
+                                  [&](size_t begin, size_t end) {
+                                          // One Philox call gives four
+                                          // consecutive elements
+                                          for (size_t i = begin; i < end; ) {
+                                                  uint32_t ctr[4] = {static_cast<uint32_t>(i / 4),
+                                                                     static_cast<uint32_t>(i / 4 >> 32),
+                                                                     stream, 0};
+                                                  philox(ctr, seed);
+                                                  for (size_t j = i % 4; j < 4 && i < end; ++j, ++i)
+                                                          dst[i] = value(i, ctr[j], lo, hi);
+                                          }
+                                  });
+        }
+
+private:
+        // Map the random word w of element i onto [lo, hi] (integers)
+        // or [lo, hi) (floating-point)
+        template <typename T>
+        T value(uint64_t i, uint32_t w, T lo, T hi) const {
+                static_assert(std::is_arithmetic<T>::value && sizeof(T) <= 4,
+                              "host_random draws values of up to 32 bits");
+                if (std::is_floating_point<T>::value) {
+                        for (uint32_t attempt = 1; ; ++attempt) {
+                                // 24 random bits give [0, 1) in steps
+                                // of 2^-24
+                                double u = (w >> 8) * (1.0 / (1 << 24));
+                                T v = static_cast<T>(lo + (static_cast<double>(hi) - lo) * u);
+                                if (std::isnormal(v) && v < hi)
+                                        return v;
+                                w = word(i, attempt);
+                        }
+                }
+                uint64_t range = static_cast<uint64_t>(static_cast<int64_t>(hi) -
+                                                       static_cast<int64_t>(lo)) + 1;
+                return static_cast<T>(static_cast<int64_t>(lo) +
+                                      static_cast<int64_t>((w * range) >> 32));
+        }
+};
+
+#endif // __HOST_RANDOM_HPP
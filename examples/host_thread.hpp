@@ -0,0 +1,76 @@
+// Copyright (c) 2020, University of Washington All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+// 
+// Redistributions of source code must retain the above copyright notice, this list
+// of conditions and the following disclaimer.
+// 
+// Redistributions in binary form must reproduce the above copyright notice, this
+// list of conditions and the following disclaimer in the documentation and/or
+// other materials provided with the distribution.
+// 
+// Neither the name of the copyright holder nor the names of its contributors may
+// be used to endorse or promote products derived from this software without
+// specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+// ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef __HOST_THREAD_HPP
+#define __HOST_THREAD_HPP
+
+#include <cstdlib>
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+/*
+ * Host-side threading, shared by the host reference code.
+ *
+ * host_threads() is the number of threads to use:
+ * std::thread::hardware_concurrency(), or the value of the
+ * BSG_HOST_THREADS environment variable if it is set.
+ *
+ * host_parallel_for(n, grain, f) calls f(begin, end) for consecutive
+ * ranges that cover [0, n), one per thread. Every range but the last
+ * has a multiple of grain elements. Fewer than min elements are done
+ * on the calling thread.
+ */
+
+inline unsigned host_threads() {
+        const char *env = getenv("BSG_HOST_THREADS");
+        unsigned n = env ? atoi(env) : std::thread::hardware_concurrency();
+        return n ? n : 1;
+}
+
+template <typename F>
+void host_parallel_for(size_t n, size_t grain, size_t min, F f) {
+        size_t nthreads = n < min ? 1 : host_threads();
+        size_t chunk = (n + nthreads - 1) / nthreads;
+        chunk = std::max<size_t>((chunk + grain - 1) / grain * grain, grain);
+        nthreads = (n + chunk - 1) / chunk;
+        if (nthreads <= 1) {
+                f(static_cast<size_t>(0), n);
+                return;
+        }
+
+        std::vector<std::thread> pool;
+        for (size_t t = 1; t < nthreads; ++t)
+                pool.emplace_back([=, &f]() {
+                        f(t * chunk, std::min(n, (t + 1) * chunk));
+                });
+        f(static_cast<size_t>(0), chunk);
+        for (auto &t : pool)
+                t.join();
+}
+
+#endif // __HOST_THREAD_HPP
@@ -0,0 +1,230 @@
+// Copyright (c) 2020, University of Washington All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+// 
+// Redistributions of source code must retain the above copyright notice, this list
+// of conditions and the following disclaimer.
+// 
+// Redistributions in binary form must reproduce the above copyright notice, this
+// list of conditions and the following disclaimer in the documentation and/or
+// other materials provided with the distribution.
+// 
+// Neither the name of the copyright holder nor the names of its contributors may
+// be used to endorse or promote products derived from this software without
+// specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+// ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef __HOST_TRANSFER_HPP
+#define __HOST_TRANSFER_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+#include <bsg_manycore_errno.h>
+#include <bsg_manycore_cuda.h>
+#include "common.h"
+#include "host_buffer.hpp"
+
+/*
+ * A queue of host <-> device copies, performed in batches.
+ *
+ * to_device() and to_host() only record a copy; flush() performs every
+ * recorded copy: first all device-to-host copies, then all
+ * host-to-device copies. A test can therefore queue the copy-back of
+ * its result and return, and the next test's flush() performs that
+ * copy-back and its own uploads as one batch (which is also correct
+ * when both tests use the same device buffers). The host must not read
+ * a to_host() destination before the flush() that performs it.
+ *
+ * Within a batch, copies to or from adjacent device ranges (e.g.
+ * buffers that were allocated back to back) are coalesced into one
+ * transfer through a staging buffer. If HOST_TRANSFER_DMA is defined,
+ * each direction of a batch is issued as one
+ * hb_mc_device_dma_to_device()/hb_mc_device_dma_to_host() call;
+ * otherwise, and if the runtime reports HB_MC_NOIMPL, each transfer is
+ * one hb_mc_device_memcpy() call.
+ *
+ * Device calls are made from the calling thread only: the cosimulation
+ * runtime is not thread-safe. The copies in a batch must not overlap.
+ *
+ * report() prints the bytes moved and the achieved bandwidth.
+ */
+class host_transfer_queue {
+public:
+        explicit host_transfer_queue(hb_mc_device_t *device) : device(device) {}
+
+        // Queue a copy of bytes bytes from host src to device dst
+        void to_device(eva_t dst, const void *src, size_t bytes) {
+                htod.push_back({dst, const_cast<void *>(src), bytes});
+        }
+
+        // Queue a copy of bytes bytes from device src to host dst
+        void to_host(void *dst, eva_t src, size_t bytes) {
+                dtoh.push_back({src, dst, bytes});
+        }
+
+        // Perform all queued copies
+        int flush() {
+                if (htod.empty() && dtoh.empty())
+                        return HB_MC_SUCCESS;
+
+                auto start = std::chrono::steady_clock::now();
+                int rc = transfer(dtoh, HB_MC_MEMCPY_TO_HOST);
+                if (rc == HB_MC_SUCCESS)
+                        rc = transfer(htod, HB_MC_MEMCPY_TO_DEVICE);
+                std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+                seconds += elapsed.count();
+                batches++;
+                dtoh.clear();
+                htod.clear();
+                return rc;
+        }
+
+        size_t bytes_to_device() const { return stats[HB_MC_MEMCPY_TO_DEVICE]; }
+        size_t bytes_to_host() const { return stats[HB_MC_MEMCPY_TO_HOST]; }
+
+        // Achieved bandwidth over all batches, in bytes per second
+        double bandwidth() const {
+                return seconds > 0 ? (bytes_to_device() + bytes_to_host()) / seconds : 0;
+        }
+
+        void report(const char *name) const {
+                bsg_pr_test_info("%s: %zu copies in %zu batches (%zu transfers): "
+                                 "%zu bytes to device, %zu bytes to host, "
+                                 "%.3f ms, %.2f MB/s\n",
+                                 name, copies, batches, transfers,
+                                 bytes_to_device(), bytes_to_host(),
+                                 seconds * 1e3, bandwidth() / 1e6);
+        }
+
+private:
+        struct job {
+                eva_t dev;
+                void *host;
+                size_t size;
+        };
+
+        hb_mc_device_t *device;
+        std::vector<job> htod, dtoh;
+        host_buffer<uint8_t> staging;
+
+        size_t stats[2] = {0, 0};
+        size_t copies = 0, batches = 0, transfers = 0;
+        double seconds = 0;
+
+        // Issue jobs (already coalesced) to the device
+        int issue(const std::vector<job> &jobs, hb_mc_memcpy_kind kind) {
+#ifdef HOST_TRANSFER_DMA
+                int rc;
+                if (kind == HB_MC_MEMCPY_TO_DEVICE) {
+                        std::vector<hb_mc_dma_htod_t> dma;
+                        for (const job &j : jobs)
+                                dma.push_back({j.dev, j.host, j.size});
+                        rc = hb_mc_device_dma_to_device(device, dma.data(), dma.size());
+                } else {
+                        std::vector<hb_mc_dma_dtoh_t> dma;
+                        for (const job &j : jobs)
+                                dma.push_back({j.dev, j.host, j.size});
+                        rc = hb_mc_device_dma_to_host(device, dma.data(), dma.size());
+                }
+                if (rc != HB_MC_NOIMPL) {
+                        transfers += 1;
+                        return rc;
+                }
+#endif
+                for (const job &j : jobs) {
+                        void *dev = reinterpret_cast<void *>(static_cast<intptr_t>(j.dev));
+                        int rc = hb_mc_device_memcpy(device,
+                                                     kind == HB_MC_MEMCPY_TO_DEVICE ? dev : j.host,
+                                                     kind == HB_MC_MEMCPY_TO_DEVICE ? j.host : dev,
+                                                     j.size, kind);
+                        if (rc != HB_MC_SUCCESS) {
+                                bsg_pr_test_err("failed to copy memory %s device.\n",
+                                                kind == HB_MC_MEMCPY_TO_DEVICE ? "to" : "from");
+                                return rc;
+                        }
+                        transfers++;
+                }
+                return HB_MC_SUCCESS;
+        }
+
+        int transfer(std::vector<job> &jobs, hb_mc_memcpy_kind kind) {
+                if (jobs.empty())
+                        return HB_MC_SUCCESS;
+
+                std::stable_sort(jobs.begin(), jobs.end(),
+                                 [](const job &a, const job &b) { return a.dev < b.dev; });
+
+                // Find runs of adjacent device ranges. Runs of more than
+                // one job get a region of the staging buffer.
+                std::vector<size_t> run_end;
+                size_t stage_bytes = 0;
+                for (size_t i = 0; i < jobs.size(); ) {
+                        size_t j = i + 1, bytes = jobs[i].size;
+                        while (j < jobs.size() && jobs[j].dev == jobs[j - 1].dev + jobs[j - 1].size)
+                                bytes += jobs[j++].size;
+                        if (j - i > 1)
+                                stage_bytes += bytes;
+                        run_end.push_back(j);
+                        i = j;
+                }
+                if (staging.size() < stage_bytes)
+                        staging = host_buffer<uint8_t>(stage_bytes);
+
+                // Build the coalesced jobs, gathering uploads into the
+                // staging buffer
+                std::vector<job> issued;
+                uint8_t *stage = staging.data();
+                for (size_t r = 0, i = 0; r < run_end.size(); i = run_end[r++]) {
+                        if (run_end[r] - i == 1) {
+                                issued.push_back(jobs[i]);
+                                continue;
+                        }
+                        job merged = {jobs[i].dev, stage, 0};
+                        for (size_t j = i; j < run_end[r]; ++j) {
+                                if (kind == HB_MC_MEMCPY_TO_DEVICE)
+                                        memcpy(stage + merged.size, jobs[j].host, jobs[j].size);
+                                merged.size += jobs[j].size;
+                        }
+                        issued.push_back(merged);
+                        stage += merged.size;
+                }
+
+                int rc = issue(issued, kind);
+                if (rc != HB_MC_SUCCESS)
+                        return rc;
+
+                // Scatter downloads out of the staging buffer
+                stage = staging.data();
+                for (size_t r = 0, i = 0; r < run_end.size(); i = run_end[r++]) {
+                        if (run_end[r] - i == 1)
+                                continue;
+                        for (size_t j = i; j < run_end[r]; ++j) {
+                                if (kind == HB_MC_MEMCPY_TO_HOST)
+                                        memcpy(jobs[j].host, stage, jobs[j].size);
+                                stage += jobs[j].size;
+                        }
+                }
+
+                for (const job &j : jobs)
+                        stats[kind] += j.size;
+                copies += jobs.size();
+                return HB_MC_SUCCESS;
+        }
+};
+
+#endif // __HOST_TRANSFER_HPP
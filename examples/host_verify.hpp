@@ -0,0 +1,374 @@
+// Copyright (c) 2020, University of Washington All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+// 
+// Redistributions of source code must retain the above copyright notice, this list
+// of conditions and the following disclaimer.
+// 
+// Redistributions in binary form must reproduce the above copyright notice, this
+// list of conditions and the following disclaimer in the documentation and/or
+// other materials provided with the distribution.
+// 
+// Neither the name of the copyright holder nor the names of its contributors may
+// be used to endorse or promote products derived from this software without
+// specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+// ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef __HOST_VERIFY_HPP
+#define __HOST_VERIFY_HPP
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <limits>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include <bsg_manycore_errno.h>
+#include "common.h"
+#include "host_thread.hpp"
+
+/*
+ * Result verification, shared by the examples.
+ *
+ * verify_result(name, expected, result, M, N) compares two M x N
+ * row-major arrays and returns HB_MC_SUCCESS if they match, or
+ * HB_MC_FAIL if they do not:
+ *
+ * - Integers must match exactly.
+ *
+ * - Floating-point values match if they are within tol.ulps units in
+ *   the last place of each other, or within tol.abs + tol.rel *
+ *   |expected|. A NaN matches only a NaN.
+ *
+ * Both arrays are first compared bitwise, a SIMD vector at a time (GCC
+ * vector extensions, as in host_gemm.hpp), and only vectors that
+ * differ are compared element by element. Large arrays are split
+ * across host_threads() threads (see host_thread.hpp).
+ *
+ * On a mismatch, the first HOST_VERIFY_MAX_REPORT mismatching elements
+ * are printed with their coordinates. In either case a histogram of
+ * the errors of all inexact elements is printed, in power-of-two
+ * buckets of ULPs (floating-point) or of the absolute difference
+ * (integers).
+ */
+
+#ifndef HOST_VERIFY_VECTOR_BYTES
+#if defined(__AVX512F__)
+#define HOST_VERIFY_VECTOR_BYTES 64
+#elif defined(__AVX__)
+#define HOST_VERIFY_VECTOR_BYTES 32
+#else
+#define HOST_VERIFY_VECTOR_BYTES 16
+#endif
+#endif
+
+// Number of mismatching elements that are printed
+#ifndef HOST_VERIFY_MAX_REPORT
+#define HOST_VERIFY_MAX_REPORT 10
+#endif
+
+// Arrays with fewer elements than this are not threaded
+#define HOST_VERIFY_THREAD_MIN (1 << 16)
+
+// Histogram buckets: 1 + floor(log2(error)) for errors of 1 to 2^64 - 1,
+// and one for NaNs
+#define HOST_VERIFY_BUCKETS 66
+#define HOST_VERIFY_NAN_BUCKET (HOST_VERIFY_BUCKETS - 1)
+
+// Floating-point tolerance. Ignored for integers.
+struct host_verify_tolerance {
+        uint64_t ulps;
+        double rel;
+        double abs;
+};
+
+#define HOST_VERIFY_DEFAULT_TOLERANCE {4, 1e-6, 0.0}
+
+// The tolerance for sums of n floating-point terms whose magnitudes add
+// up to at most mag, computed in a different order than the reference
+// (e.g. by a blocked or tree reduction). Each of the two sums is within
+// (n - 1) * epsilon * mag of the exact sum.
+template <typename T>
+inline host_verify_tolerance host_verify_sum_tolerance(uint64_t n, double mag) {
+        host_verify_tolerance tol = HOST_VERIFY_DEFAULT_TOLERANCE;
+        tol.abs = 2.0 * (n ? n - 1 : 0) * std::numeric_limits<T>::epsilon() * mag;
+        return tol;
+}
+
+// The outcome of a comparison
+struct host_verify_stats {
+        size_t count;                   // Elements compared
+        size_t inexact;                 // Elements that are not bitwise equal
+        size_t mismatches;              // Elements that are out of tolerance
+        uint64_t max_error;             // Largest error (ULPs or difference)
+        size_t max_index;               // ... and where it is
+        size_t histogram[HOST_VERIFY_BUCKETS];
+        std::vector<size_t> first;      // The first mismatching elements
+
+        host_verify_stats() : count(0), inexact(0), mismatches(0),
+                              max_error(0), max_index(0), histogram() {}
+};
+
+template <typename T>
+class host_verify {
+        static_assert(std::is_arithmetic<T>::value,
+                      "host_verify compares integers and floating-point values");
+
+        // An unsigned integer with the size of T
+        typedef typename std::conditional<sizeof(T) == 1, uint8_t,
+                typename std::conditional<sizeof(T) == 2, uint16_t,
+                typename std::conditional<sizeof(T) == 4, uint32_t,
+                                          uint64_t>::type>::type>::type bits_t;
+
+        typedef uint64_t vec_t __attribute__((vector_size(HOST_VERIFY_VECTOR_BYTES)));
+
+        enum : size_t {
+                VL = HOST_VERIFY_VECTOR_BYTES / sizeof(T)
+        };
+
+        const T *expected;
+        const T *result;
+        const size_t count;
+        const host_verify_tolerance tol;
+
+        static bits_t bits(T v) {
+                bits_t b;
+                memcpy(&b, &v, sizeof(b));
+                return b;
+        }
+
+        // Map the bits of a floating-point value onto an unsigned
+        // integer that increases with the value, so that the distance
+        // between two of them is their distance in ULPs.
+        static uint64_t ordered(T v) {
+                const bits_t sign = static_cast<bits_t>(1) << (sizeof(T) * 8 - 1);
+                bits_t b = bits(v);
+                return (b & sign) ? static_cast<bits_t>(~b) : static_cast<bits_t>(b | sign);
+        }
+
+        // Map an integer onto an unsigned integer that increases with
+        // its value
+        static uint64_t integer(T v) {
+                if (std::is_signed<T>::value)
+                        return static_cast<uint64_t>(static_cast<int64_t>(v)) ^ (1ull << 63);
+                return static_cast<uint64_t>(v);
+        }
+
+        static uint64_t distance(uint64_t a, uint64_t b) {
+                return a > b ? a - b : b - a;
+        }
+
+        static unsigned bucket(uint64_t error) {
+                unsigned b = 0;
+                while (error) {
+                        ++b;
+                        error >>= 1;
+                }
+                return b;
+        }
+
+        // Compare one element that is not bitwise equal. Returns true
+        // if it is within tolerance.
+        bool compare(size_t i, host_verify_stats &s) const {
+                T e = expected[i], r = result[i];
+                uint64_t error;
+                unsigned b;
+                bool match;
+
+                if (std::is_floating_point<T>::value) {
+                        if (std::isnan(e) || std::isnan(r)) {
+                                match = std::isnan(e) && std::isnan(r);
+                                error = match ? 0 : UINT64_MAX;
+                                b = HOST_VERIFY_NAN_BUCKET;
+                        } else {
+                                double diff = std::fabs(static_cast<double>(e) - static_cast<double>(r));
+                                error = distance(ordered(e), ordered(r));
+                                b = bucket(error);
+                                match = error <= tol.ulps ||
+                                        diff <= tol.abs + tol.rel * std::fabs(static_cast<double>(e));
+                        }
+                } else {
+                        error = distance(integer(e), integer(r));
+                        b = bucket(error);
+                        match = false;
+                }
+
+                s.inexact++;
+                s.histogram[b]++;
+                if (error > s.max_error || s.inexact == 1) {
+                        s.max_error = error;
+                        s.max_index = i;
+                }
+                return match;
+        }
+
+        void compare_range(size_t begin, size_t end, host_verify_stats &s) const {
+                size_t i = begin;
+                for (; i + VL <= end; i += VL) {
+                        vec_t e, r;
+                        memcpy(&e, &expected[i], sizeof(vec_t));
+                        memcpy(&r, &result[i], sizeof(vec_t));
+                        vec_t d = e ^ r;
+
+                        uint64_t any = 0;
+                        for (size_t j = 0; j < sizeof(vec_t) / sizeof(uint64_t); ++j)
+                                any |= d[j];
+                        if (!any)
+                                continue;
+
+                        for (size_t j = i; j < i + VL; ++j)
+                                if (bits(expected[j]) != bits(result[j]))
+                                        record(j, s);
+                }
+                for (; i < end; ++i)
+                        if (bits(expected[i]) != bits(result[i]))
+                                record(i, s);
+                s.count = end - begin;
+        }
+
+        void record(size_t i, host_verify_stats &s) const {
+                if (compare(i, s))
+                        return;
+                s.mismatches++;
+                if (s.first.size() < HOST_VERIFY_MAX_REPORT)
+                        s.first.push_back(i);
+        }
+
+public:
+        host_verify(const T *expected, const T *result, size_t count,
+                    host_verify_tolerance tol) :
+                expected(expected), result(result), count(count), tol(tol) {}
+
+        host_verify_stats run() const {
+                size_t nthreads = count < HOST_VERIFY_THREAD_MIN ? 1 : host_threads();
+                // Give each thread a whole number of vectors
+                size_t chunk = (count + nthreads - 1) / nthreads;
+                chunk = (chunk + VL - 1) / VL * VL;
+                nthreads = chunk ? (count + chunk - 1) / chunk : 1;
+
+                std::vector<host_verify_stats> part(nthreads);
+                std::vector<std::thread> pool;
+                for (size_t t = 1; t < nthreads; ++t)
+                        pool.emplace_back([&, t]() {
+                                compare_range(t * chunk, std::min(count, (t + 1) * chunk), part[t]);
+                        });
+                compare_range(0, std::min(count, chunk), part[0]);
+                for (auto &t : pool)
+                        t.join();
+
+                // Threads compare consecutive ranges, so merging them
+                // in order keeps the first mismatches first.
+                host_verify_stats s;
+                for (auto &p : part) {
+                        s.count += p.count;
+                        if (p.inexact && (p.max_error > s.max_error || !s.inexact)) {
+                                s.max_error = p.max_error;
+                                s.max_index = p.max_index;
+                        }
+                        s.inexact += p.inexact;
+                        s.mismatches += p.mismatches;
+                        for (unsigned b = 0; b < HOST_VERIFY_BUCKETS; ++b)
+                                s.histogram[b] += p.histogram[b];
+                        for (size_t i : p.first)
+                                if (s.first.size() < HOST_VERIFY_MAX_REPORT)
+                                        s.first.push_back(i);
+                }
+                return s;
+        }
+};
+
+// Print element i of an M x N array as "(y, x)", or "[x]" if M is 1
+inline void host_verify_coordinates(char *buf, size_t len, size_t i, size_t M, size_t N) {
+        if (M == 1)
+                snprintf(buf, len, "[%zu]", i);
+        else
+                snprintf(buf, len, "(%zu, %zu)", i / N, i % N);
+}
+
+template <typename T>
+inline void host_verify_value(char *buf, size_t len, T v) {
+        if (std::is_floating_point<T>::value)
+                snprintf(buf, len, "%.9g", static_cast<double>(v));
+        else if (std::is_signed<T>::value)
+                snprintf(buf, len, "%lld", static_cast<long long>(v));
+        else
+                snprintf(buf, len, "%llu", static_cast<unsigned long long>(v));
+}
+
+// Compare the M x N arrays expected and result, and print a report
+// headed by name. Returns HB_MC_SUCCESS if every element matches.
+template <typename T>
+int verify_result(const char *name, const T *expected, const T *result,
+                  uint64_t M, uint64_t N,
+                  host_verify_tolerance tol = HOST_VERIFY_DEFAULT_TOLERANCE) {
+        const bool fp = std::is_floating_point<T>::value;
+        const char *unit = fp ? " ulp" : "";
+        host_verify_stats s = host_verify<T>(expected, result, M * N, tol).run();
+        char where[48], e[32], r[32];
+
+        if (s.mismatches) {
+                bsg_pr_test_err("%s: %zu of %zu elements mismatch.\n",
+                                name, s.mismatches, s.count);
+                for (size_t i : s.first) {
+                        host_verify_coordinates(where, sizeof(where), i, M, N);
+                        host_verify_value(e, sizeof(e), expected[i]);
+                        host_verify_value(r, sizeof(r), result[i]);
+                        bsg_pr_test_err("  %s: expected %s, got %s\n", where, e, r);
+                }
+                if (s.mismatches > s.first.size())
+                        bsg_pr_test_err("  ... and %zu more\n", s.mismatches - s.first.size());
+        } else if (s.inexact) {
+                bsg_pr_test_info(BSG_GREEN("%s: %zu elements match (%zu within tolerance).\n"),
+                                 name, s.count, s.inexact);
+        } else {
+                bsg_pr_test_info(BSG_GREEN("%s: %zu elements match exactly.\n"),
+                                 name, s.count);
+        }
+
+        if (s.inexact) {
+                host_verify_coordinates(where, sizeof(where), s.max_index, M, N);
+                if (fp && s.max_error == UINT64_MAX)
+                        bsg_pr_test_info("%s: largest error: NaN at %s\n", name, where);
+                else
+                        bsg_pr_test_info("%s: largest error: %llu%s at %s\n", name,
+                                         (unsigned long long) s.max_error, unit, where);
+
+                // One line: "[lo,hi):count" for each non-empty bucket
+                char line[HOST_VERIFY_BUCKETS * 48];
+                size_t len = 0;
+                for (unsigned b = 1; b < HOST_VERIFY_NAN_BUCKET; ++b) {
+                        if (!s.histogram[b])
+                                continue;
+                        unsigned long long lo = 1ull << (b - 1);
+                        if (b == 64)
+                                len += snprintf(line + len, sizeof(line) - len, " [%llu,2^64):%zu",
+                                                lo, s.histogram[b]);
+                        else
+                                len += snprintf(line + len, sizeof(line) - len, " [%llu,%llu):%zu",
+                                                lo, lo << 1, s.histogram[b]);
+                }
+                if (s.histogram[HOST_VERIFY_NAN_BUCKET])
+                        len += snprintf(line + len, sizeof(line) - len, " NaN:%zu",
+                                        s.histogram[HOST_VERIFY_NAN_BUCKET]);
+                bsg_pr_test_info("%s: error histogram%s:%s\n", name,
+                                 fp ? " (ulp)" : "", line);
+        }
+
+        return s.mismatches ? HB_MC_FAIL : HB_MC_SUCCESS;
+}
+
+#endif // __HOST_VERIFY_HPP
@@ -0,0 +1,820 @@
+#ifndef __BSG_CIRCULAR_BUFFER_HPP
+#define __BSG_CIRCULAR_BUFFER_HPP
+#include <array>
+#include <bsg_manycore.h>
+#include <atomic>
+#include <cstdint>
+
+// Tile group X/Y coordinates. If these are not defined then we should be scared
+// and exit during compilation.
+extern int __bsg_y, __bsg_x; 
+
+namespace CircularBuffer{
+        // This is a replacement for the MACRO. Use at your own risk.
+        template<unsigned int dst_y, unsigned int dst_x, typename T>
+        T *bsg_remote_pointer(T* ptr){
+#ifdef BSG_NATIVE
+                return reinterpret_cast<T *>(bsg_remote_ptr(dst_x, dst_y, ptr));
+#else
+                uintptr_t remote_prefix = (REMOTE_EPA_PREFIX << REMOTE_EPA_MASK_SHIFTS);
+                uintptr_t y_bits = ((dst_y) << Y_CORD_SHIFTS);
+                uintptr_t x_bits = ((dst_x) << X_CORD_SHIFTS);
+                uintptr_t local_bits = reinterpret_cast<uintptr_t>(ptr);
+                return reinterpret_cast<T *>(remote_prefix | y_bits | x_bits | local_bits);
+#endif
+        }
+
+        // bsg_remote_pointer, with the coordinates chosen at runtime
+        template<typename T>
+        T *bsg_remote_pointer(unsigned int dst_y, unsigned int dst_x, T* ptr){
+#ifdef BSG_NATIVE
+                return reinterpret_cast<T *>(bsg_remote_ptr(dst_x, dst_y, ptr));
+#else
+                uintptr_t remote_prefix = (REMOTE_EPA_PREFIX << REMOTE_EPA_MASK_SHIFTS);
+                uintptr_t y_bits = ((dst_y) << Y_CORD_SHIFTS);
+                uintptr_t x_bits = ((dst_x) << X_CORD_SHIFTS);
+                uintptr_t local_bits = reinterpret_cast<uintptr_t>(ptr);
+                return reinterpret_cast<T *>(remote_prefix | y_bits | x_bits | local_bits);
+#endif
+        }
+
+        template<typename T, unsigned int src_y, unsigned int src_x, unsigned int dst_y, unsigned int dst_x, unsigned int N, unsigned int DEPTH = 4>
+        class Root{
+        protected:
+                unsigned int occ_idx = 0;
+
+                ~Root<T, src_y, src_x, dst_y, dst_x, N, DEPTH>(){
+                        occ_idx = 0;
+                }
+
+                // It's not possible to declare a static pointer (static
+                // unsigned char *foo = nullptr); in the class scope in
+                // C++. Instead, we have to declare a static pointer inside of a
+                // method and intitalize it there. By returning a reference, we
+                // can modify the pointer, and by making it *volatile we
+                // indicate that the pointer value may change (as opposed to the
+                // data).
+                __attribute__((noinline))
+                static unsigned char *volatile &get_occ_ptr() {static unsigned char *volatile __arr = nullptr; return __arr;}
+
+                __attribute__((noinline))
+                static T *volatile &get_buf_ptr() {static T *volatile __arr = nullptr; return __arr;}
+        };
+
+        template<typename T, unsigned int src_y, unsigned int src_x, unsigned int dst_y, unsigned int dst_x, unsigned int N, unsigned int DEPTH = 4>
+        class Source : public Root<T, src_y, src_x, dst_x, dst_y, N, DEPTH> {
+                unsigned char occupancy [DEPTH] = {{0}};
+
+        public:
+                __attribute__((noinline))
+                Source<T, src_y, src_x, dst_y, dst_x, N, DEPTH>(){
+                        // Get a reference to our local buffer pointer
+                        unsigned char *volatile &occ_p = this->get_occ_ptr();
+                        // Get a pointer to the Destination's occupancy buffer pointer
+                        unsigned char *volatile *dst_occ_p = bsg_remote_pointer<dst_y, dst_x>(&occ_p);
+
+                        if (occ_p == nullptr){
+                                // Set our occ_p (the static one in get_occ_ptr) to the stack allocated buffer
+                                occ_p = occupancy;
+                                // Set Dest's occ_p to the remote address (within it's EVA) of our stack-allocated buffer
+                                *dst_occ_p = bsg_remote_pointer<src_y, src_x>(occupancy);
+                        } else {
+                                // Error: Someone intitialized occ_p. Were two Source objects declared?
+                                // TODO: Would this fail on the second invocation of a tile group?
+                                bsg_print_hexadecimal(0xF1F0E100);
+                        }
+
+                        // Error: The runtime Y-coordinate of this Source Object
+                        // doesn't match the compiled Y-Coordinate
+                        if(__bsg_y != src_y)
+                                bsg_print_hexadecimal(0xF1F0E101);
+
+                        // Error: The runtime X-coordinate of this Source Object
+                        // doesn't match the compiled X-Coordinate
+                        if(__bsg_x != src_x)
+                                bsg_print_hexadecimal(0xF1F0E102);
+                }
+
+                __attribute__((noinline))
+                ~Source<T, src_y, src_x, dst_y, dst_x, N, DEPTH>(){
+                        unsigned char *occupancy = this->get_occ_ptr();
+                        unsigned int idx = this->occ_idx != 0 ? this->occ_idx - 1 : DEPTH - 1;
+                                
+                        // WARNING: Race Condition
+
+                        // If SOURCE finishes before DEST we want to avoid
+                        // cleaning up our occ_ptr before SOURCE finishes
+                        volatile unsigned char &o = occupancy[idx];
+                        
+                        while(o);
+
+                        this->get_occ_ptr() = nullptr;
+                }
+
+                // init_wait blocks until the destination has finished initialization. 
+                // 
+                // USERS MUST INSTANTIATE ALL CircularBuffer OBJECTS BEFORE
+                // CALLING init_wait. NOT DOING THIS RISKS DEADLOCK.
+                __attribute__((noinline))
+                void init_wait(){
+                        // While the Destination has not initialized our buffer pointer
+                        while(this->get_buf_ptr() == nullptr);
+                        this->occ_idx = 0;
+                }
+
+                // obtain_wr_ptr returns a pointer to the start of the current
+                // data range in the buffer. If the corresponding location in
+                // the occupancy array is 1 it will return nullptr, otherwise
+                // there the data range is empty and it will return a pointer to
+                // the start of the current data range in the buffer.
+                __attribute__((noinline))
+                T *obtain_wr_ptr(){
+                        unsigned char *occupancy = this->get_occ_ptr();
+                        volatile unsigned char &o = occupancy[this->occ_idx];
+
+                        if(o)
+                                return nullptr;
+
+                        T *buffer = this->get_buf_ptr();
+                        return &buffer[this->occ_idx * N];
+                }
+
+                // obtain_wr_ptr returns a pointer to the start of the current
+                // data range in the buffer. If the corresponding location in
+                // the occupancy array is 1 it loop until there is valid data
+                // and never time out. When the corresponding value is zero the
+                // data range is empty and it will return a pointer to the start
+                // of the current data range in the buffer.
+                __attribute__((noinline))
+                T *obtain_wr_ptr_wait(){
+                        unsigned char *occupancy = this->get_occ_ptr();
+                        volatile unsigned char &o = occupancy[this->occ_idx];
+                        
+                        while(o);
+
+                        T *buffer = this->get_buf_ptr();
+                        return &buffer[this->occ_idx * N];
+                }
+
+                // finish_wr_ptr signals to the destination that the current
+                // data range in the buffer is no longer being written. If the
+                // corresponding location in the occupancy array is 1 the method
+                // will use bsg_print_hexadecimal to signal an error and return
+                // -1. If the command is successful, it will return 0 and
+                // increment occ_idx. Call obtain_wr_ptr* to get the next write
+                // pointer.
+                //
+                // WARNING: DEADLOCK. obtain_rd_ptr_wait in the Destination will
+                // hang if finish_rd_ptr is not called on each data range.
+                __attribute__((noinline))
+                int finish_wr_ptr(){
+                        unsigned char *occupancy = this->get_occ_ptr();
+                        volatile unsigned char &o = occupancy[this->occ_idx];
+
+                        if(o){
+                                bsg_print_hexadecimal(0xF1F0E103);
+                                return -1;
+                        }
+
+                        // The remote stores of the data must complete
+                        // before the destination sees o set
+                        bsg_fence();
+                        o = 1;
+
+                        this->occ_idx = (this->occ_idx + 1) % DEPTH;
+                        return 0;
+                }
+
+        };
+
+        template<typename T, unsigned int src_y, unsigned int src_x, unsigned int dst_y, unsigned int dst_x, unsigned int N, unsigned int DEPTH = 4>
+        class Dest : public Root<T, src_y, src_x, dst_x, dst_y, N, DEPTH> {
+                T buffer[N * DEPTH];
+
+        public:
+                __attribute__((noinline))
+                Dest<T, src_y, src_x, dst_y, dst_x, N, DEPTH>(){
+                        // Get a reference to our buffer pointer
+                        T *volatile &buf_p = this->get_buf_ptr();
+                        // Get a reference to source's buffer pointer
+                        T *volatile *src_buf_p = bsg_remote_pointer<src_y, src_x>(&buf_p);
+
+                        if (buf_p == nullptr){
+                                // Set our buf_p (the static one in get_buf_ptr) to the stack allocated buffer
+                                buf_p = buffer;
+                                // Set Source's buf_p to the remote address
+                                // (within it's EVA) of our stack-allocated
+                                // buffer
+                                *src_buf_p = bsg_remote_pointer<dst_y, dst_x>(buffer);
+                        } else {
+                                // If buf_p isn't null (the static
+                                // initialization value) something has gone
+                                // horribly wrong
+                                bsg_print_hexadecimal(0xF1F0E000); // Assert something
+                        }
+
+                        // Error: The runtime Y-coordinate of this Source Object
+                        // doesn't match the compiled Y-Coordinate
+                        if(__bsg_y != dst_y)
+                                bsg_print_hexadecimal(0xF1F0E001);
+
+                        // Error: The runtime X-coordinate of this Source Object
+                        // doesn't match the compiled X-Coordinate
+                        if(__bsg_x != dst_x)
+                                bsg_print_hexadecimal(0xF1F0E002);
+
+                }
+
+                __attribute__((noinline))
+                ~Dest<T, src_y, src_x, dst_y, dst_x, N, DEPTH>(){
+                        unsigned char *occupancy = this->get_occ_ptr();
+                        unsigned int idx = this->occ_idx != 0 ? this->occ_idx - 1 : DEPTH - 1;
+                                
+                        // WARNING: Race Condition
+
+                        // If Dest finishes before Source and there's still data
+                        // available, we can't really do anything. Dest will
+                        // deadlock on its destructor, we'll "throw a warning"
+                        // to give a hint.
+                        volatile unsigned char &o = occupancy[idx];
+                        if(o)
+                                bsg_print_hexadecimal(0xF1F0EDED);
+
+                        this->get_buf_ptr() = nullptr;
+                }
+
+                // init_wait blocks until the Source has finished initialization. 
+                // 
+                // USERS MUST INSTANTIATE ALL CircularBuffer OBJECTS BEFORE
+                // CALLING init_wait. NOT DOING THIS RISKS DEADLOCK.
+                __attribute__((noinline))
+                void init_wait(){
+                        // Wait until the source has initialized our occupancy pointer
+                        while(this->get_occ_ptr() == nullptr);
+                        this->occ_idx = 0;
+                }
+
+                // obtain_rd_ptr returns a pointer to the start of the current
+                // data range in the buffer. If the corresponding location in
+                // the occupancy array is 0 it will return nullptr, otherwise
+                // there is valid data and it will return a pointer to the start
+                // of the current data range in the buffer.
+                __attribute__((noinline))
+                const T *obtain_rd_ptr(){
+                        unsigned char *occupancy = this->get_occ_ptr();
+                        volatile unsigned char &o = occupancy[this->occ_idx];
+
+                        if(!o)
+                                return nullptr;
+
+                        return &(buffer[this->occ_idx * N]);
+                }
+
+                // obtain_rd_ptr returns a pointer to the start of the current
+                // data range in the buffer. If the corresponding location in
+                // the occupancy array is 0 it loop until there is valid data
+                // and never time out. When the corresponding value is non-zero
+                // it will return a pointer to the start of the current data
+                // range in the buffer.
+                __attribute__((noinline))
+                const T *obtain_rd_ptr_wait(){
+                        unsigned char *occupancy = this->get_occ_ptr();
+                        volatile unsigned char &o = occupancy[this->occ_idx];
+
+                        while(!o);
+
+                        return &buffer[this->occ_idx * N];
+                }
+
+                // finish_rd_ptr signals to the destination that the current
+                // data range in the buffer is no longer being read. If the
+                // corresponding location in the occupancy array is 1 the method
+                // will use bsg_print_hexadecimal to signal an error and return
+                // -1. If the command is successful, it will return 0 and
+                // increment occ_idx. Call obtain_wr_ptr* to get the next write
+                // pointer.
+                //
+                // WARNING: DEADLOCK. obtain_wr_ptr_wait in the Source will hang
+                // if finish_rd_ptr is not called on each data range.
+                //
+                // WARNING: DEADLOCK. The Source destructor will hang until all
+                // buffers have been read. Users must call finish_rd_ptr on ALL
+                // data transferred.
+                __attribute__((noinline))
+                int finish_rd_ptr(){
+                        unsigned char *occupancy = this->get_occ_ptr();
+                        volatile unsigned char &o = occupancy[this->occ_idx];
+
+                        if(!o){
+                                bsg_print_hexadecimal(0xF1F0E003);
+                                return -1;
+                        }
+
+                        // TODO: Flush, if necessary?
+                        o = 0;
+                        this->occ_idx = (this->occ_idx + 1) % DEPTH;
+                        return 0;
+                }
+
+        };
+
+        /*
+         * Channels: Source/Dest pairs whose endpoints, slot size (n) and
+         * depth are chosen at runtime, so that the host can pick the
+         * topology at launch, and a tile can host any number of them.
+         *
+         * Each channel has an id that is unique in the tile group, and
+         * is paired through entry id of the channel table of its two
+         * tiles (a per-tile array in DMEM), instead of through the
+         * statics of a template instantiation. As in Source/Dest, the
+         * Dest owns the data buffer (n * depth elements) and the
+         * ChannelSource owns the occupancy flags (depth bytes). Both are
+         * provided by the caller (usually DMEM arrays), and both
+         * endpoints must be constructed with the same n and depth.
+         *
+         * The methods, and the rules for using them (construct, or
+         * open, ALL channels, THEN call init_wait on each), are those
+         * of Source/Dest.
+         */
+
+        // Number of entries in the channel table (channel ids must be
+        // less than this). Define it before including this file to
+        // change it.
+#ifndef CIRCULAR_BUFFER_CHANNELS
+#define CIRCULAR_BUFFER_CHANNELS 32
+#endif
+
+        struct Channel{
+                // Occupancy flags of the ChannelSource (set on both tiles)
+                unsigned char *volatile occ;
+                // Data buffer of the ChannelDest (set on both tiles)
+                void *volatile buf;
+                // Credit counter of the CreditSource (set on both tiles)
+                uint32_t *volatile credit;
+        };
+
+        // The channel table of this tile
+        static Channel channel_table[CIRCULAR_BUFFER_CHANNELS];
+
+        template<typename T>
+        class ChannelSource {
+                Channel *channel = nullptr;
+                unsigned char *occupancy;
+                unsigned int n, depth;
+                unsigned int occ_idx = 0;
+
+        public:
+                // An unopened channel (e.g. in an array), see open
+                ChannelSource(){}
+
+                ChannelSource(unsigned int id, unsigned int dst_y, unsigned int dst_x,
+                              unsigned char *occupancy, unsigned int n, unsigned int depth){
+                        open(id, dst_y, dst_x, occupancy, n, depth);
+                }
+
+                // Pairs this ChannelSource with the ChannelDest of channel
+                // id on tile (dst_y, dst_x)
+                __attribute__((noinline))
+                void open(unsigned int id, unsigned int dst_y, unsigned int dst_x,
+                          unsigned char *occupancy, unsigned int n, unsigned int depth){
+                        // Error: The channel id is outside of the table
+                        if(id >= CIRCULAR_BUFFER_CHANNELS)
+                                bsg_print_hexadecimal(0xF1F0E300);
+
+                        channel = &channel_table[id % CIRCULAR_BUFFER_CHANNELS];
+                        this->occupancy = occupancy;
+                        this->n = n;
+                        this->depth = depth;
+
+                        // Error: Someone initialized occ. Were two
+                        // ChannelSource objects declared with this id?
+                        if(channel->occ != nullptr)
+                                bsg_print_hexadecimal(0xF1F0E301);
+
+                        for(unsigned int i = 0; i < depth; ++i)
+                                occupancy[i] = 0;
+
+                        // Set our occ, and Dest's occ to the remote
+                        // address of our occupancy flags
+                        Channel *dst_channel = bsg_remote_pointer(dst_y, dst_x, channel);
+                        channel->occ = occupancy;
+                        dst_channel->occ = bsg_remote_pointer(__bsg_y, __bsg_x, occupancy);
+                }
+
+                __attribute__((noinline))
+                ~ChannelSource(){
+                        if(channel == nullptr)
+                                return;
+
+                        unsigned int idx = occ_idx != 0 ? occ_idx - 1 : depth - 1;
+
+                        // WARNING: Race Condition
+
+                        // If SOURCE finishes before DEST we want to avoid
+                        // cleaning up our occupancy flags before DEST finishes
+                        volatile unsigned char &o = occupancy[idx];
+
+                        while(o);
+
+                        channel->occ = nullptr;
+                        channel->buf = nullptr;
+                }
+
+                // init_wait blocks until the destination has finished initialization.
+                //
+                // USERS MUST INSTANTIATE ALL Channel OBJECTS BEFORE
+                // CALLING init_wait. NOT DOING THIS RISKS DEADLOCK.
+                __attribute__((noinline))
+                void init_wait(){
+                        while(channel->buf == nullptr);
+                        occ_idx = 0;
+                }
+
+                // As Source::obtain_wr_ptr
+                __attribute__((noinline))
+                T *obtain_wr_ptr(){
+                        volatile unsigned char &o = occupancy[occ_idx];
+
+                        if(o)
+                                return nullptr;
+
+                        T *buffer = static_cast<T *>(channel->buf);
+                        return &buffer[occ_idx * n];
+                }
+
+                // As Source::obtain_wr_ptr_wait
+                __attribute__((noinline))
+                T *obtain_wr_ptr_wait(){
+                        volatile unsigned char &o = occupancy[occ_idx];
+
+                        while(o);
+
+                        T *buffer = static_cast<T *>(channel->buf);
+                        return &buffer[occ_idx * n];
+                }
+
+                // As Source::finish_wr_ptr
+                __attribute__((noinline))
+                int finish_wr_ptr(){
+                        volatile unsigned char &o = occupancy[occ_idx];
+
+                        if(o){
+                                bsg_print_hexadecimal(0xF1F0E303);
+                                return -1;
+                        }
+
+                        bsg_fence();
+                        o = 1;
+
+                        occ_idx = (occ_idx + 1) % depth;
+                        return 0;
+                }
+        };
+
+        template<typename T>
+        class ChannelDest {
+                Channel *channel = nullptr;
+                T *buffer;
+                unsigned int n, depth;
+                unsigned int occ_idx = 0;
+
+        public:
+                // An unopened channel (e.g. in an array), see open
+                ChannelDest(){}
+
+                ChannelDest(unsigned int id, unsigned int src_y, unsigned int src_x,
+                            T *buffer, unsigned int n, unsigned int depth){
+                        open(id, src_y, src_x, buffer, n, depth);
+                }
+
+                // Pairs this ChannelDest with the ChannelSource of channel
+                // id on tile (src_y, src_x)
+                __attribute__((noinline))
+                void open(unsigned int id, unsigned int src_y, unsigned int src_x,
+                          T *buffer, unsigned int n, unsigned int depth){
+                        // Error: The channel id is outside of the table
+                        if(id >= CIRCULAR_BUFFER_CHANNELS)
+                                bsg_print_hexadecimal(0xF1F0E200);
+
+                        channel = &channel_table[id % CIRCULAR_BUFFER_CHANNELS];
+                        this->buffer = buffer;
+                        this->n = n;
+                        this->depth = depth;
+
+                        // Error: Someone initialized buf. Were two
+                        // ChannelDest objects declared with this id?
+                        if(channel->buf != nullptr)
+                                bsg_print_hexadecimal(0xF1F0E201);
+
+                        // Set our buf, and Source's buf to the remote
+                        // address of our buffer
+                        Channel *src_channel = bsg_remote_pointer(src_y, src_x, channel);
+                        channel->buf = buffer;
+                        src_channel->buf = bsg_remote_pointer(__bsg_y, __bsg_x, buffer);
+                }
+
+                __attribute__((noinline))
+                ~ChannelDest(){
+                        if(channel == nullptr)
+                                return;
+
+                        unsigned int idx = occ_idx != 0 ? occ_idx - 1 : depth - 1;
+
+                        // WARNING: Race Condition
+
+                        // As in Dest, "throw a warning" if there's still
+                        // data available.
+                        volatile unsigned char &o = channel->occ[idx];
+                        if(o)
+                                bsg_print_hexadecimal(0xF1F0EDED);
+
+                        channel->occ = nullptr;
+                        channel->buf = nullptr;
+                }
+
+                // init_wait blocks until the Source has finished initialization.
+                //
+                // USERS MUST INSTANTIATE ALL Channel OBJECTS BEFORE
+                // CALLING init_wait. NOT DOING THIS RISKS DEADLOCK.
+                __attribute__((noinline))
+                void init_wait(){
+                        while(channel->occ == nullptr);
+                        occ_idx = 0;
+                }
+
+                // As Dest::obtain_rd_ptr
+                __attribute__((noinline))
+                const T *obtain_rd_ptr(){
+                        volatile unsigned char &o = channel->occ[occ_idx];
+
+                        if(!o)
+                                return nullptr;
+
+                        return &buffer[occ_idx * n];
+                }
+
+                // As Dest::obtain_rd_ptr_wait
+                __attribute__((noinline))
+                const T *obtain_rd_ptr_wait(){
+                        volatile unsigned char &o = channel->occ[occ_idx];
+
+                        while(!o);
+
+                        return &buffer[occ_idx * n];
+                }
+
+                // As Dest::finish_rd_ptr
+                __attribute__((noinline))
+                int finish_rd_ptr(){
+                        volatile unsigned char &o = channel->occ[occ_idx];
+
+                        if(!o){
+                                bsg_print_hexadecimal(0xF1F0E203);
+                                return -1;
+                        }
+
+                        o = 0;
+                        occ_idx = (occ_idx + 1) % depth;
+                        return 0;
+                }
+        };
+
+        /*
+         * Credit-based FIFOs: CreditSource/CreditDest pairs, opened
+         * like ChannelSource/ChannelDest, that move slots of N elements
+         * without any polling across the mesh.
+         *
+         * The CreditDest owns DEPTH slots of N elements, each with a
+         * 32-bit sequence number. The CreditSource writes a whole slot
+         * with (unrolled) remote stores, and then publishes it by
+         * storing its sequence number (the number of slots sent so far)
+         * after a fence. The CreditDest polls the sequence number in its
+         * own DMEM, so slots never have to be cleared.
+         *
+         * The CreditSource owns a credit counter: the number of slots
+         * the CreditDest has consumed, which the CreditDest stores
+         * remotely when it finishes a slot. The CreditSource may write
+         * while it has sent fewer than DEPTH slots beyond that, so it
+         * also only polls its own DMEM.
+         */
+        template<typename T, unsigned int N>
+        struct CreditSlot{
+                T data[N];
+                uint32_t seq;
+        };
+
+        template<typename T, unsigned int N, unsigned int DEPTH = 4>
+        class CreditSource {
+                Channel *channel = nullptr;
+                uint32_t credit = 0;
+                uint32_t sent = 0;
+
+        public:
+                // An unopened FIFO (e.g. in an array), see open
+                CreditSource(){}
+
+                CreditSource(unsigned int id, unsigned int dst_y, unsigned int dst_x){
+                        open(id, dst_y, dst_x);
+                }
+
+                // Pairs this CreditSource with the CreditDest of channel
+                // id on tile (dst_y, dst_x)
+                __attribute__((noinline))
+                void open(unsigned int id, unsigned int dst_y, unsigned int dst_x){
+                        // Error: The channel id is outside of the table
+                        if(id >= CIRCULAR_BUFFER_CHANNELS)
+                                bsg_print_hexadecimal(0xF1F0E500);
+
+                        channel = &channel_table[id % CIRCULAR_BUFFER_CHANNELS];
+                        credit = 0;
+                        sent = 0;
+
+                        // Error: Someone initialized credit. Were two
+                        // CreditSource objects declared with this id?
+                        if(channel->credit != nullptr)
+                                bsg_print_hexadecimal(0xF1F0E501);
+
+                        // Set our credit, and Dest's credit to the
+                        // remote address of our credit counter
+                        Channel *dst_channel = bsg_remote_pointer(dst_y, dst_x, channel);
+                        channel->credit = &credit;
+                        dst_channel->credit = bsg_remote_pointer(__bsg_y, __bsg_x, &credit);
+                }
+
+                __attribute__((noinline))
+                ~CreditSource(){
+                        if(channel == nullptr)
+                                return;
+
+                        // Wait until Dest has consumed every slot, so
+                        // that it doesn't store a credit after we are gone
+                        volatile uint32_t &c = credit;
+
+                        while(c != sent);
+
+                        channel->credit = nullptr;
+                        channel->buf = nullptr;
+                }
+
+                // init_wait blocks until the destination has finished initialization.
+                //
+                // USERS MUST INSTANTIATE ALL Credit OBJECTS BEFORE
+                // CALLING init_wait. NOT DOING THIS RISKS DEADLOCK.
+                __attribute__((noinline))
+                void init_wait(){
+                        while(channel->buf == nullptr);
+                }
+
+                // obtain_wr_ptr returns a (remote) pointer to the current
+                // slot, or nullptr if there are no credits.
+                __attribute__((noinline))
+                T *obtain_wr_ptr(){
+                        volatile uint32_t &c = credit;
+
+                        if(sent - c >= DEPTH)
+                                return nullptr;
+
+                        CreditSlot<T, N> *slots = static_cast<CreditSlot<T, N> *>(channel->buf);
+                        return slots[sent % DEPTH].data;
+                }
+
+                // obtain_wr_ptr_wait waits for a credit, and returns a
+                // (remote) pointer to the current slot.
+                __attribute__((noinline))
+                T *obtain_wr_ptr_wait(){
+                        volatile uint32_t &c = credit;
+
+                        while(sent - c >= DEPTH);
+
+                        CreditSlot<T, N> *slots = static_cast<CreditSlot<T, N> *>(channel->buf);
+                        return slots[sent % DEPTH].data;
+                }
+
+                // finish_wr_ptr publishes the current slot to the
+                // destination with its sequence number.
+                __attribute__((noinline))
+                int finish_wr_ptr(){
+                        CreditSlot<T, N> *slots = static_cast<CreditSlot<T, N> *>(channel->buf);
+                        volatile uint32_t &seq = slots[sent % DEPTH].seq;
+
+                        bsg_fence();
+                        seq = ++sent;
+                        return 0;
+                }
+
+                // send waits for a credit, copies N elements from src
+                // into the current slot and publishes it.
+                __attribute__((noinline))
+                int send(const T *src){
+                        T *dst = obtain_wr_ptr_wait();
+
+#pragma GCC unroll 16
+                        for(unsigned int n = 0; n < N; ++n)
+                                dst[n] = src[n];
+
+                        return finish_wr_ptr();
+                }
+        };
+
+        template<typename T, unsigned int N, unsigned int DEPTH = 4>
+        class CreditDest {
+                Channel *channel = nullptr;
+                CreditSlot<T, N> slots[DEPTH];
+                uint32_t received = 0;
+
+        public:
+                // An unopened FIFO (e.g. in an array), see open
+                CreditDest(){}
+
+                CreditDest(unsigned int id, unsigned int src_y, unsigned int src_x){
+                        open(id, src_y, src_x);
+                }
+
+                // Pairs this CreditDest with the CreditSource of channel
+                // id on tile (src_y, src_x)
+                __attribute__((noinline))
+                void open(unsigned int id, unsigned int src_y, unsigned int src_x){
+                        // Error: The channel id is outside of the table
+                        if(id >= CIRCULAR_BUFFER_CHANNELS)
+                                bsg_print_hexadecimal(0xF1F0E400);
+
+                        channel = &channel_table[id % CIRCULAR_BUFFER_CHANNELS];
+                        received = 0;
+
+                        // Error: Someone initialized buf. Were two
+                        // CreditDest objects declared with this id?
+                        if(channel->buf != nullptr)
+                                bsg_print_hexadecimal(0xF1F0E401);
+
+                        for(unsigned int i = 0; i < DEPTH; ++i)
+                                slots[i].seq = 0;
+
+                        // Set our buf, and Source's buf to the remote
+                        // address of our slots
+                        Channel *src_channel = bsg_remote_pointer(src_y, src_x, channel);
+                        channel->buf = slots;
+                        src_channel->buf = bsg_remote_pointer(__bsg_y, __bsg_x, slots);
+                }
+
+                __attribute__((noinline))
+                ~CreditDest(){
+                        if(channel == nullptr)
+                                return;
+
+                        // As in Dest, "throw a warning" if there's still
+                        // data available.
+                        volatile uint32_t &seq = slots[received % DEPTH].seq;
+                        if(seq == received + 1)
+                                bsg_print_hexadecimal(0xF1F0EDED);
+
+                        channel->credit = nullptr;
+                        channel->buf = nullptr;
+                }
+
+                // init_wait blocks until the Source has finished initialization.
+                //
+                // USERS MUST INSTANTIATE ALL Credit OBJECTS BEFORE
+                // CALLING init_wait. NOT DOING THIS RISKS DEADLOCK.
+                __attribute__((noinline))
+                void init_wait(){
+                        while(channel->credit == nullptr);
+                }
+
+                // obtain_rd_ptr returns a pointer to the current slot, or
+                // nullptr if it has not been published yet.
+                __attribute__((noinline))
+                const T *obtain_rd_ptr(){
+                        volatile uint32_t &seq = slots[received % DEPTH].seq;
+
+                        if(seq != received + 1)
+                                return nullptr;
+
+                        return slots[received % DEPTH].data;
+                }
+
+                // obtain_rd_ptr_wait waits until the current slot is
+                // published, and returns a pointer to it.
+                __attribute__((noinline))
+                const T *obtain_rd_ptr_wait(){
+                        volatile uint32_t &seq = slots[received % DEPTH].seq;
+
+                        while(seq != received + 1);
+
+                        return slots[received % DEPTH].data;
+                }
+
+                // finish_rd_ptr returns the credit for the current slot
+                // to the Source.
+                //
+                // WARNING: DEADLOCK. The Source hangs if finish_rd_ptr
+                // is not called on each slot.
+                __attribute__((noinline))
+                int finish_rd_ptr(){
+                        volatile uint32_t *credit = channel->credit;
+
+                        *credit = ++received;
+                        return 0;
+                }
+        };
+}
+#endif
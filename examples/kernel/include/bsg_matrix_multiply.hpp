@@ -0,0 +1,49 @@
+#ifndef __BSG_MATRIX_MULTIPLY_HPP
+#define __BSG_MATRIX_MULTIPLY_HPP
+#include <cstdint>
+
+/*
+ * Matrix multiplication for kernels, shared by the examples (See
+ * tile_matrix_matrix_multiply and conv2d).
+ */
+
+/*
+ * This is a smarter implementation of matrix multiplication that
+ * multiplies the two matricies A and B and stores the result in C. In
+ * this implementation, B is transposed into BT prior to calling the
+ * kernel and all multiplies used to index the A, B and C arrays are
+ * transformed into additions (nomul). The row-column dot product is
+ * unrolled by a factor of F (a template parameter)
+ */
+template <unsigned int F, typename TA, typename TB, typename TC>
+int __attribute__ ((noinline)) kernel_matrix_multiply_transpose_nomul_unroll (
+                      TA *A, TB *BT, TC *C,
+                      uint32_t A_HEIGHT, uint32_t A_WIDTH,
+                      uint32_t B_WIDTH) {
+
+        uint32_t incr = A_WIDTH * (F-1);
+        for (uint32_t y = 0, ayoff = 0, boff = 0, coff = 0; y < A_HEIGHT; y ++, ayoff += A_WIDTH) {
+                boff = 0;
+                for (uint32_t x = 0; x < B_WIDTH; x += F) {
+                        uint32_t bofff = 0;
+                        TC sum[F] = {{static_cast<TC>(0)}};
+                        for (uint32_t aoff = ayoff; aoff < ayoff + A_WIDTH; aoff++, ++boff) {
+                                bofff = boff;
+#pragma GCC unroll 8 // Does this unroll correctly when F < 4?
+                                for (uint32_t f = 0; f < F; ++f, bofff += A_WIDTH){
+                                        sum[f] += A[aoff] * BT[bofff];
+                                }
+                        }
+
+#pragma GCC unroll 8
+                        for (uint32_t f = 0; f < F; f++){
+                                C[coff + f] = sum[f];
+                        }
+                        boff += incr;
+                        coff += F;
+                }
+        }
+        return 0;
+}
+
+#endif //__BSG_MATRIX_MULTIPLY_HPP
@@ -0,0 +1,169 @@
+#ifndef __BSG_MEMCPY_HPP
+#define __BSG_MEMCPY_HPP
+#include <cstdint>
+#include <cstddef>
+
+/*
+ * Memory copies for kernels, shared by the examples. These are based
+ * on tile_memcopy (See tile_memcopy/kernel/v10):
+ *
+ * - Loads from DRAM have a long latency, but do not block until their
+ *   result is used. The copy issues FACTOR loads before the first
+ *   store; FACTOR = 32 keeps enough loads in flight.
+ *
+ * - Loads and stores are written as flw/fsw in inline assembly, so the
+ *   stores are issued in the same order as the loads that produce them
+ *   and each store only waits for its own load.
+ *
+ * - Stores to DRAM and to the DMEM of another tile do not block, and
+ *   loads from local DMEM take one cycle, so copies out of local DMEM
+ *   need less unrolling.
+ *
+ * bsg_memcpy<FACTOR> copies the word-aligned body of the destination
+ * FACTOR words at a time, and the unaligned head and tail a byte at a
+ * time. If the source is not aligned the same way as the destination,
+ * the body is loaded as aligned words of the source and shifted into
+ * place.
+ *
+ * Use bsg_memcpy_dram_to_dmem, bsg_memcpy_dmem_to_dram and
+ * bsg_memcpy_dmem_to_remote, which choose FACTOR for the direction of
+ * the copy.
+ */
+
+// Words in flight when copying from DRAM into local DMEM
+#ifndef BSG_MEMCPY_LOAD_FACTOR
+#define BSG_MEMCPY_LOAD_FACTOR 32
+#endif
+
+// Words in flight when copying from local DMEM to DRAM, or to the DMEM
+// of another tile
+#ifndef BSG_MEMCPY_STORE_FACTOR
+#define BSG_MEMCPY_STORE_FACTOR 8
+#endif
+
+// The word types used for copying. They may alias any data.
+typedef uint32_t __attribute__ ((__may_alias__)) bsg_memcpy_word_t;
+typedef float __attribute__ ((__may_alias__)) bsg_memcpy_float_t;
+
+// Copy nwords words from src to dst. Both are word-aligned.
+template <unsigned int FACTOR>
+inline void bsg_memcpy_words(void *dst, const void *src, size_t nwords) {
+        const bsg_memcpy_float_t *psrc = reinterpret_cast<const bsg_memcpy_float_t *>(src);
+        bsg_memcpy_float_t *pdest = reinterpret_cast<bsg_memcpy_float_t *>(dst);
+        const bsg_memcpy_float_t *pend = psrc + nwords / FACTOR * FACTOR;
+
+        for (; psrc != pend; psrc += FACTOR, pdest += FACTOR) {
+                float rtemp[FACTOR];
+#pragma GCC unroll 32
+                for (unsigned int f = 0; f < FACTOR; f++) {
+#ifdef __riscv
+                        asm volatile ("flw %0,%1" : "=f" (rtemp[f]) : "m" (psrc[f]));
+#else
+                        rtemp[f] = psrc[f];
+#endif
+                }
+
+#pragma GCC unroll 32
+                for (unsigned int f = 0; f < FACTOR; f++) {
+#ifdef __riscv
+                        asm volatile ("fsw %1,%0" : "=m" (pdest[f]) : "f" (rtemp[f]));
+#else
+                        pdest[f] = rtemp[f];
+#endif
+                }
+        }
+
+        // The remaining words (fewer than FACTOR)
+        const bsg_memcpy_word_t *wsrc = reinterpret_cast<const bsg_memcpy_word_t *>(psrc);
+        bsg_memcpy_word_t *wdest = reinterpret_cast<bsg_memcpy_word_t *>(pdest);
+        for (size_t i = 0; i < nwords % FACTOR; ++i)
+                wdest[i] = wsrc[i];
+}
+
+// Copy nwords words from src to dst. dst is word-aligned, and src is
+// not: each word of dst is made from two aligned words of src. Only
+// the aligned words that contain bytes of the copy are loaded.
+template <unsigned int FACTOR>
+inline void bsg_memcpy_words_shifted(void *dst, const void *src, size_t nwords) {
+        uintptr_t off = reinterpret_cast<uintptr_t>(src) & 0x3;
+        const bsg_memcpy_word_t *psrc =
+                reinterpret_cast<const bsg_memcpy_word_t *>(reinterpret_cast<uintptr_t>(src) - off);
+        bsg_memcpy_word_t *pdest = reinterpret_cast<bsg_memcpy_word_t *>(dst);
+        const uint32_t rshift = 8 * off, lshift = 32 - rshift;
+        size_t i = 0;
+
+        if (!nwords)
+                return;
+
+        uint32_t lo = psrc[0];
+        for (; i + FACTOR <= nwords; i += FACTOR) {
+                uint32_t rtemp[FACTOR];
+#pragma GCC unroll 32
+                for (unsigned int f = 0; f < FACTOR; f++)
+                        rtemp[f] = psrc[i + f + 1];
+
+#pragma GCC unroll 32
+                for (unsigned int f = 0; f < FACTOR; f++) {
+                        pdest[i + f] = (lo >> rshift) | (rtemp[f] << lshift);
+                        lo = rtemp[f];
+                }
+        }
+
+        // The remaining words (fewer than FACTOR)
+        for (; i < nwords; ++i) {
+                uint32_t hi = psrc[i + 1];
+                pdest[i] = (lo >> rshift) | (hi << lshift);
+                lo = hi;
+        }
+}
+
+template <unsigned int FACTOR>
+inline void *bsg_memcpy(void *__restrict dst, const void *__restrict src, size_t n) {
+        unsigned char *pdest = reinterpret_cast<unsigned char *>(dst);
+        const unsigned char *psrc = reinterpret_cast<const unsigned char *>(src);
+        static const uintptr_t C_WORD_MASK = 0x3;
+
+        // Head: bytes up to the first word boundary of dst
+        size_t head = (-reinterpret_cast<uintptr_t>(pdest)) & C_WORD_MASK;
+        if (head > n)
+                head = n;
+        for (size_t i = 0; i < head; ++i)
+                *pdest++ = *psrc++;
+        n -= head;
+
+        // Body: whole words of dst
+        size_t nwords = n / sizeof(bsg_memcpy_word_t);
+        if (reinterpret_cast<uintptr_t>(psrc) & C_WORD_MASK)
+                bsg_memcpy_words_shifted<FACTOR>(pdest, psrc, nwords);
+        else
+                bsg_memcpy_words<FACTOR>(pdest, psrc, nwords);
+        pdest += nwords * sizeof(bsg_memcpy_word_t);
+        psrc += nwords * sizeof(bsg_memcpy_word_t);
+
+        // Tail: the remaining bytes
+        for (size_t i = 0; i < (n & C_WORD_MASK); ++i)
+                *pdest++ = *psrc++;
+
+        return dst;
+}
+
+// Copy n bytes from DRAM into local DMEM
+inline __attribute__ ((noinline))
+void *bsg_memcpy_dram_to_dmem(void *__restrict dst, const void *__restrict src, size_t n) {
+        return bsg_memcpy<BSG_MEMCPY_LOAD_FACTOR>(dst, src, n);
+}
+
+// Copy n bytes from local DMEM to DRAM
+inline __attribute__ ((noinline))
+void *bsg_memcpy_dmem_to_dram(void *__restrict dst, const void *__restrict src, size_t n) {
+        return bsg_memcpy<BSG_MEMCPY_STORE_FACTOR>(dst, src, n);
+}
+
+// Copy n bytes from local DMEM to the DMEM of another tile. dst is a
+// remote pointer (e.g. from bsg_tile_group_remote_pointer).
+inline __attribute__ ((noinline))
+void *bsg_memcpy_dmem_to_remote(void *__restrict dst, const void *__restrict src, size_t n) {
+        return bsg_memcpy<BSG_MEMCPY_STORE_FACTOR>(dst, src, n);
+}
+
+#endif
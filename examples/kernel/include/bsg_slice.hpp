@@ -0,0 +1,55 @@
+#ifndef __BSG_SLICE_HPP
+#define __BSG_SLICE_HPP
+#include <cstdint>
+
+/*
+ * Contiguous slices of a 1-D array, and a sum with several loads in
+ * flight, for kernels, shared by the examples (See reduction and
+ * scan).
+ */
+
+// The slice [*begin, *end) of the N elements of an array that belongs
+// to part id of parts: ceil(N / parts) elements, clamped to N.
+inline void bsg_slice(uint32_t N, uint32_t parts, uint32_t id,
+                      uint32_t *begin, uint32_t *end) {
+        const uint32_t slice = (N + parts - 1) / parts;
+        *begin = id * slice < N ? id * slice : N;
+        *end = *begin + slice < N ? *begin + slice : N;
+}
+
+// The slice of this tile, among the tiles of the tile group
+inline void bsg_tile_slice(uint32_t N, uint32_t *begin, uint32_t *end) {
+        bsg_slice(N, bsg_tiles_X * bsg_tiles_Y, bsg_id, begin, end);
+}
+
+// The slice of this tile group, among the tile groups of the grid
+inline void bsg_grid_slice(uint32_t N, uint32_t *begin, uint32_t *end) {
+        bsg_slice(N, __bsg_grid_dim_x * __bsg_grid_dim_y, __bsg_tile_group_id, begin, end);
+}
+
+// Returns the sum of the n elements of A. The sum is split into F
+// partial sums so that F loads are in flight at a time.
+template <uint32_t F, typename TA>
+TA bsg_slice_sum(const TA *A, uint32_t n) {
+        TA acc[F];
+#pragma GCC unroll 8
+        for (uint32_t f = 0; f < F; ++f)
+                acc[f] = static_cast<TA>(0);
+
+        uint32_t i = 0;
+        for (; i + F <= n; i += F) {
+#pragma GCC unroll 8
+                for (uint32_t f = 0; f < F; ++f)
+                        acc[f] += A[i + f];
+        }
+        for (; i < n; ++i)
+                acc[0] += A[i];
+
+        TA sum = acc[0];
+#pragma GCC unroll 8
+        for (uint32_t f = 1; f < F; ++f)
+                sum += acc[f];
+        return sum;
+}
+
+#endif //__BSG_SLICE_HPP
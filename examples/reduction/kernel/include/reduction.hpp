@@ -1,6 +1,7 @@
 #ifndef __REDUCTION_HPP
 #define __REDUCTION_HPP
 #include <cstdint>
+#include <bsg_slice.hpp>
 
 template <typename TA>
 int  __attribute__ ((noinline)) kernel_reduction_single_thread(TA *A, uint32_t N) {
@@ -159,6 +160,157 @@ int  __attribute__ ((noinline)) kernel_reduction_multi_thread(TA *A, uint32_t N)
         return 0;
 }
 
+// Returns a pointer to ptr in the DMEM of the tile at (x, y) in the
+// tile group.
+template <typename T>
+T *reduction_remote_ptr(uint32_t x, uint32_t y, T *ptr) {
+#ifdef BSG_NATIVE
+        return reinterpret_cast<T *>(bsg_remote_ptr(x, y, ptr));
+#else
+        uintptr_t remote_prefix = (REMOTE_EPA_PREFIX << REMOTE_EPA_MASK_SHIFTS);
+        uintptr_t y_bits = ((y) << Y_CORD_SHIFTS);
+        uintptr_t x_bits = ((x) << X_CORD_SHIFTS);
+        uintptr_t local_bits = reinterpret_cast<uintptr_t>(ptr);
+        return reinterpret_cast<T *>(remote_prefix | y_bits | x_bits | local_bits);
+#endif
+}
+
+// A partial sum sent to another tile: full is set after value is
+// written, and cleared by the receiving tile once it has read value.
+template <typename TA>
+struct reduction_mailbox {
+        volatile TA value;
+        volatile uint32_t full;
+};
+
+// The maximum number of rounds of the reduction tree (log2 of the
+// number of tiles in the tile group, rounded up)
+#define REDUCTION_MAX_ROUNDS 16
+
+// Sum the N elements of A with the tiles of the tile group, in two
+// levels, and return the sum on tile 0 (bsg_id == 0). The other tiles
+// return partial sums.
+template <uint32_t F, typename TA>
+TA __attribute__ ((noinline)) reduction_tile_group_sum(const TA *A, uint32_t N) {
+
+        // One mailbox per round of the tree, in each tile's DMEM
+        static reduction_mailbox<TA> mailbox[REDUCTION_MAX_ROUNDS];
+
+        // Level 1: Each tile sums a contiguous slice of A, of
+        // ceil(N / tiles) elements, directly from DRAM, with F loads in
+        // flight.
+        const uint32_t tiles = bsg_tiles_X * bsg_tiles_Y;
+        uint32_t begin, end;
+        bsg_tile_slice(N, &begin, &end);
+        TA sum = bsg_slice_sum<F>(&A[begin], end - begin);
+
+        // Level 2: The tiles combine their sums in a tree. In round r
+        // (stride = 2^r), each tile with bsg_id % (2 * stride) ==
+        // stride sends its sum to the mailbox of tile bsg_id - stride
+        // with remote stores, and is done. That tile waits for its
+        // mailbox, instead of a tile group barrier per round.
+        //
+        // |1|1|1|1|1|1|1|1|   Stride: 1
+        //  |/  |/  |/  |/
+        // |2| |2| |2| |2|     Stride: 2
+        //  |  /    |  /
+        //  |/      |/
+        // |4|     |4|         Stride: 4
+        //  |     /
+        //  |/
+        // |8|
+        for (uint32_t r = 0, stride = 1; stride < tiles; ++r, stride *= 2) {
+                if (bsg_id & stride) {
+                        uint32_t dst = bsg_id - stride;
+                        reduction_mailbox<TA> *box =
+                                reduction_remote_ptr(dst % bsg_tiles_X, dst / bsg_tiles_X, &mailbox[r]);
+                        box->value = sum;
+#ifdef __riscv
+                        // The sum must arrive before the flag
+                        asm volatile ("fence" ::: "memory");
+#endif
+                        box->full = 1;
+                        break;
+                }
+
+                if (bsg_id + stride < tiles) {
+                        while (!mailbox[r].full);
+                        sum += mailbox[r].value;
+                        mailbox[r].full = 0;
+                }
+        }
 
+        return sum;
+}
+
+template <uint32_t F, typename TA>
+int  __attribute__ ((noinline)) kernel_reduction_two_level(TA *A, uint32_t N) {
+        TA sum = reduction_tile_group_sum<F>(A, N);
+
+        // Tile 0 holds the sum of A. Every tile has finished reading
+        // its slice of A, so A[0] can be overwritten.
+        if (bsg_id == 0) {
+                A[0] = sum;
+        }
+
+        bsg_tile_group_barrier(&r_barrier, &c_barrier);
+
+        return 0;
+}
+
+/*
+ * Grid-wide reduction. Tile groups cannot communicate through tile
+ * group shared memory or barriers, so the tile groups of the grid each
+ * sum a contiguous slice of A (ceil(N / tile groups) elements, with
+ * reduction_tile_group_sum) and combine their sums through DRAM,
+ * either:
+ *
+ * - kernel_reduction_grid_partials: Each tile group writes its sum to
+ *   partials[__bsg_tile_group_id]. A second kernel, launched after it
+ *   (e.g. kernel_reduction_two_level on partials), sums the partials.
+ *
+ * - kernel_reduction_grid_atomic: Each tile group adds its sum to
+ *   *result with a DRAM atomic (amoadd.w). This is only possible for
+ *   32-bit integers, and *result must be zero beforehand.
+ */
+
+template <uint32_t F, typename TA>
+int  __attribute__ ((noinline)) kernel_reduction_grid_partials(TA *A, uint32_t N, TA *partials) {
+        uint32_t begin, end;
+        bsg_grid_slice(N, &begin, &end);
+
+        TA sum = reduction_tile_group_sum<F>(&A[begin], end - begin);
+        if (bsg_id == 0) {
+                partials[__bsg_tile_group_id] = sum;
+        }
+
+        bsg_tile_group_barrier(&r_barrier, &c_barrier);
+
+        return 0;
+}
+
+// *p += v, atomically
+inline void reduction_atomic_add(int32_t *p, int32_t v) {
+#ifdef __riscv
+        asm volatile ("amoadd.w zero, %1, %0" : "+A" (*p) : "r" (v) : "memory");
+#else
+        __atomic_fetch_add(p, v, __ATOMIC_RELAXED);
+#endif
+}
+
+template <uint32_t F>
+int  __attribute__ ((noinline)) kernel_reduction_grid_atomic(int32_t *A, uint32_t N, int32_t *result) {
+        uint32_t begin, end;
+        bsg_grid_slice(N, &begin, &end);
+
+        int32_t sum = reduction_tile_group_sum<F>(&A[begin], end - begin);
+        if (bsg_id == 0) {
+                reduction_atomic_add(result, sum);
+        }
+
+        bsg_tile_group_barrier(&r_barrier, &c_barrier);
+
+        return 0;
+}
 
 #endif //__REDUCTION_HPP
@@ -0,0 +1,42 @@
+/*
+ * This kernel performs a two-level reduction: each tile sums a slice
+ * of A from DRAM, and the tiles combine their sums in a tree of remote
+ * stores.
+ */
+
+// BSG_TILE_GROUP_X_DIM and BSG_TILE_GROUP_Y_DIM must be defined
+// before bsg_manycore.h and bsg_tile_group_barrier.h are
+// included. bsg_tiles_X and bsg_tiles_Y must also be defined for
+// legacy reasons, but they are deprecated.
+#define BSG_TILE_GROUP_X_DIM 4
+#define BSG_TILE_GROUP_Y_DIM 4
+#define bsg_tiles_X BSG_TILE_GROUP_X_DIM
+#define bsg_tiles_Y BSG_TILE_GROUP_Y_DIM
+#include <bsg_manycore.h>
+#include <bsg_tile_group_barrier.h>
+#include <cstdint>
+INIT_TILE_GROUP_BARRIER(r_barrier, c_barrier, 0, bsg_tiles_X-1, 0, bsg_tiles_Y-1);
+
+#include <reduction.hpp>
+
+// Partial sums (loads in flight) per tile
+#ifndef REDUCTION_UNROLL
+#define REDUCTION_UNROLL 4
+#endif
+
+
+extern "C" {
+        int  __attribute__ ((noinline)) kernel_reduction(
+                      float *A, uint32_t N) {
+                int rc;
+                bsg_cuda_print_stat_kernel_start();
+                bsg_cuda_print_stat_start(0);
+                rc = kernel_reduction_two_level<REDUCTION_UNROLL>(A, N);
+                bsg_cuda_print_stat_end(0);
+
+                bsg_tile_group_barrier(&r_barrier, &c_barrier);
+
+                bsg_cuda_print_stat_kernel_end();
+                return rc;
+        }
+}
@@ -31,15 +31,19 @@
  * Runs the tile-group shared memory reduction on a grid of tile groups. A[0] <-- sum (A[i])
  */
 
-// Vector sizes:
-#define WIDTH_V0 16
-#define WIDTH_V1 64
-#define NUM_ITER 1
+// Default vector sizes (--size):
+#define DEFAULT_WIDTH_V0 16
+#define DEFAULT_WIDTH_V1 64
+#define DEFAULT_WIDTH_V2 4096
+#define DEFAULT_WIDTH_GRID (1 << 20)
+
+// Elements per tile group in the grid-wide reductions (v3 and v4)
+#define GROUP_WIDTH 16384
 
 // Host Vector Reduction (to compare results)
 // Sums all elements of vector into first element
 template <typename TA>
-void vector_reduce (TA *A, TA *B, uint64_t N) {
+void vector_reduce (const TA *A, TA *B, uint64_t N) {
         *B = 0;
         for (uint64_t x = 0; x < N; x ++) {
                 *B += A[x];
@@ -48,79 +52,56 @@ void vector_reduce (TA *A, TA *B, uint64_t N) {
 }
 
 
-// Compute the squared error between A & B
-template <typename T>
-double single_sse (const T *A, const T *B) {
-        double err = 0;
-        T diff = *A - *B;
-        if(std::isnan(diff)){
-                return diff;
-        }
-        err = diff * diff;
-        return err;
-}
 
 
+// How the partial sums of the tile groups are combined
+enum reduction_mode {
+        // One tile group, which stores the sum in A[0] (v0 - v2)
+        REDUCTION_IN_PLACE,
+        // Each tile group stores its sum in partials, and a second
+        // kernel sums the partials into partials[0] (v3)
+        REDUCTION_PARTIALS,
+        // Each tile group adds its sum to a result in DRAM with an
+        // atomic (v4)
+        REDUCTION_ATOMIC
+};
 
-int kernel_reduction (int argc, char **argv) {
-
+// Run a reduction of N elements of type T and check the result
+template <typename T>
+int run_reduction (const char *bin_path, const char *test_name, const char *dtype,
+                   const uint32_t N, const uint64_t seed, const reduction_mode mode,
+                   const hb_mc_dimension_t &tg_dim, const hb_mc_dimension_t &grid_dim) {
         int rc;
-        char *bin_path, *test_name;
-        struct arguments_path args = {NULL, NULL};
-
-        argp_parse (&argp_path, argc, argv, 0, 0, &args);
-        bin_path = args.path;
-        test_name = args.name;
-
-        bsg_pr_test_info("Running the CUDA Tile-Group Shared Memory "
-                         "Reduction Kernel.\n\n");
 
-        // Define tg_dim_x/y: number of tiles in each tile group
-        // Grid dimension is fixed to 1x1
-        // Remember, reduction is only possible inside one tile group 
-        hb_mc_dimension_t tg_dim = { .x = 0, .y = 0 };
-        hb_mc_dimension_t grid_dim = { .x = 0, .y = 0 };
-        uint32_t N;
-        if(!strcmp("v0", test_name)){
-                N = WIDTH_V0;
-                tg_dim = { .x = 4, .y = 4 };
-                grid_dim = {.x = 1, .y = 1};
-        } else if(!strcmp("v1", test_name)){
-                N = WIDTH_V1;
-                tg_dim = { .x = 4, .y = 4 };
-                grid_dim = {.x = 1, .y = 1};
-        } else {
-                bsg_pr_test_err("Invalid version provided!.\n");
-                return HB_MC_INVALID;
-        }
-      
-        // Initialize the random number generators
+        // Initialize the random number generator
         std::numeric_limits<int8_t> lim; // Used to get INT_MIN and INT_MAX in C++
-        std::default_random_engine generator;
-        generator.seed(42);
-        std::uniform_real_distribution<float> distribution(lim.min(),lim.max());
+        host_random A_random(seed);
 
         // Allocate A and R (result) on the host
-        float A[N];
-        float R;
-
-        // Generate random numbers. Since the Manycore can't handle infinities,
-        // subnormal numbers, or NANs, filter those out.
-        auto res = distribution(generator);
-
-        for (uint64_t i = 0; i < N; i++) {
-                do{
-                        res = distribution(generator);
-                }while(!std::isnormal(res) ||
-                       !std::isfinite(res) ||
-                       std::isnan(res));
-
-                A[i] = static_cast<float>(res);
+        host_buffer<T> A(N);
+        T R, result;
+
+        // Load A and the known-correct result R from the dataset cache,
+        // or generate them.
+        host_dataset cache("reduction", dtype, {N}, seed);
+        if (!cache.load({{"A", A.data(), A.size_bytes()},
+                         {"R", &R, sizeof(R)}})) {
+                // Generate random numbers. Since the Manycore can't
+                // handle infinities, subnormal numbers, or NANs,
+                // host_random filters those out.
+                A_random.uniform(A.data(), A.size(), (T) lim.min(), (T) lim.max());
+
+                // Generate the known-correct result on the host
+                vector_reduce (A.data(), &R, N);
+
+                cache.store({{"A", A.data(), A.size_bytes()},
+                             {"R", &R, sizeof(R)}});
         }
 
-
-        // Generate the known-correct result on the host
-        vector_reduce (A, &R, N);
+        // The sum of the magnitudes of A, for the comparison tolerance
+        double mag = 0;
+        for (uint64_t i = 0; i < N; i++)
+                mag += std::fabs((double) A[i]);
 
 
         // Initialize device, load binary and unfreeze tiles.
@@ -140,18 +121,41 @@ int kernel_reduction (int argc, char **argv) {
         }
 
 
-        // Allocate memory on the device for A. Since sizeof(float) ==
-        // sizeof(int32_t) > sizeof(int16_t) > sizeof(int8_t) we'll reuse the
-        // same buffers for each test (if multiple tests are conducted)
-        hb_mc_eva_t A_device;
+        // The result is stored in A[0] (REDUCTION_IN_PLACE), in
+        // partials[0] (one partial sum per tile group,
+        // REDUCTION_PARTIALS) or in a separate element
+        // (REDUCTION_ATOMIC).
+        const uint32_t groups = grid_dim.x * grid_dim.y;
+        const uint32_t R_SIZE = mode == REDUCTION_PARTIALS ? groups :
+                                mode == REDUCTION_ATOMIC ? 1 : 0;
+
+        // Reserve device memory for A and the result, and allocate
+        // them from it
+        device_arena arena(&device);
+        rc = arena.init(device_arena::footprint({N * sizeof(T), R_SIZE * sizeof(T)}));
+        if (rc != HB_MC_SUCCESS) {
+                bsg_pr_test_err("failed to reserve device memory.\n");
+                return rc;
+        }
+
+        hb_mc_eva_t A_device, R_device;
 
         // Allocate A on the device
-        rc = hb_mc_device_malloc(&device, N * sizeof(float), &A_device);
+        rc = arena.alloc(N * sizeof(T), &A_device);
         if (rc != HB_MC_SUCCESS) {
                 bsg_pr_test_err("failed to allocate memory on device.\n");
                 return rc;
         }
 
+        R_device = A_device;
+        if (R_SIZE) {
+                rc = arena.alloc(R_SIZE * sizeof(T), &R_device);
+                if (rc != HB_MC_SUCCESS) {
+                        bsg_pr_test_err("failed to allocate memory on device.\n");
+                        return rc;
+                }
+        }
+
 
         // Copy A from host onto device DRAM.
         void *dst = (void *) ((intptr_t) A_device);
@@ -164,13 +168,27 @@ int kernel_reduction (int argc, char **argv) {
                 return rc;
         }
 
+        // The atomic sums are added to a zero result
+        if (mode == REDUCTION_ATOMIC) {
+                T zero = 0;
+                rc = hb_mc_device_memcpy (&device, (void *) ((intptr_t) R_device), &zero,
+                                          sizeof(zero), HB_MC_MEMCPY_TO_DEVICE);
+                if (rc != HB_MC_SUCCESS) {
+                        bsg_pr_test_err("failed to copy memory to device.\n");
+                        return rc;
+                }
+        }
 
-        // Prepare list of input arguments for kernel.
-        uint32_t cuda_argv[2] = {A_device, N};
 
         // Enquque grid of tile groups, pass in grid and tile group dimensions,
         // kernel name, number and list of input arguments
-        rc = hb_mc_kernel_enqueue (&device, grid_dim, tg_dim, "kernel_reduction", 2, cuda_argv);
+        if (mode == REDUCTION_IN_PLACE) {
+                uint32_t cuda_argv[2] = {A_device, N};
+                rc = hb_mc_kernel_enqueue (&device, grid_dim, tg_dim, "kernel_reduction", 2, cuda_argv);
+        } else {
+                uint32_t cuda_argv[3] = {A_device, N, R_device};
+                rc = hb_mc_kernel_enqueue (&device, grid_dim, tg_dim, "kernel_reduction_grid", 3, cuda_argv);
+        }
         if (rc != HB_MC_SUCCESS) {
                 bsg_pr_test_err("failed to initialize grid.\n");
                 return rc;
@@ -183,12 +201,28 @@ int kernel_reduction (int argc, char **argv) {
                 return rc;
         }
 
-        // Copy result (A_device[0]) back from device DRAM into host memory.
-        src = (void *) ((intptr_t) A_device);
-        dst = (void *) &A[0];
-        rc = hb_mc_device_memcpy (&device, dst, src,
-                                  N * sizeof(float),
-                                  HB_MC_MEMCPY_TO_HOST);
+        // Then sum the partial sums on one tile group. This kernel is
+        // only enqueued once every tile group of the first has
+        // finished (see "Kernel ordering" in native/README.md).
+        if (mode == REDUCTION_PARTIALS) {
+                hb_mc_dimension_t finish_dim = { .x = 1, .y = 1 };
+                uint32_t cuda_argv[2] = {R_device, groups};
+                rc = hb_mc_kernel_enqueue (&device, finish_dim, tg_dim, "kernel_reduction", 2, cuda_argv);
+                if (rc != HB_MC_SUCCESS) {
+                        bsg_pr_test_err("failed to initialize grid.\n");
+                        return rc;
+                }
+
+                rc = hb_mc_device_tile_groups_execute(&device);
+                if (rc != HB_MC_SUCCESS) {
+                        bsg_pr_test_err("failed to execute tile groups.\n");
+                        return rc;
+                }
+        }
+
+        // Copy the result back from device DRAM into host memory.
+        rc = hb_mc_device_memcpy (&device, &result, (void *) ((intptr_t) R_device),
+                                  sizeof(result), HB_MC_MEMCPY_TO_HOST);
         if (rc != HB_MC_SUCCESS) {
                 bsg_pr_test_err("failed to copy memory from device.\n");
                 return rc;
@@ -203,17 +237,85 @@ int kernel_reduction (int argc, char **argv) {
 
 
 
-        // Compare the known-correct R and the result A[0]
-        float max = 0.1;
-        double sse = single_sse(&R, &A[0]);
+        // Compare the known-correct R and the result. The kernels
+        // reduce A in a tree, a different order than on the host.
+        return verify_result("R", &R, &result, 1, 1,
+                             host_verify_sum_tolerance<T>(N, mag));
+}
+
+int kernel_reduction (int argc, char **argv) {
 
-        if (std::isnan(sse) || sse > max) {
-                bsg_pr_test_info(BSG_RED("Mismatch. SSE: %f\n"), sse);
-                return HB_MC_FAIL;
-        }
+        char *bin_path, *test_name;
+        struct arguments_size args = {{NULL, NULL}};
+        args.size = 0;
+        args.seed = 42;
+
+        argp_parse (&argp_size, argc, argv, 0, 0, &args);
+        bin_path = args.path.path;
+        test_name = args.path.name;
 
-        bsg_pr_test_info(BSG_GREEN("Match.\n"));
-        return HB_MC_SUCCESS;
+        bsg_pr_test_info("Running the CUDA Tile-Group Shared Memory "
+                         "Reduction Kernel.\n\n");
+
+        // Define tg_dim_x/y: number of tiles in each tile group
+        // Grid dimension is fixed to 1x1, except for the grid-wide
+        // reductions (v3 and v4): tiles in different tile groups
+        // cannot communicate through tile group shared memory.
+        hb_mc_dimension_t tg_dim = { .x = 0, .y = 0 };
+        hb_mc_dimension_t grid_dim = { .x = 0, .y = 0 };
+        reduction_mode mode = REDUCTION_IN_PLACE;
+        uint32_t N;
+        if(!strcmp("v0", test_name)){
+                N = args.size ? args.size : DEFAULT_WIDTH_V0;
+                tg_dim = { .x = 4, .y = 4 };
+                grid_dim = {.x = 1, .y = 1};
+                // v0 assigns exactly one element to each tile
+                if (N != tg_dim.x * tg_dim.y) {
+                        bsg_pr_test_err("v0 requires N to be %u.\n",
+                                        tg_dim.x * tg_dim.y);
+                        return HB_MC_INVALID;
+                }
+        } else if(!strcmp("v1", test_name)){
+                N = args.size ? args.size : DEFAULT_WIDTH_V1;
+                tg_dim = { .x = 4, .y = 4 };
+                grid_dim = {.x = 1, .y = 1};
+                // The reduction tree pairs elements at power-of-two
+                // offsets and does not handle a ragged tail
+                if (N & (N - 1)) {
+                        bsg_pr_test_err("v1 requires N to be a power of two.\n");
+                        return HB_MC_INVALID;
+                }
+                // The shared array of N elements is striped across
+                // the DMEM of the tiles of the tile group
+                uint32_t tiles = tg_dim.x * tg_dim.y;
+                uint64_t stripe_bytes = sizeof(float) * (((uint64_t) N + tiles - 1) / tiles);
+                if (stripe_bytes > BSG_TILE_DMEM_DATA_BYTES) {
+                        bsg_pr_test_err("v1 stores A in tile group shared memory: %llu bytes "
+                                        "per tile do not fit in %u.\n",
+                                        (unsigned long long) stripe_bytes, BSG_TILE_DMEM_DATA_BYTES);
+                        return HB_MC_INVALID;
+                }
+        } else if(!strcmp("v2", test_name)){
+                // v2 splits A into one slice per tile, and takes any N
+                N = args.size ? args.size : DEFAULT_WIDTH_V2;
+                tg_dim = { .x = 4, .y = 4 };
+                grid_dim = {.x = 1, .y = 1};
+        } else if(!strcmp("v3", test_name) || !strcmp("v4", test_name)){
+                // v3 and v4 split A into one slice per tile group, and
+                // the grid grows with N
+                N = args.size ? args.size : DEFAULT_WIDTH_GRID;
+                tg_dim = { .x = 4, .y = 4 };
+                grid_dim = {.x = (N + GROUP_WIDTH - 1) / GROUP_WIDTH, .y = 1};
+                grid_dim.x = grid_dim.x ? grid_dim.x : 1;
+                mode = !strcmp("v3", test_name) ? REDUCTION_PARTIALS : REDUCTION_ATOMIC;
+        } else {
+                bsg_pr_test_err("Invalid version provided!.\n");
+                return HB_MC_INVALID;
+        }
+      
+        if (mode == REDUCTION_ATOMIC)
+                return run_reduction<int32_t>(bin_path, test_name, "int32", N, args.seed, mode, tg_dim, grid_dim);
+        return run_reduction<float>(bin_path, test_name, "float", N, args.seed, mode, tg_dim, grid_dim);
 }
 
 #ifdef COSIM
@@ -0,0 +1,238 @@
+#ifndef __SCAN_HPP
+#define __SCAN_HPP
+#include <cstdint>
+#include <bsg_slice.hpp>
+
+/*
+ * Prefix sums (scans) of A into B, for i in [0, N):
+ *
+ * - Exclusive: B[i] = A[0] + ... + A[i - 1] (B[0] = 0)
+ * - Inclusive: B[i] = A[0] + ... + A[i]
+ *
+ * A and B may be the same array.
+ */
+
+// The smallest power of two that is greater than or equal to n
+constexpr uint32_t scan_pow2(uint32_t n, uint32_t p = 1) {
+        return p >= n ? p : scan_pow2(n, p * 2);
+}
+
+// Serial scan of the n elements of A into B, starting from carry (the
+// sum of everything before A). Returns carry plus the sum of A. F
+// elements are loaded at a time, before the (serial) additions.
+template <uint32_t F, typename TA>
+TA scan_serial(const TA *A, TA *B, uint32_t n, TA carry, uint32_t inclusive) {
+        uint32_t i = 0;
+        for (; i + F <= n; i += F) {
+                TA lc_A[F];
+#pragma GCC unroll 8
+                for (uint32_t f = 0; f < F; ++f)
+                        lc_A[f] = A[i + f];
+
+#pragma GCC unroll 8
+                for (uint32_t f = 0; f < F; ++f) {
+                        TA next = carry + lc_A[f];
+                        B[i + f] = inclusive ? next : carry;
+                        carry = next;
+                }
+        }
+        for (; i < n; ++i) {
+                TA next = carry + A[i];
+                B[i] = inclusive ? next : carry;
+                carry = next;
+        }
+        return carry;
+}
+
+template <typename TA>
+int  __attribute__ ((noinline)) kernel_scan_single_tile(TA *A, TA *B, uint32_t N, uint32_t inclusive) {
+        // Tile 0 scans all of A, as a baseline for the parallel scans
+        if (bsg_id == 0) {
+                scan_serial<1>(A, B, N, static_cast<TA>(0), inclusive);
+        }
+
+        bsg_tile_group_barrier(&r_barrier, &c_barrier);
+
+        return 0;
+}
+
+/*
+ * Work-efficient (Blelloch) exclusive scan of the n elements of sh,
+ * in tile group shared memory. n must be a power of two. The scan is
+ * done in place, in two phases of log2(n) rounds, with a tile group
+ * barrier after each round. As in the reduction, the tiles share out
+ * the elements of each round with a `thread loop`.
+ *
+ * Up-sweep: A reduction tree. In the round with stride s, every
+ * element with index i, where (i + 1) is a multiple of 2s, adds the
+ * element s to its left: sh[i] <-- sh[i] + sh[i - s]. Afterwards,
+ * sh[n - 1] holds the sum of all n elements.
+ *
+ * |1|1|1|1|1|1|1|1|   Stride: 1
+ *   \|  \|  \|  \|
+ * |1|2|1|2|1|2|1|2|   Stride: 2
+ *     \   |   \   |
+ *      \  |    \  |
+ * |1|2|1|4|1|2|1|4|   Stride: 4
+ *         \       |
+ *          \      |
+ * |1|2|1|4|1|2|1|8|
+ *
+ * Down-sweep: sh[n - 1] is cleared, and the tree is walked back down.
+ * In the round with stride s, every element i from the up-sweep passes
+ * its value to the left and adds the old value on the left:
+ * sh[i - s], sh[i] <-- sh[i], sh[i] + sh[i - s].
+ *
+ * |1|2|1|4|1|2|1|0|   Stride: 4
+ * |1|2|1|0|1|2|1|4|   Stride: 2
+ * |1|0|1|2|1|4|1|6|   Stride: 1
+ * |0|1|2|3|4|5|6|7|
+ */
+template <typename TA>
+void scan_blelloch_up_sweep(TA *sh, uint32_t n) {
+        const uint32_t tiles = bsg_tiles_X * bsg_tiles_Y;
+        for (uint32_t stride = 1; stride < n; stride *= 2) {
+                for (uint32_t i = (bsg_id + 1) * 2 * stride - 1; i < n; i += tiles * 2 * stride) {
+                        TA lc_A, lc_B;
+                        bsg_tile_group_shared_load (TA, sh, i - stride, lc_A);
+                        bsg_tile_group_shared_load (TA, sh, i, lc_B);
+                        bsg_tile_group_shared_store (TA, sh, i, lc_A + lc_B);
+                }
+
+                bsg_tile_group_barrier(&r_barrier, &c_barrier);
+        }
+}
+
+template <typename TA>
+void scan_blelloch_down_sweep(TA *sh, uint32_t n) {
+        const uint32_t tiles = bsg_tiles_X * bsg_tiles_Y;
+        if (bsg_id == 0) {
+                bsg_tile_group_shared_store (TA, sh, n - 1, static_cast<TA>(0));
+        }
+
+        bsg_tile_group_barrier(&r_barrier, &c_barrier);
+
+        for (uint32_t stride = n / 2; stride >= 1; stride /= 2) {
+                for (uint32_t i = (bsg_id + 1) * 2 * stride - 1; i < n; i += tiles * 2 * stride) {
+                        TA lc_A, lc_B;
+                        bsg_tile_group_shared_load (TA, sh, i - stride, lc_A);
+                        bsg_tile_group_shared_load (TA, sh, i, lc_B);
+                        bsg_tile_group_shared_store (TA, sh, i - stride, lc_B);
+                        bsg_tile_group_shared_store (TA, sh, i, lc_A + lc_B);
+                }
+
+                bsg_tile_group_barrier(&r_barrier, &c_barrier);
+        }
+}
+
+// Number of elements of the shared memory scan: one per tile, rounded
+// up to a power of two
+#define SCAN_SHARED_SIZE scan_pow2(bsg_tiles_X * bsg_tiles_Y)
+
+// Each tile sums its slice of A, and stores the sum in sh[bsg_id] (sh
+// has SCAN_SHARED_SIZE elements, and the padding elements are zeroed).
+template <uint32_t F, typename TA>
+void scan_tile_sums(const TA *A, uint32_t N, TA *sh) {
+        const uint32_t tiles = bsg_tiles_X * bsg_tiles_Y;
+        uint32_t begin, end;
+        bsg_tile_slice(N, &begin, &end);
+
+        bsg_tile_group_shared_store (TA, sh, bsg_id, bsg_slice_sum<F>(&A[begin], end - begin));
+        for (uint32_t i = tiles + bsg_id; i < SCAN_SHARED_SIZE; i += tiles) {
+                bsg_tile_group_shared_store (TA, sh, i, static_cast<TA>(0));
+        }
+
+        bsg_tile_group_barrier(&r_barrier, &c_barrier);
+}
+
+/*
+ * Scan of the N elements of A into B by all the tiles of the tile
+ * group, starting from carry. This reads A twice, but only does O(N)
+ * additions, in three steps:
+ *
+ * 1. Each tile sums a contiguous slice of A, into tile group shared
+ *    memory (scan_tile_sums).
+ * 2. The tile group scans the sums of the tiles in shared memory
+ *    (scan_blelloch_*), which gives each tile the sum of the slices
+ *    before it.
+ * 3. Each tile scans its slice serially, starting from carry and the
+ *    sum of the slices before it.
+ */
+template <uint32_t F, typename TA>
+void scan_tile_group(const TA *A, TA *B, uint32_t N, TA carry, uint32_t inclusive, TA *sh) {
+        uint32_t begin, end;
+        bsg_tile_slice(N, &begin, &end);
+
+        scan_tile_sums<F>(A, N, sh);
+        scan_blelloch_up_sweep(sh, SCAN_SHARED_SIZE);
+        scan_blelloch_down_sweep(sh, SCAN_SHARED_SIZE);
+
+        TA offset;
+        bsg_tile_group_shared_load (TA, sh, bsg_id, offset);
+        scan_serial<F>(&A[begin], &B[begin], end - begin, carry + offset, inclusive);
+
+        bsg_tile_group_barrier(&r_barrier, &c_barrier);
+}
+
+template <uint32_t F, typename TA>
+int  __attribute__ ((noinline)) kernel_scan_tile_group(TA *A, TA *B, uint32_t N, uint32_t inclusive) {
+        bsg_tile_group_shared_mem(TA, sh, SCAN_SHARED_SIZE);
+
+        scan_tile_group<F>(A, B, N, static_cast<TA>(0), inclusive, sh);
+
+        return 0;
+}
+
+/*
+ * Grid-wide scan. Tile groups cannot communicate through tile group
+ * shared memory or barriers, and are not guaranteed to run at the same
+ * time, so a tile group cannot wait on the tile groups before it (as
+ * in a decoupled look-back). Instead, the scan is done in two passes
+ * (kernels), over contiguous slices of A of ceil(N / tile groups)
+ * elements:
+ *
+ * 1. kernel_scan_grid_reduce: Each tile group sums its slice (the
+ *    up-sweep of scan_tile_group), and writes the sum to
+ *    partials[__bsg_tile_group_id].
+ * 2. kernel_scan_grid_propagate: Launched once every tile group of
+ *    kernel_scan_grid_reduce has finished. Each tile group sums the partials of the
+ *    tile groups before it, and scans its slice starting from that sum
+ *    (scan_tile_group).
+ */
+
+template <uint32_t F, typename TA>
+int  __attribute__ ((noinline)) kernel_scan_grid_reduce(const TA *A, uint32_t N, TA *partials) {
+        bsg_tile_group_shared_mem(TA, sh, SCAN_SHARED_SIZE);
+
+        uint32_t begin, end;
+        bsg_grid_slice(N, &begin, &end);
+
+        scan_tile_sums<F>(&A[begin], end - begin, sh);
+        scan_blelloch_up_sweep(sh, SCAN_SHARED_SIZE);
+
+        if (bsg_id == 0) {
+                bsg_tile_group_shared_load (TA, sh, SCAN_SHARED_SIZE - 1, partials[__bsg_tile_group_id]);
+        }
+
+        bsg_tile_group_barrier(&r_barrier, &c_barrier);
+
+        return 0;
+}
+
+template <uint32_t F, typename TA>
+int  __attribute__ ((noinline)) kernel_scan_grid_propagate(TA *A, TA *B, uint32_t N, const TA *partials, uint32_t inclusive) {
+        bsg_tile_group_shared_mem(TA, sh, SCAN_SHARED_SIZE);
+
+        uint32_t begin, end;
+        bsg_grid_slice(N, &begin, &end);
+
+        // There are few tile groups, so each tile sums the partials
+        // itself rather than waiting on a broadcast from tile 0.
+        TA carry = bsg_slice_sum<F>(partials, __bsg_tile_group_id);
+
+        scan_tile_group<F>(&A[begin], &B[begin], end - begin, carry, inclusive, sh);
+
+        return 0;
+}
+
+#endif //__SCAN_HPP
@@ -0,0 +1,36 @@
+/*
+ * This kernel scans A on a single tile, serially. It is the baseline
+ * for the throughput of the parallel scans (v1 and v2).
+ */
+
+// BSG_TILE_GROUP_X_DIM and BSG_TILE_GROUP_Y_DIM must be defined
+// before bsg_manycore.h and bsg_tile_group_barrier.h are
+// included. bsg_tiles_X and bsg_tiles_Y must also be defined for
+// legacy reasons, but they are deprecated.
+#define BSG_TILE_GROUP_X_DIM 1
+#define BSG_TILE_GROUP_Y_DIM 1
+#define bsg_tiles_X BSG_TILE_GROUP_X_DIM
+#define bsg_tiles_Y BSG_TILE_GROUP_Y_DIM
+#include <bsg_manycore.h>
+#include <bsg_tile_group_barrier.h>
+#include <cstdint>
+INIT_TILE_GROUP_BARRIER(r_barrier, c_barrier, 0, bsg_tiles_X-1, 0, bsg_tiles_Y-1);
+
+#include <scan.hpp>
+
+
+extern "C" {
+        int  __attribute__ ((noinline)) kernel_scan(
+                      int32_t *A, int32_t *B, uint32_t N, uint32_t inclusive) {
+                int rc;
+                bsg_cuda_print_stat_kernel_start();
+                bsg_cuda_print_stat_start(inclusive);
+                rc = kernel_scan_single_tile(A, B, N, inclusive);
+                bsg_cuda_print_stat_end(inclusive);
+
+                bsg_tile_group_barrier(&r_barrier, &c_barrier);
+
+                bsg_cuda_print_stat_kernel_end();
+                return rc;
+        }
+}
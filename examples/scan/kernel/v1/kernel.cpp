@@ -0,0 +1,42 @@
+/*
+ * This kernel scans A with a single tile group: each tile scans a
+ * slice of A, starting from the sum of the slices before it, which is
+ * computed with a Blelloch scan in tile group shared memory.
+ */
+
+// BSG_TILE_GROUP_X_DIM and BSG_TILE_GROUP_Y_DIM must be defined
+// before bsg_manycore.h and bsg_tile_group_barrier.h are
+// included. bsg_tiles_X and bsg_tiles_Y must also be defined for
+// legacy reasons, but they are deprecated.
+#define BSG_TILE_GROUP_X_DIM 4
+#define BSG_TILE_GROUP_Y_DIM 4
+#define bsg_tiles_X BSG_TILE_GROUP_X_DIM
+#define bsg_tiles_Y BSG_TILE_GROUP_Y_DIM
+#include <bsg_manycore.h>
+#include <bsg_tile_group_barrier.h>
+#include <cstdint>
+INIT_TILE_GROUP_BARRIER(r_barrier, c_barrier, 0, bsg_tiles_X-1, 0, bsg_tiles_Y-1);
+
+#include <scan.hpp>
+
+// Partial sums (loads in flight) per tile
+#ifndef SCAN_UNROLL
+#define SCAN_UNROLL 4
+#endif
+
+
+extern "C" {
+        int  __attribute__ ((noinline)) kernel_scan(
+                      int32_t *A, int32_t *B, uint32_t N, uint32_t inclusive) {
+                int rc;
+                bsg_cuda_print_stat_kernel_start();
+                bsg_cuda_print_stat_start(inclusive);
+                rc = kernel_scan_tile_group<SCAN_UNROLL>(A, B, N, inclusive);
+                bsg_cuda_print_stat_end(inclusive);
+
+                bsg_tile_group_barrier(&r_barrier, &c_barrier);
+
+                bsg_cuda_print_stat_kernel_end();
+                return rc;
+        }
+}
@@ -0,0 +1,57 @@
+/*
+ * These kernels scan A on a grid of tile groups in two passes:
+ * kernel_scan_reduce writes the sum of each tile group's slice of A to
+ * partials, and kernel_scan_grid (launched after it) scans each slice,
+ * starting from the sum of the partials before it.
+ */
+
+// BSG_TILE_GROUP_X_DIM and BSG_TILE_GROUP_Y_DIM must be defined
+// before bsg_manycore.h and bsg_tile_group_barrier.h are
+// included. bsg_tiles_X and bsg_tiles_Y must also be defined for
+// legacy reasons, but they are deprecated.
+#define BSG_TILE_GROUP_X_DIM 4
+#define BSG_TILE_GROUP_Y_DIM 4
+#define bsg_tiles_X BSG_TILE_GROUP_X_DIM
+#define bsg_tiles_Y BSG_TILE_GROUP_Y_DIM
+#include <bsg_manycore.h>
+#include <bsg_tile_group_barrier.h>
+#include <cstdint>
+INIT_TILE_GROUP_BARRIER(r_barrier, c_barrier, 0, bsg_tiles_X-1, 0, bsg_tiles_Y-1);
+
+#include <scan.hpp>
+
+// Partial sums (loads in flight) per tile
+#ifndef SCAN_UNROLL
+#define SCAN_UNROLL 4
+#endif
+
+
+extern "C" {
+        int  __attribute__ ((noinline)) kernel_scan_reduce(
+                      int32_t *A, uint32_t N, int32_t *partials) {
+                int rc;
+                bsg_cuda_print_stat_kernel_start();
+                bsg_cuda_print_stat_start(2);
+                rc = kernel_scan_grid_reduce<SCAN_UNROLL>(A, N, partials);
+                bsg_cuda_print_stat_end(2);
+
+                bsg_tile_group_barrier(&r_barrier, &c_barrier);
+
+                bsg_cuda_print_stat_kernel_end();
+                return rc;
+        }
+
+        int  __attribute__ ((noinline)) kernel_scan_grid(
+                      int32_t *A, int32_t *B, uint32_t N, int32_t *partials, uint32_t inclusive) {
+                int rc;
+                bsg_cuda_print_stat_kernel_start();
+                bsg_cuda_print_stat_start(inclusive);
+                rc = kernel_scan_grid_propagate<SCAN_UNROLL>(A, B, N, partials, inclusive);
+                bsg_cuda_print_stat_end(inclusive);
+
+                bsg_tile_group_barrier(&r_barrier, &c_barrier);
+
+                bsg_cuda_print_stat_kernel_end();
+                return rc;
+        }
+}
@@ -0,0 +1,270 @@
+// Copyright (c) 2019, University of Washington All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+//
+// Redistributions of source code must retain the above copyright notice, this list
+// of conditions and the following disclaimer.
+//
+// Redistributions in binary form must reproduce the above copyright notice, this
+// list of conditions and the following disclaimer in the documentation and/or
+// other materials provided with the distribution.
+//
+// Neither the name of the copyright holder nor the names of its contributors may
+// be used to endorse or promote products derived from this software without
+// specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+// ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "scan.hpp"
+
+/*
+ * Runs the exclusive and inclusive prefix sums (scans) of A on the
+ * manycore:
+ *   B_ex[i] <-- A[0] + ... + A[i - 1]
+ *   B_in[i] <-- A[0] + ... + A[i]
+ *
+ * All versions take the same default size, so that their throughput
+ * can be compared against the single-tile scan (v0).
+ */
+
+// Default vector size (--size)
+#define DEFAULT_WIDTH (1 << 18)
+
+// Elements per tile group in the grid-wide scan (v2)
+#define GROUP_WIDTH 16384
+
+// Host Vector Scan (to compare results)
+template <typename TA>
+void vector_scan (const TA *A, TA *B_ex, TA *B_in, uint64_t N) {
+        TA sum = 0;
+        for (uint64_t x = 0; x < N; x ++) {
+                B_ex[x] = sum;
+                sum += A[x];
+                B_in[x] = sum;
+        }
+        return;
+}
+
+int kernel_scan (int argc, char **argv) {
+        int rc;
+        char *bin_path, *test_name;
+        struct arguments_size args = {{NULL, NULL}};
+        args.size = DEFAULT_WIDTH;
+        args.seed = 42;
+
+        argp_parse (&argp_size, argc, argv, 0, 0, &args);
+        bin_path = args.path.path;
+        test_name = args.path.name;
+
+        bsg_pr_test_info("Running the CUDA Prefix Sum (Scan) Kernel.\n\n");
+
+        // Define tg_dim_x/y: number of tiles in each tile group. Only
+        // the grid-wide scan (v2) uses more than one tile group, as
+        // tiles in different tile groups cannot communicate through
+        // tile group shared memory.
+        const uint32_t N = args.size;
+        hb_mc_dimension_t tg_dim = { .x = 0, .y = 0 };
+        hb_mc_dimension_t grid_dim = { .x = 1, .y = 1 };
+        bool grid = false;
+        if(!strcmp("v0", test_name)){
+                tg_dim = { .x = 1, .y = 1 };
+        } else if(!strcmp("v1", test_name)){
+                tg_dim = { .x = 4, .y = 4 };
+        } else if(!strcmp("v2", test_name)){
+                // v2 splits A into one slice per tile group, and the
+                // grid grows with N
+                tg_dim = { .x = 4, .y = 4 };
+                grid_dim = {.x = (N + GROUP_WIDTH - 1) / GROUP_WIDTH, .y = 1};
+                grid_dim.x = grid_dim.x ? grid_dim.x : 1;
+                grid = true;
+        } else {
+                bsg_pr_test_err("Invalid version provided!.\n");
+                return HB_MC_INVALID;
+        }
+
+        // Initialize the random number generator
+        std::numeric_limits<int8_t> lim; // Used to get INT_MIN and INT_MAX in C++
+        host_random A_random(args.seed);
+
+        // Allocate A and the known-correct scans on the host
+        host_buffer<int32_t> A(N);
+        host_buffer<int32_t> R_ex(N), R_in(N);
+        host_buffer<int32_t> B_ex(N), B_in(N);
+
+        // Load A and the known-correct scans from the dataset cache,
+        // or generate them.
+        host_dataset cache("scan", "int32", {N}, args.seed);
+        if (!cache.load({{"A", A.data(), A.size_bytes()},
+                         {"R_ex", R_ex.data(), R_ex.size_bytes()},
+                         {"R_in", R_in.data(), R_in.size_bytes()}})) {
+                // Small values, so that the sums do not overflow
+                A_random.uniform(A.data(), A.size(), (int32_t) lim.min(), (int32_t) lim.max());
+
+                // Generate the known-correct results on the host
+                vector_scan (A.data(), R_ex.data(), R_in.data(), N);
+
+                cache.store({{"A", A.data(), A.size_bytes()},
+                             {"R_ex", R_ex.data(), R_ex.size_bytes()},
+                             {"R_in", R_in.data(), R_in.size_bytes()}});
+        }
+
+
+        // Initialize device, load binary and unfreeze tiles.
+        hb_mc_device_t device;
+        rc = hb_mc_device_init(&device, test_name, 0);
+        if (rc != HB_MC_SUCCESS) {
+                bsg_pr_test_err("failed to initialize device.\n");
+                return rc;
+        }
+
+
+        rc = hb_mc_device_program_init(&device, bin_path,
+                                       "default_allocator", 0);
+        if (rc != HB_MC_SUCCESS) {
+                bsg_pr_test_err("failed to initialize program.\n");
+                return rc;
+        }
+
+
+        // The grid-wide scan keeps one partial sum per tile group
+        const uint32_t groups = grid_dim.x * grid_dim.y;
+        const uint32_t P_SIZE = grid ? groups : 0;
+
+        // Reserve device memory for A, both scans and the partial
+        // sums, and allocate them from it
+        device_arena arena(&device);
+        rc = arena.init(device_arena::footprint({A.size_bytes(), B_ex.size_bytes(),
+                                                 B_in.size_bytes(), P_SIZE * sizeof(int32_t)}));
+        if (rc != HB_MC_SUCCESS) {
+                bsg_pr_test_err("failed to reserve device memory.\n");
+                return rc;
+        }
+
+        hb_mc_eva_t A_device, B_ex_device, B_in_device, P_device = 0;
+        rc = arena.alloc(A.size_bytes(), &A_device);
+        rc |= arena.alloc(B_ex.size_bytes(), &B_ex_device);
+        rc |= arena.alloc(B_in.size_bytes(), &B_in_device);
+        if (P_SIZE)
+                rc |= arena.alloc(P_SIZE * sizeof(int32_t), &P_device);
+        if (rc != HB_MC_SUCCESS) {
+                bsg_pr_test_err("failed to allocate memory on device.\n");
+                return rc;
+        }
+
+
+        // Copy A from host onto device DRAM.
+        rc = hb_mc_device_memcpy (&device, (void *) ((intptr_t) A_device),
+                                  (void *) A.data(), A.size_bytes(),
+                                  HB_MC_MEMCPY_TO_DEVICE);
+        if (rc != HB_MC_SUCCESS) {
+                bsg_pr_test_err("failed to copy memory to device.\n");
+                return rc;
+        }
+
+
+        // The grid-wide scan first sums each tile group's slice of A
+        // into the partials. This kernel is executed before the scans
+        // that read the partials are enqueued (see "Kernel ordering" in
+        // native/README.md).
+        if (grid) {
+                uint32_t cuda_argv[3] = {A_device, N, P_device};
+                rc = hb_mc_kernel_enqueue (&device, grid_dim, tg_dim, "kernel_scan_reduce", 3, cuda_argv);
+                if (rc != HB_MC_SUCCESS) {
+                        bsg_pr_test_err("failed to initialize grid.\n");
+                        return rc;
+                }
+
+                rc = hb_mc_device_tile_groups_execute(&device);
+                if (rc != HB_MC_SUCCESS) {
+                        bsg_pr_test_err("failed to execute tile groups.\n");
+                        return rc;
+                }
+        }
+
+        // Enquque the exclusive (0) and inclusive (1) scans
+        const hb_mc_eva_t B_device[2] = {B_ex_device, B_in_device};
+        for (uint32_t inclusive = 0; inclusive < 2; ++inclusive) {
+                if (grid) {
+                        uint32_t cuda_argv[5] = {A_device, B_device[inclusive], N, P_device, inclusive};
+                        rc = hb_mc_kernel_enqueue (&device, grid_dim, tg_dim, "kernel_scan_grid", 5, cuda_argv);
+                } else {
+                        uint32_t cuda_argv[4] = {A_device, B_device[inclusive], N, inclusive};
+                        rc = hb_mc_kernel_enqueue (&device, grid_dim, tg_dim, "kernel_scan", 4, cuda_argv);
+                }
+                if (rc != HB_MC_SUCCESS) {
+                        bsg_pr_test_err("failed to initialize grid.\n");
+                        return rc;
+                }
+        }
+
+        // Launch and execute all tile groups on device and wait for all to finish.
+        rc = hb_mc_device_tile_groups_execute(&device);
+        if (rc != HB_MC_SUCCESS) {
+                bsg_pr_test_err("failed to execute tile groups.\n");
+                return rc;
+        }
+
+        // Copy the scans back from device DRAM into host memory.
+        rc = hb_mc_device_memcpy (&device, (void *) B_ex.data(),
+                                  (void *) ((intptr_t) B_ex_device),
+                                  B_ex.size_bytes(), HB_MC_MEMCPY_TO_HOST);
+        rc |= hb_mc_device_memcpy (&device, (void *) B_in.data(),
+                                   (void *) ((intptr_t) B_in_device),
+                                   B_in.size_bytes(), HB_MC_MEMCPY_TO_HOST);
+        if (rc != HB_MC_SUCCESS) {
+                bsg_pr_test_err("failed to copy memory from device.\n");
+                return rc;
+        }
+
+        // Freeze the tiles and memory manager cleanup.
+        rc = hb_mc_device_finish(&device);
+        if (rc != HB_MC_SUCCESS) {
+                bsg_pr_test_err("failed to de-initialize device.\n");
+                return rc;
+        }
+
+
+        // Compare the known-correct scans and the results.
+        rc = verify_result("B_ex", R_ex.data(), B_ex.data(), 1, N);
+        if (rc != HB_MC_SUCCESS)
+                return rc;
+        return verify_result("B_in", R_in.data(), B_in.data(), 1, N);
+}
+
+#ifdef COSIM
+void cosim_main(uint32_t *exit_code, char * args) {
+        // We aren't passed command line arguments directly so we parse them
+        // from *args. args is a string from VCS - to pass a string of arguments
+        // to args, pass c_args to VCS as follows: +c_args="<space separated
+        // list of args>"
+        int argc = get_argc(args);
+        char *argv[argc];
+        get_argv(args, argc, argv);
+
+#ifdef VCS
+        svScope scope;
+        scope = svGetScopeFromName("tb");
+        svSetScope(scope);
+#endif
+        int rc = kernel_scan(argc, argv);
+        *exit_code = rc;
+        bsg_pr_test_pass_fail(rc == HB_MC_SUCCESS);
+        return;
+}
+#else
+int main(int argc, char ** argv) {
+        int rc = kernel_scan(argc, argv);
+        bsg_pr_test_pass_fail(rc == HB_MC_SUCCESS);
+        return rc;
+}
+#endif
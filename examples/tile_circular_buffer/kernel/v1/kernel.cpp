@@ -0,0 +1,125 @@
+// Streams a list of integers from INPUT to OUTPUT through a pipeline of
+// tiles, connected by the runtime channels of bsg_circular_buffer.hpp.
+// The host chooses the pipeline at launch: order[0, stages) lists the
+// tiles (by tile id) in pipeline order. Every stage adds one to each
+// element, so OUTPUT is INPUT + stages.
+//
+// The list is split into packets of C_NUM_ELEMENTS elements, and packet
+// p is sent through lane p % lanes. Each lane has its own channel
+// between every pair of neighbouring stages, so every tile in the
+// pipeline hosts up to 2 * lanes channels. Channel ids are
+// lane * stages + stage (the stage of the Source).
+
+// BSG_TILE_GROUP_X_DIM and BSG_TILE_GROUP_Y_DIM must be defined
+// before bsg_manycore.h and bsg_tile_group_barrier.h are
+// included. bsg_tiles_X and bsg_tiles_Y must also be defined for
+// legacy reasons, but they are deprecated.
+#define BSG_TILE_GROUP_X_DIM 4
+#define BSG_TILE_GROUP_Y_DIM 4
+#define bsg_tiles_X BSG_TILE_GROUP_X_DIM
+#define bsg_tiles_Y BSG_TILE_GROUP_Y_DIM
+#include <bsg_manycore.h>
+#include <bsg_tile_group_barrier.h>
+#include <cstdint>
+#include <bsg_circular_buffer.hpp>
+
+// Elements per packet, and packets per channel
+#define C_NUM_ELEMENTS 4
+#define C_DEPTH 4
+
+// The largest number of lanes supported. The DMEM buffers are sized for
+// it.
+#define C_MAX_LANES 2
+
+INIT_TILE_GROUP_BARRIER(r_barrier, c_barrier, 0, BSG_TILE_GROUP_X_DIM-1, 0, BSG_TILE_GROUP_Y_DIM-1);
+
+int kernel_stage(const int *src,
+                 const uint32_t nelements,
+                 int *dest,
+                 const uint32_t *order,
+                 const uint32_t stages,
+                 const uint32_t stage,
+                 const uint32_t lanes){
+
+        int buffer[C_MAX_LANES][C_NUM_ELEMENTS * C_DEPTH];
+        unsigned char occupancy[C_MAX_LANES][C_DEPTH];
+
+        CircularBuffer::ChannelDest<int> in[C_MAX_LANES];
+        CircularBuffer::ChannelSource<int> out[C_MAX_LANES];
+
+        bool first = stage == 0;
+        bool last = stage == stages - 1;
+
+        // Open ALL of the channels of this tile, and THEN call
+        // init_wait on each of them.
+        for(uint32_t l = 0; l < lanes; ++l){
+                if(!first){
+                        uint32_t src_id = order[stage - 1];
+                        in[l].open(l * stages + stage - 1,
+                                   src_id / bsg_tiles_X, src_id % bsg_tiles_X,
+                                   buffer[l], C_NUM_ELEMENTS, C_DEPTH);
+                }
+                if(!last){
+                        uint32_t dst_id = order[stage + 1];
+                        out[l].open(l * stages + stage,
+                                    dst_id / bsg_tiles_X, dst_id % bsg_tiles_X,
+                                    occupancy[l], C_NUM_ELEMENTS, C_DEPTH);
+                }
+        }
+
+        for(uint32_t l = 0; l < lanes; ++l){
+                if(!first)
+                        in[l].init_wait();
+                if(!last)
+                        out[l].init_wait();
+        }
+
+        for(uint32_t i = 0, l = 0; i < nelements; i += C_NUM_ELEMENTS, l = (l + 1) % lanes){
+                const int *rd_p = first ? &src[i] : in[l].obtain_rd_ptr_wait();
+                int *wr_p = last ? &dest[i] : out[l].obtain_wr_ptr_wait();
+
+                for(int n = 0; n < C_NUM_ELEMENTS; ++n){
+                        wr_p[n] = rd_p[n] + 1;
+                }
+
+                if(!first)
+                        in[l].finish_rd_ptr();
+                if(!last)
+                        out[l].finish_wr_ptr();
+        }
+
+        return 0;
+}
+
+extern "C" {
+        __attribute__((noinline))
+        int kernel_tile_circular_buffer(const int *src,
+                                        const uint32_t nelements,
+                                        int *dest,
+                                        const uint32_t *order,
+                                        const uint32_t stages,
+                                        const uint32_t lanes){
+
+                // The DMEM buffers are only large enough for
+                // C_MAX_LANES, and the channel table for
+                // CIRCULAR_BUFFER_CHANNELS channels
+                if (lanes > C_MAX_LANES || lanes * stages > CIRCULAR_BUFFER_CHANNELS) {
+                        bsg_print_hexadecimal(0xC0DECB01);
+                        bsg_tile_group_barrier(&r_barrier, &c_barrier);
+                        return -1;
+                }
+
+                bsg_cuda_print_stat_kernel_start();
+
+                for(uint32_t stage = 0; stage < stages; ++stage){
+                        if(order[stage] == __bsg_id){
+                                kernel_stage(src, nelements, dest, order, stages, stage, lanes);
+                        }
+                }
+
+                bsg_tile_group_barrier(&r_barrier, &c_barrier);
+
+                bsg_cuda_print_stat_kernel_end();
+                return 0;
+        }
+}
@@ -0,0 +1,162 @@
+// Measures the throughput of the circular buffer (Source/Dest) and of
+// the credit-based FIFO (CreditSource/CreditDest) of
+// bsg_circular_buffer.hpp, for a sweep of slot sizes (N) and depths
+// (DEPTH).
+//
+// For each configuration, tile (0,0) sends nwords words to tile (1,0),
+// first through a Source/Dest pair and then through a
+// CreditSource/CreditDest pair. The words are read from a block of
+// C_BLOCK words in DMEM (copied from INPUT), so that only the FIFO is
+// measured. Each transfer is bracketed by
+// bsg_cuda_print_stat_start/end, with the tag 2 * configuration (Source/Dest)
+// or 2 * configuration + 1 (CreditSource/CreditDest), and words/cycle
+// is nwords divided by the cycles of the tag. The destination stores a
+// checksum of the words it received, sum((i + 1) * word i), in
+// OUTPUT[tag].
+//
+// The configurations are every N in {1, 4, 16} with every DEPTH in
+// {2, 4, 8}, in that order. nwords must be a multiple of 16.
+
+// BSG_TILE_GROUP_X_DIM and BSG_TILE_GROUP_Y_DIM must be defined
+// before bsg_manycore.h and bsg_tile_group_barrier.h are
+// included. bsg_tiles_X and bsg_tiles_Y must also be defined for
+// legacy reasons, but they are deprecated.
+#define BSG_TILE_GROUP_X_DIM 2
+#define BSG_TILE_GROUP_Y_DIM 1
+#define bsg_tiles_X BSG_TILE_GROUP_X_DIM
+#define bsg_tiles_Y BSG_TILE_GROUP_Y_DIM
+#include <bsg_manycore.h>
+#include <bsg_tile_group_barrier.h>
+#include <cstdint>
+#include <cstring>
+#include <bsg_circular_buffer.hpp>
+
+#define C_SOURCE_X 0
+#define C_SOURCE_Y 0
+
+#define C_DEST_X 1
+#define C_DEST_Y 0
+
+// Words in the DMEM block that is sent (a multiple of every N)
+#define C_BLOCK 64
+
+INIT_TILE_GROUP_BARRIER(r_barrier, c_barrier, 0, BSG_TILE_GROUP_X_DIM-1, 0, BSG_TILE_GROUP_Y_DIM-1);
+
+template<unsigned int N, unsigned int DEPTH>
+void bench_circular_buffer(const uint32_t *block,
+                           const uint32_t nwords,
+                           uint32_t *checksum,
+                           const uint32_t tag){
+
+        if (__bsg_x == C_DEST_X && __bsg_y == C_DEST_Y){
+                CircularBuffer::Dest<uint32_t, C_SOURCE_Y, C_SOURCE_X, C_DEST_Y, C_DEST_X, N, DEPTH> fifo;
+                fifo.init_wait();
+
+                uint32_t sum = 0;
+                bsg_cuda_print_stat_start(tag);
+                for(uint32_t i = 0; i < nwords; i += N){
+                        const uint32_t *buf_p = fifo.obtain_rd_ptr_wait();
+                        for(uint32_t n = 0; n < N; ++n){
+                                sum += (i + n + 1) * buf_p[n];
+                        }
+                        fifo.finish_rd_ptr();
+                }
+                bsg_cuda_print_stat_end(tag);
+
+                *checksum = sum;
+        }
+
+        if (__bsg_x == C_SOURCE_X && __bsg_y == C_SOURCE_Y){
+                CircularBuffer::Source<uint32_t, C_SOURCE_Y, C_SOURCE_X, C_DEST_Y, C_DEST_X, N, DEPTH> fifo;
+                fifo.init_wait();
+
+                bsg_cuda_print_stat_start(tag);
+                for(uint32_t i = 0; i < nwords; i += N){
+                        uint32_t *buf_p = fifo.obtain_wr_ptr_wait();
+                        for(uint32_t n = 0; n < N; ++n){
+                                buf_p[n] = block[(i + n) % C_BLOCK];
+                        }
+                        fifo.finish_wr_ptr();
+                }
+                bsg_cuda_print_stat_end(tag);
+        }
+
+        bsg_tile_group_barrier(&r_barrier, &c_barrier);
+}
+
+template<unsigned int N, unsigned int DEPTH>
+void bench_credit(const uint32_t *block,
+                  const uint32_t nwords,
+                  uint32_t *checksum,
+                  const uint32_t tag){
+
+        if (__bsg_x == C_DEST_X && __bsg_y == C_DEST_Y){
+                CircularBuffer::CreditDest<uint32_t, N, DEPTH> fifo(0, C_SOURCE_Y, C_SOURCE_X);
+                fifo.init_wait();
+
+                uint32_t sum = 0;
+                bsg_cuda_print_stat_start(tag);
+                for(uint32_t i = 0; i < nwords; i += N){
+                        const uint32_t *buf_p = fifo.obtain_rd_ptr_wait();
+                        for(uint32_t n = 0; n < N; ++n){
+                                sum += (i + n + 1) * buf_p[n];
+                        }
+                        fifo.finish_rd_ptr();
+                }
+                bsg_cuda_print_stat_end(tag);
+
+                *checksum = sum;
+        }
+
+        if (__bsg_x == C_SOURCE_X && __bsg_y == C_SOURCE_Y){
+                CircularBuffer::CreditSource<uint32_t, N, DEPTH> fifo(0, C_DEST_Y, C_DEST_X);
+                fifo.init_wait();
+
+                bsg_cuda_print_stat_start(tag);
+                for(uint32_t i = 0; i < nwords; i += N){
+                        fifo.send(&block[i % C_BLOCK]);
+                }
+                bsg_cuda_print_stat_end(tag);
+        }
+
+        bsg_tile_group_barrier(&r_barrier, &c_barrier);
+}
+
+// Runs both FIFOs with slots of N words, for every DEPTH
+template<unsigned int N>
+void bench_depths(const uint32_t *block,
+                  const uint32_t nwords,
+                  uint32_t *checksums,
+                  uint32_t config){
+
+        bench_circular_buffer<N, 2>(block, nwords, &checksums[2 * config], 2 * config);
+        bench_credit<N, 2>(block, nwords, &checksums[2 * config + 1], 2 * config + 1);
+        config++;
+
+        bench_circular_buffer<N, 4>(block, nwords, &checksums[2 * config], 2 * config);
+        bench_credit<N, 4>(block, nwords, &checksums[2 * config + 1], 2 * config + 1);
+        config++;
+
+        bench_circular_buffer<N, 8>(block, nwords, &checksums[2 * config], 2 * config);
+        bench_credit<N, 8>(block, nwords, &checksums[2 * config + 1], 2 * config + 1);
+}
+
+extern "C" {
+        __attribute__((noinline))
+        int kernel_tile_circular_buffer(const uint32_t *src,
+                                        const uint32_t nwords,
+                                        uint32_t *checksums){
+
+                uint32_t block[C_BLOCK];
+                memcpy(block, src, sizeof(block));
+
+                bsg_cuda_print_stat_kernel_start();
+
+                bench_depths<1>(block, nwords, checksums, 0);
+                bench_depths<4>(block, nwords, checksums, 3);
+                bench_depths<16>(block, nwords, checksums, 6);
+
+                bsg_cuda_print_stat_kernel_end();
+                return 0;
+        }
+}
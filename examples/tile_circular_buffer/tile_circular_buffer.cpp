@@ -28,7 +28,19 @@
 #include "tile_circular_buffer.hpp"
 #include <iostream>
 
-#define C_LENGTH 256
+// Default vector length (--size)
+#define DEFAULT_C_LENGTH 256
+
+// v1: Number of tiles in the pipeline (the whole 4x4 tile group), and
+// number of lanes (channels between each pair of stages)
+#define C_STAGES 16
+#define C_LANES 2
+
+// v2: Words in the block that is sent, and the slot sizes (N) and
+// depths (DEPTH) of the benchmark (as in kernel/v2)
+#define C_BLOCK 64
+static const uint32_t C_BENCH_N[] = {1, 4, 16};
+static const uint32_t C_BENCH_DEPTH[] = {2, 4, 8};
 
 // Print matrix A (M x N). This works well for small matricies.
 template <typename T>
@@ -43,30 +55,161 @@ void matrix_print(T *A, uint64_t M, uint64_t N) {
         }
 }
 
-// Compute the sum of squared error between matricies A and B (M x N)
-template <typename T>
-double matrix_sse (const T *A, const T *B, uint64_t M, uint64_t N) {
-        double sum = 0;
-        for (uint64_t y = 0; y < M; y ++) {
-                for (uint64_t x = 0; x < N; x ++) {
-                        T diff = A[y * N + x] - B[y * N + x];
-                        if(std::isnan(diff)){
-                                return diff;
-                        }
-                        sum += diff * diff;
+// Benchmarks the circular buffer against the credit-based FIFO (v2)
+int kernel_circular_buffer_bench(char *elf, char *test_name, const struct arguments_size &args)
+{
+        int rc;
+        hb_mc_device_t manycore, *mc = &manycore;
+        rc = hb_mc_device_init(mc, test_name, 0);
+        if(rc != HB_MC_SUCCESS)
+        {
+                bsg_pr_test_err("Failed to initialize device.\n");
+                return rc;
+        }
+
+        rc = hb_mc_device_program_init(mc, elf, "default_allocator", 0);
+        if(rc != HB_MC_SUCCESS)
+        {
+                bsg_pr_test_err("Failed to initialize the program.\n");
+                return rc;
+        }
+
+        // Initialize the random number generator
+        std::numeric_limits<uint32_t> lim_uint32; // Used to get INT_MIN and INT_MAX in C++
+        host_random data_random(args.seed);
+
+        // N: Number of words sent through each FIFO
+        uint32_t N = args.size;
+
+        // The largest slot is 16 words
+        if (N % 16) {
+                bsg_pr_test_err("N must be a multiple of 16.\n");
+                return HB_MC_INVALID;
+        }
+
+        const uint32_t configs = (sizeof(C_BENCH_N) / sizeof(C_BENCH_N[0])) *
+                (sizeof(C_BENCH_DEPTH) / sizeof(C_BENCH_DEPTH[0]));
+
+        // One checksum per configuration and FIFO
+        host_buffer<uint32_t> A(C_BLOCK);
+        host_buffer<uint32_t> B(2 * configs), B_result(2 * configs);
+
+        // Reserve device memory for A and B, and allocate them from it
+        device_arena arena(mc);
+        rc = arena.init(device_arena::footprint({A.size_bytes(),
+                                                 B.size_bytes()}));
+        if(rc != HB_MC_SUCCESS)
+        {
+                bsg_pr_test_err("Failed to reserve device memory.\n");
+                return rc;
+        }
+
+        eva_t A_device, B_device;
+        rc = arena.alloc(A.size_bytes(), &A_device);
+        if(rc != HB_MC_SUCCESS)
+        {
+                bsg_pr_test_err("Failed to allocate A on the manycore.\n");
+                return rc;
+        }
+
+        rc = arena.alloc(B.size_bytes(), &B_device);
+        if(rc != HB_MC_SUCCESS)
+        {
+                bsg_pr_test_err("Failed to allocate B on the manycore.\n");
+                return rc;
+        }
+
+        data_random.uniform(A.data(), A.size(), lim_uint32.min(), lim_uint32.max());
+
+        // Every FIFO should deliver the same words, in order
+        uint32_t checksum = 0;
+        for(uint32_t i = 0; i < N; i++)
+        {
+                checksum += (i + 1) * A[i % C_BLOCK];
+        }
+        for(uint32_t i = 0; i < B.size(); i++)
+        {
+                B[i] = checksum;
+        }
+
+        rc = hb_mc_device_memcpy(mc,
+                                 (void *) ((intptr_t) A_device),
+                                 (void *) A.data(),
+                                 A.size_bytes(), HB_MC_MEMCPY_TO_DEVICE);
+        if(rc != HB_MC_SUCCESS)
+        {
+                bsg_pr_test_err("Failed to copy A to the manycore.\n");
+                return rc;
+        }
+
+        // The profiling tags of the configurations. Words/cycle is N
+        // divided by the cycles of the tag.
+        uint32_t tag = 0;
+        for(uint32_t n : C_BENCH_N)
+        {
+                for(uint32_t depth : C_BENCH_DEPTH)
+                {
+                        bsg_pr_test_info("N = %2u, DEPTH = %u: tag %2u (Source/Dest), "
+                                         "tag %2u (CreditSource/CreditDest), %u words\n",
+                                         n, depth, tag, tag + 1, N);
+                        tag += 2;
                 }
         }
-        return sum;
+
+        hb_mc_dimension_t tilegroup_dim = { .x = 2, .y = 1 };
+        hb_mc_dimension_t grid_dim = { .x = 1, .y = 1 };
+
+        uint32_t cuda_argv[] = {A_device, N, B_device};
+        size_t cuda_argc = sizeof(cuda_argv) / sizeof(cuda_argv[0]);
+        rc = hb_mc_kernel_enqueue(mc, grid_dim, tilegroup_dim,
+                                  "kernel_tile_circular_buffer",
+                                  cuda_argc, cuda_argv);
+        if(rc != HB_MC_SUCCESS)
+        {
+                bsg_pr_test_err("Failed to initialize grid.\n");
+                return rc;
+        }
+
+        rc = hb_mc_device_tile_groups_execute(mc);
+        if(rc != HB_MC_SUCCESS)
+        {
+                bsg_pr_test_err("Failed to execute tilegroups.\n");
+                return rc;
+        }
+
+        rc = hb_mc_device_memcpy(mc, (void *) B_result.data(),
+                                 (void *) ((intptr_t) B_device),
+                                 B.size_bytes(), HB_MC_MEMCPY_TO_HOST);
+        if(rc != HB_MC_SUCCESS)
+        {
+                bsg_pr_test_err("Failed to copy result to host.\n");
+                return rc;
+        }
+
+        rc = hb_mc_device_finish(mc);
+        if(rc != HB_MC_SUCCESS)
+        {
+                bsg_pr_test_err("Failed to deinitialize the manycore.\n");
+                return rc;
+        }
+
+        return verify_result("B", B.data(), B_result.data(), 1, B.size());
 }
 
 int kernel_circular_buffer(int argc, char **argv)
 {       
         bsg_pr_test_info("Running CUDA Circular_Buffer Kernel on a 1x1 tile group.\n\n");
         char *elf, *test_name;
-        struct arguments_path args = { NULL, NULL };
-        argp_parse(&argp_path, argc, argv, 0, 0, &args);
-        elf = args.path;
-        test_name = args.name;
+        struct arguments_size args = {{NULL, NULL}};
+        args.size = DEFAULT_C_LENGTH;
+        args.seed = 42;
+        argp_parse(&argp_size, argc, argv, 0, 0, &args);
+        elf = args.path.path;
+        test_name = args.path.name;
+
+        // v2 benchmarks the FIFOs
+        if (!strcmp("v2", test_name))
+                return kernel_circular_buffer_bench(elf, test_name, args);
 
         int rc;
         hb_mc_device_t manycore, *mc = &manycore;
@@ -84,56 +227,113 @@ int kernel_circular_buffer(int argc, char **argv)
                 return rc;
         }
 
-        // Initialize the random number generators
+        // Initialize the random number generator
         std::numeric_limits<int32_t> lim_int32; // Used to get INT_MIN and INT_MAX in C++
-        std::default_random_engine generator;
-        generator.seed(42);
-        std::uniform_int_distribution<int> data_distribution(lim_int32.min(),lim_int32.max());
+        host_random data_random(args.seed);
 
         // N: Number of elements in the 1-D input vector
-        uint32_t N = C_LENGTH;
+        uint32_t N = args.size;
+
+        // The kernel transfers fixed-size packets of 4 elements
+        // through the circular buffer.
+        if (N % 4) {
+                bsg_pr_test_err("N must be a multiple of 4.\n");
+                return HB_MC_INVALID;
+        }
         
-        int A[N];
-        int B[N], B_result[N];
+        // v1 streams the vector through a pipeline of tiles, in an
+        // order (of tile ids) chosen here, from the seed
+        bool pipeline = !strcmp("v1", test_name);
+        uint32_t stages = pipeline ? C_STAGES : 2;
+        uint32_t lanes = pipeline ? C_LANES : 1;
+
+        host_buffer<int> A(N);
+        host_buffer<int> B(N), B_result(N);
+        host_buffer<uint32_t> order(stages);
+
+        // Reserve device memory for A, B and the order, and allocate
+        // them from it
+        device_arena arena(mc);
+        rc = arena.init(device_arena::footprint({A.size_bytes(),
+                                                 B.size_bytes(),
+                                                 order.size_bytes()}));
+        if(rc != HB_MC_SUCCESS)
+        {
+                bsg_pr_test_err("Failed to reserve device memory.\n");
+                return rc;
+        }
 
         eva_t A_device, B_device;
-        rc = hb_mc_device_malloc(mc, sizeof(A), &A_device);
+        rc = arena.alloc(A.size_bytes(), &A_device);
         if(rc != HB_MC_SUCCESS)
         {
                 bsg_pr_test_err("Failed to allocate A on the manycore.\n");
                 return rc;
         }
         
-        rc = hb_mc_device_malloc(mc, sizeof(B), &B_device);
+        rc = arena.alloc(B.size_bytes(), &B_device);
         if(rc != HB_MC_SUCCESS)
         {
                 bsg_pr_test_err("Failed to allocate B on the manycore.\n");
                 return rc;
         }
 
-        for(int i = 0; i < sizeof(A) / sizeof(A[0]); i++)
+        eva_t order_device;
+        rc = arena.alloc(order.size_bytes(), &order_device);
+        if(rc != HB_MC_SUCCESS)
+        {
+                bsg_pr_test_err("Failed to allocate the order on the manycore.\n");
+                return rc;
+        }
+
+        data_random.uniform(A.data(), A.size(), lim_int32.min(), lim_int32.max());
+        for(int i = 0; i < A.size(); i++)
+        {
+                B[i] = pipeline ? A[i] + stages : A[i];
+        }
+
+        // A random permutation of the tiles (Fisher-Yates shuffle)
+        host_random order_random(args.seed, 1);
+        for(uint32_t i = 0; i < stages; i++)
         {
-                A[i] = data_distribution(generator);
-                B[i] = A[i];
+                order[i] = i;
+        }
+        for(uint32_t i = stages - 1; i > 0; i--)
+        {
+                std::swap(order[i], order[order_random.draw<uint32_t>(i, 0, i)]);
         }
         
         rc = hb_mc_device_memcpy(mc,
                                  (void *) ((intptr_t) A_device),
                                  (void *) &A[0],
-                                 sizeof(A), HB_MC_MEMCPY_TO_DEVICE);
+                                 A.size_bytes(), HB_MC_MEMCPY_TO_DEVICE);
 
         if(rc != HB_MC_SUCCESS)
         {
                 bsg_pr_test_err("Failed to copy A to the manycore.\n");
                 return rc;
         }
-        
+
+        rc = hb_mc_device_memcpy(mc,
+                                 (void *) ((intptr_t) order_device),
+                                 (void *) order.data(),
+                                 order.size_bytes(), HB_MC_MEMCPY_TO_DEVICE);
+        if(rc != HB_MC_SUCCESS)
+        {
+                bsg_pr_test_err("Failed to copy the order to the manycore.\n");
+                return rc;
+        }
 
         hb_mc_dimension_t tilegroup_dim = { .x = 2, .y = 1 };
+        if (pipeline) {
+                tilegroup_dim = { .x = 4, .y = 4 };
+                bsg_pr_test_info("Pipeline of %u tiles, %u lanes, starting at tile %u\n",
+                                 stages, lanes, order[0]);
+        }
         hb_mc_dimension_t grid_dim = { .x = 1, .y = 1 };
 
-        uint32_t cuda_argv[] = {A_device, N, B_device};
-        size_t cuda_argc = sizeof(cuda_argv) / sizeof(cuda_argv[0]);
+        uint32_t cuda_argv[] = {A_device, N, B_device, order_device, stages, lanes};
+        size_t cuda_argc = pipeline ? 6 : 3;
         rc = hb_mc_kernel_enqueue(mc, grid_dim, tilegroup_dim, 
                                   "kernel_tile_circular_buffer", 
                                   cuda_argc, cuda_argv);
@@ -150,9 +350,9 @@ int kernel_circular_buffer(int argc, char **argv)
                 return rc;
         }
 
-        rc = hb_mc_device_memcpy(mc, (void *) B_result,
+        rc = hb_mc_device_memcpy(mc, (void *) B_result.data(),
                                  (void *) ((intptr_t) B_device),
-                                 sizeof(B), HB_MC_MEMCPY_TO_HOST);
+                                 B.size_bytes(), HB_MC_MEMCPY_TO_HOST);
         if(rc != HB_MC_SUCCESS)
         {
                 bsg_pr_test_err("Failed to copy result to host.\n");
@@ -166,16 +366,7 @@ int kernel_circular_buffer(int argc, char **argv)
                 return rc;
         }
 
-        float sse;
-        sse = matrix_sse(B, B_result, 1, N);
-
-        if(std::isnan(sse) || sse > .01)
-        {
-                bsg_pr_test_err(BSG_RED("Result mismatch! SSE: %f\n"), sse);
-                return HB_MC_FAIL;
-        }
-        bsg_pr_test_info(BSG_GREEN("Result match! (SSE: %f)\n"), sse);
-        return HB_MC_SUCCESS;
+        return verify_result("B", B.data(), B_result.data(), 1, N);
 }
 
 #ifdef COSIM
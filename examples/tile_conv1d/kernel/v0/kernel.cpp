@@ -13,7 +13,7 @@
 #include <bsg_manycore.h>
 #include <bsg_tile_group_barrier.h>
 #include <cstdint>
-#include <cstring>
+#include <bsg_memcpy.hpp>
 
 template <typename TI, typename TF, typename TO>
 int conv1d(const TI *INPUT,
@@ -51,8 +51,8 @@ extern "C" {
                 float filter[f_nelements];
                 float output[o_nelements];
 
-                memcpy (input, INPUT, sizeof(INPUT[0])*i_nelements);
-                memcpy (filter, FILTER, sizeof(FILTER[0])*f_nelements);
+                bsg_memcpy_dram_to_dmem (input, INPUT, sizeof(INPUT[0])*i_nelements);
+                bsg_memcpy_dram_to_dmem (filter, FILTER, sizeof(FILTER[0])*f_nelements);
 
                 for(int i = 0; i < 2; ++i){
                         bsg_cuda_print_stat_start(i);
@@ -60,7 +60,7 @@ extern "C" {
                         bsg_cuda_print_stat_end(i);
                 }
 
-                memcpy (OUTPUT, output, sizeof(OUTPUT[0])*o_nelements);
+                bsg_memcpy_dmem_to_dram (OUTPUT, output, sizeof(OUTPUT[0])*o_nelements);
 
                 return rc;
         }
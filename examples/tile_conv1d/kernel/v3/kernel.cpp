@@ -13,7 +13,7 @@
 #include <bsg_manycore.h>
 #include <bsg_tile_group_barrier.h>
 #include <cstdint>
-#include <cstring>
+#include <bsg_memcpy.hpp>
 
 
 template <uint32_t FACTOR, typename TI, typename TF, typename TO>
@@ -35,7 +35,11 @@ int conv1d(const TI *INPUT,
                 for(uint32_t oi = 0; oi < b_nelements_unrolled; oi += FACTOR){
 
                         for (uint32_t fi = 0; fi < FACTOR; ++fi){
+#ifdef __riscv
                                 asm volatile ("fmv.s.x %0,zero\n\t" : "=f" (sum[fi]));
+#else
+                                sum[fi] = 0.0f;
+#endif
                         }
 
                         for(uint32_t fi = 0; fi < f_nelements; fi++) {
@@ -63,7 +67,11 @@ int conv1d(const TI *INPUT,
 
 
                 for (uint32_t fi = 0; fi < FACTOR; ++fi)
+#ifdef __riscv
                         asm volatile ("fmv.s.x %0,zero\n\t" : "=f" (sum[fi]));
+#else
+                        sum[fi] = 0.0f;
+#endif
                 for(uint32_t fi = 0; fi < f_nelements; fi++) {
                         TF f = FILTER[fi];
                         
@@ -97,8 +105,8 @@ extern "C" {
                 float filter[f_nelements];
                 float output[o_nelements];
 
-                memcpy (input, INPUT, sizeof(INPUT[0])*i_nelements);
-                memcpy (filter, FILTER, sizeof(FILTER[0])*f_nelements);
+                bsg_memcpy_dram_to_dmem (input, INPUT, sizeof(INPUT[0])*i_nelements);
+                bsg_memcpy_dram_to_dmem (filter, FILTER, sizeof(FILTER[0])*f_nelements);
 
                 for(int i = 0; i < 2; ++i){
                         bsg_cuda_print_stat_start(i);
@@ -106,7 +114,7 @@ extern "C" {
                         bsg_cuda_print_stat_end(i);
                 }
 
-                memcpy (OUTPUT, output, sizeof(OUTPUT[0])*o_nelements);
+                bsg_memcpy_dmem_to_dram (OUTPUT, output, sizeof(OUTPUT[0])*o_nelements);
 
                 return rc;
         }
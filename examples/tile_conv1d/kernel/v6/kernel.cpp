@@ -13,7 +13,7 @@
 #include <bsg_manycore.h>
 #include <bsg_tile_group_barrier.h>
 #include <cstdint>
-#include <cstring>
+#include <bsg_memcpy.hpp>
 
 // 1098 cycles
 int conv1d_float_manual(const float *A,
@@ -34,6 +34,7 @@ int conv1d_float_manual(const float *A,
         uint32_t oi = 0;
         for(; oi < B_len_unrolled; oi += 4)
         {
+#ifdef __riscv
                 asm ("fmv.s.x %0,zero\n\t"
                      "fmv.s.x %1,zero\n\t"
                      "fmv.s.x %2,zero\n\t"
@@ -42,6 +43,12 @@ int conv1d_float_manual(const float *A,
                        "=f" (sum1),
                        "=f" (sum2),
                        "=f" (sum3));
+#else
+                sum0 = 0.0f;
+                sum1 = 0.0f;
+                sum2 = 0.0f;
+                sum3 = 0.0f;
+#endif
 
                 for(uint32_t fi = 0; fi < F_len; fi++)
                 {
@@ -71,6 +78,7 @@ int conv1d_float_manual(const float *A,
                 ii += step;
         }
 
+#ifdef __riscv
         asm ("fmv.s.x %0,zero\n\t"
              "fmv.s.x %1,zero\n\t"
              "fmv.s.x %2,zero\n\t"
@@ -79,6 +87,12 @@ int conv1d_float_manual(const float *A,
                "=f" (sum1),
                "=f" (sum2),
                "=f" (sum3));
+#else
+        sum0 = 0.0f;
+        sum1 = 0.0f;
+        sum2 = 0.0f;
+        sum3 = 0.0f;
+#endif
         for(uint32_t fi = 0; fi < F_len; fi++)
         {
                 float f = F[fi];
@@ -141,8 +155,8 @@ extern "C" {
                 float filter[f_nelements];
                 float output[o_nelements];
 
-                memcpy (input, INPUT, sizeof(INPUT[0])*i_nelements);
-                memcpy (filter, FILTER, sizeof(FILTER[0])*f_nelements);
+                bsg_memcpy_dram_to_dmem (input, INPUT, sizeof(INPUT[0])*i_nelements);
+                bsg_memcpy_dram_to_dmem (filter, FILTER, sizeof(FILTER[0])*f_nelements);
 
                 for(int i = 0; i < 2; ++i){
                         bsg_cuda_print_stat_start(i);
@@ -150,7 +164,7 @@ extern "C" {
                         bsg_cuda_print_stat_end(i);
                 }
 
-                memcpy (OUTPUT, output, sizeof(OUTPUT[0])*o_nelements);
+                bsg_memcpy_dmem_to_dram (OUTPUT, output, sizeof(OUTPUT[0])*o_nelements);
 
                 return rc;
         }
@@ -29,7 +29,8 @@
 #include <iostream>
 
 #define C_F_LENGTH 5
-#define C_A_LENGTH 128
+// Default input vector length (--size)
+#define DEFAULT_A_LENGTH 128
 #define C_PAD_LENGTH 0
 #define C_STEP_LENGTH 4
 
@@ -46,22 +47,6 @@ void matrix_print(T *A, uint64_t M, uint64_t N) {
         }
 }
 
-// Compute the sum of squared error between matricies A and B (M x N)
-template <typename T>
-double matrix_sse (const T *A, const T *B, uint64_t M, uint64_t N) {
-        double sum = 0;
-        for (uint64_t y = 0; y < M; y ++) {
-                for (uint64_t x = 0; x < N; x ++) {
-                        T diff = A[y * N + x] - B[y * N + x];
-                        if(std::isnan(diff)){
-                                return diff;
-                        }
-                        sum += diff * diff;
-                }
-        }
-        return sum;
-}
-
 uint32_t compute_M(uint32_t N, uint32_t F, uint32_t P, uint32_t S)
 {
         return 1 + (N - F + 2 * P) / S;
@@ -96,10 +81,12 @@ int kernel_conv1d(int argc, char **argv)
 {       
         bsg_pr_test_info("Running CUDA Conv1D Kernel on a single tile.\n\n");
         char *elf, *test_name;
-        struct arguments_path args = { NULL, NULL };
-        argp_parse(&argp_path, argc, argv, 0, 0, &args);
-        elf = args.path;
-        test_name = args.name;
+        struct arguments_size args = {{NULL, NULL}};
+        args.size = DEFAULT_A_LENGTH;
+        args.seed = 42;
+        argp_parse(&argp_size, argc, argv, 0, 0, &args);
+        elf = args.path.path;
+        test_name = args.path.name;
 
         int rc;
         hb_mc_device_t manycore, *mc = &manycore;
@@ -117,60 +104,77 @@ int kernel_conv1d(int argc, char **argv)
                 return rc;
         }
 
-        // Initialize the random number generators
+        // Initialize the random number generators (one stream per input)
         std::numeric_limits<int8_t> lim_int8; // Used to get INT_MIN and INT_MAX in C++
-        std::numeric_limits<uint32_t> lim_uint32; // Used to get INT_MIN and INT_MAX in C++
-        std::default_random_engine generator;
-        generator.seed(42);
-        std::uniform_real_distribution<float> data_distribution(lim_int8.min(),lim_int8.max());
-        std::uniform_real_distribution<float> filter_distribution(lim_int8.min(),lim_int8.max());
+        host_random data_random(args.seed, 0), filter_random(args.seed, 1);
         
         // N: Number of elements in the 1-D input vector, A
-        uint32_t N = C_A_LENGTH;
+        uint32_t N = args.size;
         // F: Number of filter coefficients in 1-D filter, F
         uint32_t F = C_F_LENGTH;
         // S: Step size of convolution
         uint32_t S = C_STEP_LENGTH;
+        if (N < F) {
+                bsg_pr_test_err("N must be at least the filter length (%u).\n", F);
+                return HB_MC_INVALID;
+        }
         uint32_t M = compute_M(N, F, C_PAD_LENGTH, S);
         
         size_t A_size = sizeof(float) * N;
         size_t F_size = sizeof(float) * F;
         size_t B_size = sizeof(float) * M;
         
-        float A_host[N];
-        float filter_host[F];
-        float B_expected[M], B_result[M];
+        host_buffer<float> A_host(N);
+        host_buffer<float> filter_host(F);
+        host_buffer<float> B_expected(M), B_result(M);
+
+        // Reserve device memory for A, F and B, and allocate them from it
+        device_arena arena(mc);
+        rc = arena.init(device_arena::footprint({A_size, F_size, B_size}));
+        if(rc != HB_MC_SUCCESS)
+        {
+                bsg_pr_test_err("Failed to reserve device memory.\n");
+                return rc;
+        }
 
         eva_t A_device, B_device, filter_device;
-        rc = hb_mc_device_malloc(mc, A_size, &A_device);
+        rc = arena.alloc(A_size, &A_device);
         if(rc != HB_MC_SUCCESS)
         {
                 bsg_pr_test_err("Failed to allocate A on the manycore.\n");
                 return rc;
         }
 
-        rc = hb_mc_device_malloc(mc, F_size, &filter_device);
+        rc = arena.alloc(F_size, &filter_device);
         if(rc != HB_MC_SUCCESS)
         {
                 bsg_pr_test_err("Failed to allocate F on the manycore.\n");
                 return rc;
         }
         
-        rc = hb_mc_device_malloc(mc, B_size, &B_device);
+        rc = arena.alloc(B_size, &B_device);
         if(rc != HB_MC_SUCCESS)
         {
                 bsg_pr_test_err("Failed to allocate B on the manycore.\n");
                 return rc;
         }
 
-        for(int i = 0; i < sizeof(A_host) / sizeof(A_host[0]); i++)
-        {
-                A_host[i] = data_distribution(generator);
-        }
+        // Load A, the filter and the known-correct result B from the
+        // dataset cache, or generate them.
+        host_dataset cache("tile_conv1d", "float", {N, F, C_PAD_LENGTH, S}, args.seed);
+        if (!cache.load({{"A", A_host.data(), A_size},
+                         {"F", filter_host.data(), F_size},
+                         {"B", B_expected.data(), B_size}})) {
+                data_random.uniform(A_host.data(), A_host.size(),
+                                    (float) lim_int8.min(), (float) lim_int8.max());
+                filter_random.uniform(filter_host.data(), filter_host.size(),
+                                      (float) lim_int8.min(), (float) lim_int8.max());
 
-        for(int i = 0; i < sizeof(filter_host) / sizeof(filter_host[0]); i++)
-        {
-                filter_host[i] = filter_distribution(generator);
+                conv1d(A_host.data(), N, filter_host.data(), F, C_PAD_LENGTH, C_STEP_LENGTH, B_expected.data());
+
+                cache.store({{"A", A_host.data(), A_size},
+                             {"F", filter_host.data(), F_size},
+                             {"B", B_expected.data(), B_size}});
         }
         
         rc = hb_mc_device_memcpy(mc, 
@@ -211,7 +215,7 @@ int kernel_conv1d(int argc, char **argv)
                 return rc;
         }
 
-        rc = hb_mc_device_memcpy(mc, (void *) B_result, 
+        rc = hb_mc_device_memcpy(mc, (void *) B_result.data(), 
                                  (void *) ((intptr_t) B_device), 
                                  B_size, HB_MC_MEMCPY_TO_HOST);
         if(rc != HB_MC_SUCCESS)
@@ -227,20 +231,12 @@ int kernel_conv1d(int argc, char **argv)
                 return rc;
         }
 
-        conv1d(A_host, N, filter_host, F, C_PAD_LENGTH, C_STEP_LENGTH, B_expected);
-
-        float sse;
-        sse = matrix_sse(B_expected, B_result, 1, M);
-
-        if(std::isnan(sse) || sse > .01)
-        {
-                bsg_pr_test_err(BSG_RED("Result mismatch! SSE: %f\n"), sse);
-                for(int i = 0; i < M; i++)
-                        bsg_pr_test_info("B_actual[%d] = %f, %f = B_expected[%d]\n", i, B_result[i], B_expected[i], i);
-                return HB_MC_FAIL;
-        }
-        bsg_pr_test_info(BSG_GREEN("Result match! (SSE: %f)\n"), sse);
-        return HB_MC_SUCCESS;
+        // Each output is a sum of F products of magnitude at most
+        // lim_int8.min() squared, which the kernels sum in a different
+        // order than the host (and may contract into FMAs).
+        double mag = (double) F * lim_int8.min() * lim_int8.min();
+        return verify_result("B", B_expected.data(), B_result.data(), 1, M,
+                             host_verify_sum_tolerance<float>(F, mag));
 }
 
 #ifdef COSIM
@@ -1,6 +1,9 @@
 #ifndef __MATRIX_MULTIPLY_HPP
 #define __MATRIX_MULTIPLY_HPP
 #include <cstdint>
+#include <cstring>
+#include <bsg_memcpy.hpp>
+#include <bsg_matrix_multiply.hpp>
 
 /*
  * This is a naive implementation of matrix multiplication that
@@ -84,20 +87,11 @@ int __attribute__ ((noinline)) kernel_matrix_multiply_transpose_nomul(
         return 0;
 }
 
-/*
- * This is a smarter implementation of matrix multiplication that
- * multiplies the two matricies A and B and stores the result in C. In
- * this implementation, B is transposed into BT prior to calling the
- * kernel and all multiplies used to index the A, B and C arrays are
- * transformed into additions (nomul). The row-column dot product is
- * unrolled by a factor of F (a template parameter)
- */
 template <unsigned int F, typename TA, typename TB, typename TC>
-int __attribute__ ((noinline)) kernel_matrix_multiply_transpose_nomul_unroll (
+int __attribute__ ((noinline)) kernel_matrix_multiply_transpose_nomul_unroll_init (
                       TA *A, TB *BT, TC *C,
                       uint32_t A_HEIGHT, uint32_t A_WIDTH,
                       uint32_t B_WIDTH) {
-
         uint32_t incr = A_WIDTH * (F-1);
         for (uint32_t y = 0, ayoff = 0, boff = 0, coff = 0; y < A_HEIGHT; y ++, ayoff += A_WIDTH) {
                 boff = 0;
@@ -106,7 +100,7 @@ int __attribute__ ((noinline)) kernel_matrix_multiply_transpose_nomul_unroll (
                         TC sum[F] = {{static_cast<TC>(0)}};
                         for (uint32_t aoff = ayoff; aoff < ayoff + A_WIDTH; aoff++, ++boff) {
                                 bofff = boff;
-#pragma GCC unroll 8 // Does this unroll correctly when F < 4?
+#pragma GCC unroll 8
                                 for (uint32_t f = 0; f < F; ++f, bofff += A_WIDTH){
                                         sum[f] += A[aoff] * BT[bofff];
                                 }
@@ -123,15 +117,56 @@ int __attribute__ ((noinline)) kernel_matrix_multiply_transpose_nomul_unroll (
         return 0;
 }
 
-template <unsigned int F, typename TA, typename TB, typename TC>
+template <unsigned int F, typename TA, typename TB>
 int __attribute__ ((noinline)) kernel_matrix_multiply_transpose_nomul_unroll_init (
-                      TA *A, TB *BT, TC *C,
+                      TA *A, TB *BT, float *C,
                       uint32_t A_HEIGHT, uint32_t A_WIDTH,
                       uint32_t B_WIDTH) {
         uint32_t incr = A_WIDTH * (F-1);
         for (uint32_t y = 0, ayoff = 0, boff = 0, coff = 0; y < A_HEIGHT; y ++, ayoff += A_WIDTH) {
                 boff = 0;
+                //
                 for (uint32_t x = 0; x < B_WIDTH; x += F) {
+                        
+                        uint32_t bofff = 0;
+                        float sum[F];
+#pragma GCC unroll 8
+                        for (uint32_t f = 0; f < F; ++f){
+#ifdef __riscv
+                                asm volatile ("fmv.s.x %0,zero\n\t" : "=f" (sum[f]));
+#else
+                                sum[f] = 0.0f;
+#endif
+                        }
+
+                        for (uint32_t aoff = ayoff; aoff < ayoff + A_WIDTH; aoff++, ++boff) {
+                                bofff = boff;
+#pragma GCC unroll 8
+                                for (uint32_t f = 0; f < F; ++f, bofff += A_WIDTH){
+                                        sum[f] += A[aoff] * BT[bofff];
+                                }
+                        }
+
+#pragma GCC unroll 8
+                        for (uint32_t f = 0; f < F; f++){
+                                C[coff + f] = sum[f];
+                        }
+                        boff += incr;
+                        coff += F;
+                }
+        }
+        return 0;
+}
+
+template <unsigned int F, typename TA, typename TB, typename TC>
+int __attribute__ ((noinline)) kernel_matrix_multiply_transpose_nomul_unroll_init_expect (
+                      TA *A, TB *BT, TC *C,
+                      uint32_t A_HEIGHT, uint32_t A_WIDTH,
+                      uint32_t B_WIDTH) {
+        uint32_t incr = A_WIDTH * (F-1);
+        for (uint32_t y = 0, ayoff = 0, boff = 0, coff = 0; y < A_HEIGHT; y ++, ayoff += A_WIDTH) {
+                boff = 0;
+                for (uint32_t x = 0; __builtin_expect (x < B_WIDTH, 0); x += F) {                        
                         uint32_t bofff = 0;
                         TC sum[F] = {{static_cast<TC>(0)}};
                         for (uint32_t aoff = ayoff; aoff < ayoff + A_WIDTH; aoff++, ++boff) {
@@ -154,21 +189,23 @@ int __attribute__ ((noinline)) kernel_matrix_multiply_transpose_nomul_unroll_ini
 }
 
 template <unsigned int F, typename TA, typename TB>
-int __attribute__ ((noinline)) kernel_matrix_multiply_transpose_nomul_unroll_init (
+int __attribute__ ((noinline)) kernel_matrix_multiply_transpose_nomul_unroll_init_expect (
                       TA *A, TB *BT, float *C,
                       uint32_t A_HEIGHT, uint32_t A_WIDTH,
                       uint32_t B_WIDTH) {
         uint32_t incr = A_WIDTH * (F-1);
         for (uint32_t y = 0, ayoff = 0, boff = 0, coff = 0; y < A_HEIGHT; y ++, ayoff += A_WIDTH) {
                 boff = 0;
-                //
-                for (uint32_t x = 0; x < B_WIDTH; x += F) {
-                        
+                for (uint32_t x = 0; __builtin_expect (x < B_WIDTH, 0); x += F) {                        
                         uint32_t bofff = 0;
                         float sum[F];
 #pragma GCC unroll 8
                         for (uint32_t f = 0; f < F; ++f){
+#ifdef __riscv
                                 asm volatile ("fmv.s.x %0,zero\n\t" : "=f" (sum[f]));
+#else
+                                sum[f] = 0.0f;
+#endif
                         }
 
                         for (uint32_t aoff = ayoff; aoff < ayoff + A_WIDTH; aoff++, ++boff) {
@@ -190,17 +227,119 @@ int __attribute__ ((noinline)) kernel_matrix_multiply_transpose_nomul_unroll_ini
         return 0;
 }
 
-template <unsigned int F, typename TA, typename TB, typename TC>
-int __attribute__ ((noinline)) kernel_matrix_multiply_transpose_nomul_unroll_init_expect (
+/*
+ * Zero the MR x NR block of results of the register-blocked kernel
+ * below. For floats, this uses inline assembly to overcome the same
+ * issue in GCC as kernel_matrix_multiply_transpose_nomul_unroll_init.
+ */
+template <unsigned int MR, unsigned int NR, typename TC>
+inline void matrix_multiply_block_zero(TC (&sum)[MR][NR]) {
+#pragma GCC unroll 8
+        for (uint32_t i = 0; i < MR; ++i)
+#pragma GCC unroll 8
+                for (uint32_t j = 0; j < NR; ++j)
+                        sum[i][j] = static_cast<TC>(0);
+}
+
+template <unsigned int MR, unsigned int NR>
+inline void matrix_multiply_block_zero(float (&sum)[MR][NR]) {
+#pragma GCC unroll 8
+        for (uint32_t i = 0; i < MR; ++i)
+#pragma GCC unroll 8
+                for (uint32_t j = 0; j < NR; ++j)
+#ifdef __riscv
+                        asm volatile ("fmv.s.x %0,zero\n\t" : "=f" (sum[i][j]));
+#else
+                        sum[i][j] = 0.0f;
+#endif
+}
+
+/*
+ * This is a register-blocked implementation of matrix multiplication
+ * that multiplies the two matricies A and B and stores the result in
+ * C. In this implementation, B is transposed into BT prior to calling
+ * the kernel, and C is computed in MR x NR blocks (template
+ * parameters). Each step of the dot-product loop loads MR values of A
+ * (one from each row of the block) and NR values of BT (one from each
+ * column), and performs all MR * NR multiply-accumulates with them,
+ * instead of one load per multiply-accumulate when only the columns
+ * are unrolled. The MR * NR results, and the MR + NR operands, must fit
+ * in the register file (e.g. 4x4: 24 of the 32 floating-point
+ * registers).
+ *
+ * A_HEIGHT must be a multiple of MR, and B_WIDTH a multiple of NR.
+ */
+template <unsigned int MR, unsigned int NR, typename TA, typename TB, typename TC>
+int __attribute__ ((noinline)) kernel_matrix_multiply_transpose_nomul_block (
                       TA *A, TB *BT, TC *C,
                       uint32_t A_HEIGHT, uint32_t A_WIDTH,
                       uint32_t B_WIDTH) {
+        for (uint32_t y = 0, ayoff = 0, coff = 0; y < A_HEIGHT;
+             y += MR, ayoff += MR * A_WIDTH, coff += (MR - 1) * B_WIDTH) {
+                for (uint32_t x = 0, bxoff = 0; x < B_WIDTH;
+                     x += NR, bxoff += NR * A_WIDTH, coff += NR) {
+                        TC sum[MR][NR];
+                        matrix_multiply_block_zero(sum);
+
+                        // One pointer per row of A and per column of
+                        // BT in the block, advanced along k
+                        TA *a[MR];
+                        TB *b[NR];
+#pragma GCC unroll 8
+                        for (uint32_t i = 0, off = ayoff; i < MR; ++i, off += A_WIDTH)
+                                a[i] = &A[off];
+#pragma GCC unroll 8
+                        for (uint32_t j = 0, off = bxoff; j < NR; ++j, off += A_WIDTH)
+                                b[j] = &BT[off];
+
+                        for (uint32_t k = 0; k < A_WIDTH; ++k) {
+                                TA ra[MR];
+                                TB rb[NR];
+#pragma GCC unroll 8
+                                for (uint32_t i = 0; i < MR; ++i)
+                                        ra[i] = *a[i]++;
+#pragma GCC unroll 8
+                                for (uint32_t j = 0; j < NR; ++j)
+                                        rb[j] = *b[j]++;
+#pragma GCC unroll 8
+                                for (uint32_t i = 0; i < MR; ++i)
+#pragma GCC unroll 8
+                                        for (uint32_t j = 0; j < NR; ++j)
+                                                sum[i][j] += ra[i] * rb[j];
+                        }
+
+#pragma GCC unroll 8
+                        for (uint32_t i = 0, off = coff; i < MR; ++i, off += B_WIDTH)
+#pragma GCC unroll 8
+                                for (uint32_t j = 0; j < NR; ++j)
+                                        C[off + j] = sum[i][j];
+                }
+        }
+        return 0;
+}
+
+/*
+ * This is the inner loop of kernel_matrix_multiply_transpose_nomul_unroll_init_expect
+ * (Version 9), for computing C in pieces along the shared
+ * dimension: if accumulate is true, the products are added to C
+ * instead of overwriting it.
+ */
+template <unsigned int F, typename TA, typename TB, typename TC>
+int __attribute__ ((noinline)) kernel_matrix_multiply_transpose_nomul_unroll_accumulate (
+                      TA *A, TB *BT, TC *C,
+                      uint32_t A_HEIGHT, uint32_t A_WIDTH,
+                      uint32_t B_WIDTH, bool accumulate) {
         uint32_t incr = A_WIDTH * (F-1);
         for (uint32_t y = 0, ayoff = 0, boff = 0, coff = 0; y < A_HEIGHT; y ++, ayoff += A_WIDTH) {
                 boff = 0;
-                for (uint32_t x = 0; __builtin_expect (x < B_WIDTH, 0); x += F) {                        
+                for (uint32_t x = 0; __builtin_expect (x < B_WIDTH, 0); x += F) {
                         uint32_t bofff = 0;
-                        TC sum[F] = {{static_cast<TC>(0)}};
+                        TC sum[F];
+#pragma GCC unroll 8
+                        for (uint32_t f = 0; f < F; ++f){
+                                sum[f] = accumulate ? C[coff + f] : static_cast<TC>(0);
+                        }
+
                         for (uint32_t aoff = ayoff; aoff < ayoff + A_WIDTH; aoff++, ++boff) {
                                 bofff = boff;
 #pragma GCC unroll 8
@@ -221,19 +360,30 @@ int __attribute__ ((noinline)) kernel_matrix_multiply_transpose_nomul_unroll_ini
 }
 
 template <unsigned int F, typename TA, typename TB>
-int __attribute__ ((noinline)) kernel_matrix_multiply_transpose_nomul_unroll_init_expect (
+int __attribute__ ((noinline)) kernel_matrix_multiply_transpose_nomul_unroll_accumulate (
                       TA *A, TB *BT, float *C,
                       uint32_t A_HEIGHT, uint32_t A_WIDTH,
-                      uint32_t B_WIDTH) {
+                      uint32_t B_WIDTH, bool accumulate) {
         uint32_t incr = A_WIDTH * (F-1);
         for (uint32_t y = 0, ayoff = 0, boff = 0, coff = 0; y < A_HEIGHT; y ++, ayoff += A_WIDTH) {
                 boff = 0;
-                for (uint32_t x = 0; __builtin_expect (x < B_WIDTH, 0); x += F) {                        
+                for (uint32_t x = 0; __builtin_expect (x < B_WIDTH, 0); x += F) {
                         uint32_t bofff = 0;
                         float sum[F];
+                        if (accumulate) {
 #pragma GCC unroll 8
-                        for (uint32_t f = 0; f < F; ++f){
-                                asm volatile ("fmv.s.x %0,zero\n\t" : "=f" (sum[f]));
+                                for (uint32_t f = 0; f < F; ++f){
+                                        sum[f] = C[coff + f];
+                                }
+                        } else {
+#pragma GCC unroll 8
+                                for (uint32_t f = 0; f < F; ++f){
+#ifdef __riscv
+                                        asm volatile ("fmv.s.x %0,zero\n\t" : "=f" (sum[f]));
+#else
+                                        sum[f] = 0.0f;
+#endif
+                                }
                         }
 
                         for (uint32_t aoff = ayoff; aoff < ayoff + A_WIDTH; aoff++, ++boff) {
@@ -255,4 +405,153 @@ int __attribute__ ((noinline)) kernel_matrix_multiply_transpose_nomul_unroll_ini
         return 0;
 }
 
+/*
+ * This is a matrix multiplication for DRAM-resident matricies of any
+ * size. A (A_HEIGHT x A_WIDTH) and BT (B_WIDTH x A_WIDTH, B
+ * transposed) stay in DRAM; panels of MC rows of A and NC rows of BT,
+ * KC elements wide, are copied into DMEM, and the MC x NC tile of C
+ * that they contribute to is accumulated in DMEM with the Version 9
+ * inner loop (unrolled by 4) and copied back to DRAM when it is
+ * finished. The panels take (MC * KC + NC * KC + MC * NC) elements of
+ * DMEM, whatever the size of the matricies.
+ *
+ * Partial panels at the edges of the matricies are handled by copying
+ * fewer rows of A and a narrower panel, and by zero-filling the rows
+ * of BT that are past B_WIDTH.
+ */
+template <unsigned int MC, unsigned int NC, unsigned int KC,
+          typename TA, typename TB, typename TC>
+int __attribute__ ((noinline)) kernel_matrix_multiply_transpose_panel (
+                      TA *A, TB *BT, TC *C,
+                      uint32_t A_HEIGHT, uint32_t A_WIDTH,
+                      uint32_t B_WIDTH) {
+        static_assert(NC % 4 == 0, "NC must be a multiple of the unroll factor (4)");
+
+        // These arrays are resident in DMEM
+        TA A_local[MC * KC];
+        TB BT_local[NC * KC];
+        TC C_local[MC * NC];
+
+        for (uint32_t ic = 0; ic < A_HEIGHT; ic += MC) {
+                uint32_t mc = A_HEIGHT - ic < MC ? A_HEIGHT - ic : MC;
+                for (uint32_t jc = 0; jc < B_WIDTH; jc += NC) {
+                        uint32_t nc = B_WIDTH - jc < NC ? B_WIDTH - jc : NC;
+                        for (uint32_t pc = 0; pc < A_WIDTH; pc += KC) {
+                                uint32_t kc = A_WIDTH - pc < KC ? A_WIDTH - pc : KC;
+
+                                // Stage the panels, each kc wide
+                                for (uint32_t i = 0; i < mc; ++i)
+                                        bsg_memcpy_dram_to_dmem (&A_local[i * kc], &A[(ic + i) * A_WIDTH + pc], sizeof(TA) * kc);
+                                for (uint32_t j = 0; j < nc; ++j)
+                                        bsg_memcpy_dram_to_dmem (&BT_local[j * kc], &BT[(jc + j) * A_WIDTH + pc], sizeof(TB) * kc);
+                                if (nc < NC)
+                                        memset (&BT_local[nc * kc], 0, sizeof(TB) * (NC - nc) * kc);
+
+                                kernel_matrix_multiply_transpose_nomul_unroll_accumulate<4>(A_local, BT_local, C_local,
+                                                                                            mc, kc, NC, pc != 0);
+                        }
+
+                        for (uint32_t i = 0; i < mc; ++i)
+                                bsg_memcpy_dmem_to_dram (&C[(ic + i) * B_WIDTH + jc], &C_local[i * NC], sizeof(TC) * nc);
+                }
+        }
+        return 0;
+}
+
+/*
+ * A 32-bit word of packed int8_t or int16_t elements. Packed matricies
+ * are read through this type, so it may alias them.
+ */
+typedef uint32_t __attribute__ ((__may_alias__)) matrix_multiply_word_t;
+
+/*
+ * Unpack the 4 / sizeof(T) elements of w (in memory order) into v,
+ * sign-extended to 32 bits, with a shift left and a shift right each.
+ */
+template <typename T>
+inline void matrix_multiply_unpack(uint32_t w, int32_t (&v)[4 / sizeof(T)]) {
+        constexpr unsigned int BITS = 8 * sizeof(T);
+#pragma GCC unroll 4
+        for (unsigned int e = 0; e < 4 / sizeof(T); ++e) {
+                v[e] = static_cast<int32_t>(w << (32 - BITS * (e + 1))) >> (32 - BITS);
+        }
+}
+
+/*
+ * Requantize a 32-bit accumulator to TC: multiply by scale, shift
+ * right by shift (rounding half up) and saturate to the range of TC.
+ */
+template <typename TC>
+inline TC matrix_multiply_requantize(int32_t acc, int32_t scale, uint32_t shift) {
+        constexpr int64_t max = (static_cast<int64_t>(1) << (8 * sizeof(TC) - 1)) - 1;
+        constexpr int64_t min = -max - 1;
+        int64_t v = static_cast<int64_t>(acc) * scale;
+        if (shift)
+                v = (v + (static_cast<int64_t>(1) << (shift - 1))) >> shift;
+        return static_cast<TC>(v < min ? min : (v > max ? max : v));
+}
+
+/*
+ * This is a matrix multiplication for packed int8_t or int16_t
+ * matricies. In this implementation, B is transposed into BT prior to
+ * calling the kernel, and each load reads a 32-bit word of A or BT:
+ * four int8_t or two int16_t elements, which are unpacked with shifts
+ * (See matrix_multiply_unpack). Products are accumulated in 32 bits, so
+ * they do not overflow TC, and are requantized to TC with scale and
+ * shift (See matrix_multiply_requantize). If TC is int32_t, the raw
+ * 32-bit sums are stored instead, and scale and shift are ignored. As
+ * in Version 9, the output loop is unrolled by F, and each word of A is
+ * used for F columns.
+ *
+ * A and BT must be word-aligned, A_WIDTH must be a multiple of 4 /
+ * sizeof(TA) and B_WIDTH must be a multiple of F.
+ */
+template <unsigned int F, typename TA, typename TB, typename TC>
+int __attribute__ ((noinline)) kernel_matrix_multiply_transpose_packed(
+                      TA *A, TB *BT, TC *C,
+                      uint32_t A_HEIGHT, uint32_t A_WIDTH,
+                      uint32_t B_WIDTH, int32_t scale, uint32_t shift) {
+        static_assert(sizeof(TA) == sizeof(TB) && sizeof(TA) <= 2,
+                      "A and B must both be packed int8_t or int16_t");
+        constexpr unsigned int E = 4 / sizeof(TA);
+        const matrix_multiply_word_t *AW = reinterpret_cast<const matrix_multiply_word_t *>(A);
+        const matrix_multiply_word_t *BTW = reinterpret_cast<const matrix_multiply_word_t *>(BT);
+
+        // Words in each row of A and BT
+        uint32_t W = A_WIDTH / E;
+        uint32_t incr = W * F;
+        for (uint32_t y = 0, ayoff = 0, coff = 0; y < A_HEIGHT; y ++, ayoff += W) {
+                for (uint32_t x = 0, boff = 0; __builtin_expect (x < B_WIDTH, 0); x += F, boff += incr) {
+                        int32_t sum[F];
+#pragma GCC unroll 8
+                        for (uint32_t f = 0; f < F; ++f){
+                                sum[f] = 0;
+                        }
+
+                        for (uint32_t aoff = ayoff, bofff = boff; aoff < ayoff + W; aoff++, bofff++) {
+                                int32_t a[E];
+                                matrix_multiply_unpack<TA>(AW[aoff], a);
+#pragma GCC unroll 8
+                                for (uint32_t f = 0, bf = bofff; f < F; ++f, bf += W){
+                                        int32_t b[E];
+                                        matrix_multiply_unpack<TB>(BTW[bf], b);
+#pragma GCC unroll 4
+                                        for (uint32_t e = 0; e < E; ++e){
+                                                sum[f] += a[e] * b[e];
+                                        }
+                                }
+                        }
+
+#pragma GCC unroll 8
+                        for (uint32_t f = 0; f < F; f++){
+                                C[coff + f] = sizeof(TC) == sizeof(int32_t) ?
+                                        static_cast<TC>(sum[f]) :
+                                        matrix_multiply_requantize<TC>(sum[f], scale, shift);
+                        }
+                        coff += F;
+                }
+        }
+        return 0;
+}
+
 #endif
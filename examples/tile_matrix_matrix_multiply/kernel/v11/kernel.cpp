@@ -0,0 +1,111 @@
+/*
+ * This kernel performs matrix multiplication on matricies resident in
+ * DRAM, staging panels of A and BT into DMEM (See
+ * kernel_matrix_multiply_transpose_panel). A, B and C can be any size.
+ */
+
+// BSG_TILE_GROUP_X_DIM and BSG_TILE_GROUP_Y_DIM must be defined
+// before bsg_manycore.h and bsg_tile_group_barrier.h are
+// included. bsg_tiles_X and bsg_tiles_Y must also be defined for
+// legacy reasons, but they are deprecated.
+#define BSG_TILE_GROUP_X_DIM 1
+#define BSG_TILE_GROUP_Y_DIM 1
+#define bsg_tiles_X BSG_TILE_GROUP_X_DIM
+#define bsg_tiles_Y BSG_TILE_GROUP_Y_DIM
+#include <bsg_manycore.h>
+#include <bsg_tile_group_barrier.h>
+
+#define IGNORE_TAG 0
+#include <matrix_multiply.hpp>
+#include <bsg_memcpy.hpp>
+
+// Panel sizes: MC rows of A and NC rows of BT (columns of B), KC
+// elements wide. For 32-bit data the panels and the tile of C use
+// (8 * 16 + 8 * 16 + 8 * 8) * 4 = 1280 bytes of DMEM.
+#ifndef PANEL_MC
+#define PANEL_MC 8
+#endif
+#ifndef PANEL_NC
+#define PANEL_NC 8
+#endif
+#ifndef PANEL_KC
+#define PANEL_KC 16
+#endif
+
+/* We wrap all external-facing C++ kernels with `extern "C"` to
+ * prevent name mangling 
+ */
+extern "C" {
+        int  __attribute__ ((noinline)) kernel_matrix_multiply_int(
+                      int *A, int *B, int *C,
+                      uint32_t A_HEIGHT, uint32_t A_WIDTH,
+                      uint32_t B_WIDTH, uint32_t tag, uint32_t iter) {
+                int rc, temp = IGNORE_TAG;
+
+                // A, B and C stay in DRAM: each iteration streams them
+                // through DMEM one panel at a time.
+                for(int i = 0; i <= iter; ++i){
+                        bsg_cuda_print_stat_start(temp);
+                        rc = kernel_matrix_multiply_transpose_panel<PANEL_MC, PANEL_NC, PANEL_KC>(A, B, C,
+                                                                                                   A_HEIGHT, A_WIDTH, B_WIDTH);
+                        bsg_cuda_print_stat_end(temp);
+                        temp = tag;
+                }
+
+                return rc;
+        }
+        int  __attribute__ ((noinline)) kernel_matrix_multiply_int16(
+                      int16_t *A, int16_t *B, int16_t *C,
+                      uint32_t A_HEIGHT, uint32_t A_WIDTH,
+                      uint32_t B_WIDTH, uint32_t tag, uint32_t iter) {
+                int rc, temp = IGNORE_TAG;
+
+                // A, B and C stay in DRAM: each iteration streams them
+                // through DMEM one panel at a time.
+                for(int i = 0; i <= iter; ++i){
+                        bsg_cuda_print_stat_start(temp);
+                        rc = kernel_matrix_multiply_transpose_panel<PANEL_MC, PANEL_NC, PANEL_KC>(A, B, C,
+                                                                                                   A_HEIGHT, A_WIDTH, B_WIDTH);
+                        bsg_cuda_print_stat_end(temp);
+                        temp = tag;
+                }
+
+                return rc;
+        }
+        int  __attribute__ ((noinline)) kernel_matrix_multiply_int8(
+                      int8_t *A, int8_t *B, int8_t *C,
+                      uint32_t A_HEIGHT, uint32_t A_WIDTH,
+                      uint32_t B_WIDTH, uint32_t tag, uint32_t iter) {
+                int rc, temp = IGNORE_TAG;
+
+                // A, B and C stay in DRAM: each iteration streams them
+                // through DMEM one panel at a time.
+                for(int i = 0; i <= iter; ++i){
+                        bsg_cuda_print_stat_start(temp);
+                        rc = kernel_matrix_multiply_transpose_panel<PANEL_MC, PANEL_NC, PANEL_KC>(A, B, C,
+                                                                                                   A_HEIGHT, A_WIDTH, B_WIDTH);
+                        bsg_cuda_print_stat_end(temp);
+                        temp = tag;
+                }
+
+                return rc;
+        }
+        int  __attribute__ ((noinline)) kernel_matrix_multiply_float(
+                      float *A, float *B, float *C,
+                      uint32_t A_HEIGHT, uint32_t A_WIDTH,
+                      uint32_t B_WIDTH, uint32_t tag, uint32_t iter) {
+                int rc, temp = IGNORE_TAG;
+
+                // A, B and C stay in DRAM: each iteration streams them
+                // through DMEM one panel at a time.
+                for(int i = 0; i <= iter; ++i){
+                        bsg_cuda_print_stat_start(temp);
+                        rc = kernel_matrix_multiply_transpose_panel<PANEL_MC, PANEL_NC, PANEL_KC>(A, B, C,
+                                                                                                   A_HEIGHT, A_WIDTH, B_WIDTH);
+                        bsg_cuda_print_stat_end(temp);
+                        temp = tag;
+                }
+
+                return rc;
+        }
+}
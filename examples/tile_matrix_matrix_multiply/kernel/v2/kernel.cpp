@@ -15,7 +15,7 @@
 
 #define IGNORE_TAG 0
 #include <matrix_multiply.hpp>
-#include <cstring>
+#include <bsg_memcpy.hpp>
 
 /* We wrap all external-facing C++ kernels with `extern "C"` to
  * prevent name mangling 
@@ -32,8 +32,8 @@ extern "C" {
                 int B_local[A_WIDTH * B_WIDTH];
                 int C_local[A_HEIGHT * B_WIDTH];
 
-                memcpy (A_local, A, sizeof(A[0])*A_HEIGHT*A_WIDTH);
-                memcpy (B_local, B, sizeof(B[0])*A_WIDTH*B_WIDTH);
+                bsg_memcpy_dram_to_dmem (A_local, A, sizeof(A[0])*A_HEIGHT*A_WIDTH);
+                bsg_memcpy_dram_to_dmem (B_local, B, sizeof(B[0])*A_WIDTH*B_WIDTH);
 
                 for(int i = 0; i <= iter; ++i){
                         bsg_cuda_print_stat_start(temp);
@@ -42,7 +42,7 @@ extern "C" {
                         temp = tag;
                 }
 
-                memcpy (C, C_local, sizeof(C[0])*A_HEIGHT*B_WIDTH);
+                bsg_memcpy_dmem_to_dram (C, C_local, sizeof(C[0])*A_HEIGHT*B_WIDTH);
 
                 return rc;
         }
@@ -58,8 +58,8 @@ extern "C" {
                 int16_t B_local[A_WIDTH * B_WIDTH];
                 int16_t C_local[A_HEIGHT * B_WIDTH];
 
-                memcpy (A_local, A, sizeof(A[0])*A_HEIGHT*A_WIDTH);
-                memcpy (B_local, B, sizeof(B[0])*A_WIDTH*B_WIDTH);
+                bsg_memcpy_dram_to_dmem (A_local, A, sizeof(A[0])*A_HEIGHT*A_WIDTH);
+                bsg_memcpy_dram_to_dmem (B_local, B, sizeof(B[0])*A_WIDTH*B_WIDTH);
 
                 for(int i = 0; i <= iter; ++i){
                         bsg_cuda_print_stat_start(temp);
@@ -68,7 +68,7 @@ extern "C" {
                         temp = tag;
                 }
 
-                memcpy (C, C_local, sizeof(C[0])*A_HEIGHT*B_WIDTH);
+                bsg_memcpy_dmem_to_dram (C, C_local, sizeof(C[0])*A_HEIGHT*B_WIDTH);
 
                 return rc;
         }
@@ -84,8 +84,8 @@ extern "C" {
                 int8_t B_local[A_WIDTH * B_WIDTH];
                 int8_t C_local[A_HEIGHT * B_WIDTH];
 
-                memcpy (A_local, A, sizeof(A[0])*A_HEIGHT*A_WIDTH);
-                memcpy (B_local, B, sizeof(B[0])*A_WIDTH*B_WIDTH);
+                bsg_memcpy_dram_to_dmem (A_local, A, sizeof(A[0])*A_HEIGHT*A_WIDTH);
+                bsg_memcpy_dram_to_dmem (B_local, B, sizeof(B[0])*A_WIDTH*B_WIDTH);
 
                 for(int i = 0; i <= iter; ++i){
                         bsg_cuda_print_stat_start(temp);
@@ -94,7 +94,7 @@ extern "C" {
                         temp = tag;
                 }
 
-                memcpy (C, C_local, sizeof(C[0])*A_HEIGHT*B_WIDTH);
+                bsg_memcpy_dmem_to_dram (C, C_local, sizeof(C[0])*A_HEIGHT*B_WIDTH);
 
                 return rc;
         }
@@ -111,8 +111,8 @@ extern "C" {
                 float B_local[A_WIDTH * B_WIDTH];
                 float C_local[A_HEIGHT * B_WIDTH];
 
-                memcpy (A_local, A, sizeof(A[0])*A_HEIGHT*A_WIDTH);
-                memcpy (B_local, B, sizeof(B[0])*A_WIDTH*B_WIDTH);
+                bsg_memcpy_dram_to_dmem (A_local, A, sizeof(A[0])*A_HEIGHT*A_WIDTH);
+                bsg_memcpy_dram_to_dmem (B_local, B, sizeof(B[0])*A_WIDTH*B_WIDTH);
 
                 for(int i = 0; i <= iter; ++i){
                         bsg_cuda_print_stat_start(temp);
@@ -121,7 +121,7 @@ extern "C" {
                         temp = tag;
                 }
 
-                memcpy (C, C_local, sizeof(C[0])*A_HEIGHT*B_WIDTH);
+                bsg_memcpy_dmem_to_dram (C, C_local, sizeof(C[0])*A_HEIGHT*B_WIDTH);
 
                 return rc;
         }
@@ -28,37 +28,22 @@
 // Matrix-Matrix Multiplication (A * B = C) on a single tile.  
 
 // A is A_HEIGHT * A_WIDTH, B is B_HEIGHT * B_WIDTH and C is C_HEIGHT *
-// C_WIDTH. Each time the kernel is called, it is run for (NUM_ITER + 1)
-// iterations and the first iteration is discarded.
+// C_WIDTH (--m, --k and --n set A_HEIGHT, A_WIDTH and B_WIDTH). Each
+// time the kernel is called, it is run for (NUM_ITER + 1) iterations
+// and the first iteration is discarded (--iters).
 // 
-// NOTE: A_HEIGHT * A_WIDTH + B_HEIGHT * B_WIDTH + C_HEIGHT * C_WIDTH <= 4KB,
-// the size of DMEM on the tile.
+// NOTE: Versions 2 - 10 and 12 copy A, B and C into DMEM, so 4 *
+// (A_HEIGHT * A_WIDTH + B_HEIGHT * B_WIDTH + C_HEIGHT * C_WIDTH) bytes
+// must fit in BSG_TILE_DMEM_DATA_BYTES. Version 11 streams them from
+// DRAM and has no limit.
 
 #include "tile_matrix_matrix_multiply.hpp"
 
-// Matrix sizes:
-#define A_HEIGHT 8
-#define A_WIDTH  8
-#define B_HEIGHT A_WIDTH
-#define B_WIDTH  8
-#define C_HEIGHT A_HEIGHT
-#define C_WIDTH  B_WIDTH
-#define NUM_ITER 4
-
-// Host Matrix multiplication code (to compare results)
-template <typename TA, typename TB, typename TC>
-void matrix_mult (TA *A, TB *B, TC *C, uint64_t M, uint64_t N, uint64_t P) {
-        for (uint64_t y = 0; y < M; y ++) {
-                for (uint64_t x = 0; x < P; x ++) {
-                        TC res = 0.0f;
-                        for (uint64_t k = 0; k < N; k++) {
-                                res += A[y * N + k] * B[k * P + x];
-                        }
-                        C[y * P + x] = res;
-                }
-        }
-        return;
-}
+// Default matrix sizes and iterations:
+#define DEFAULT_A_HEIGHT 8
+#define DEFAULT_A_WIDTH  8
+#define DEFAULT_B_WIDTH  8
+#define DEFAULT_NUM_ITER 4
 
 // Matrix utility functions. 
 
@@ -68,28 +53,12 @@ void matrix_transpose (const T *A, T *B, uint64_t M, uint64_t N) {
         double sum = 0;
         for (uint64_t y = 0; y < M; y ++) {
                 for (uint64_t x = 0; x < N; x ++) {
-                        B[x * N + y] = A[y * M + x];
+                        B[x * M + y] = A[y * N + x];
                 }
         }
 }
 
 
-// Compute the sum of squared error between matricies A and B (M x N)
-template <typename T>
-double matrix_sse (const T *A, const T *B, uint64_t M, uint64_t N) {
-        double sum = 0;
-        for (uint64_t y = 0; y < M; y ++) {
-                for (uint64_t x = 0; x < N; x ++) {
-                        T diff = A[y * N + x] - B[y * N + x];
-                        if(std::isnan(diff)){
-                                return diff;
-                        }
-                        sum += diff * diff;
-                }
-        }
-        return sum;
-}
-
 // Print matrix A (M x N). This works well for small matricies.
 template <typename T>
 void matrix_print(T *A, uint64_t M, uint64_t N) {
@@ -104,37 +73,45 @@ void matrix_print(T *A, uint64_t M, uint64_t N) {
 }
 
 
-// Run a Matrix-Matrix Multiply test on the Manycore, and compare the result.  A
-// and B are the input matricies, C is the destination, and gold is the
-// known-good result computed by the host.
+// Run a Matrix-Matrix Multiply test on the Manycore. A and B are the
+// input matricies and C is the destination. The copies of A and B are
+// batched with the copy-back of the previous test in transfers, and
+// the copy-back of C is left queued in transfers: C is not valid until
+// transfers is next flushed.
 template<typename TA, typename TB, typename TC>
-int run_test(hb_mc_device_t &device, const char* kernel,
-             const TA *A, const TB *B, TC *C, const TC *gold,
-             const eva_t &A_device,
-             const eva_t &B_device,
-             const eva_t &C_device,
+int run_test(hb_mc_device_t &device, device_arena &arena,
+             host_transfer_queue &transfers,
+             const char* kernel,
+             const TA *A, const TB *B, TC *C,
              const hb_mc_dimension_t &tg_dim,
              const hb_mc_dimension_t &grid_dim,
-             const unsigned int tag){
+             const uint32_t A_HEIGHT, const uint32_t A_WIDTH,
+             const uint32_t B_WIDTH, const uint32_t NUM_ITER,
+             const unsigned int tag,
+             const int32_t scale = 1, const uint32_t shift = 0){
+        const uint32_t B_HEIGHT = A_WIDTH;
+        const uint32_t C_HEIGHT = A_HEIGHT, C_WIDTH = B_WIDTH;
         int rc;
 
-        // Copy A & B from host onto device DRAM.
-        void *dst = (void *) ((intptr_t) A_device);
-        void *src = (void *) &A[0];
-        rc = hb_mc_device_memcpy (&device, dst, src,
-                                  (A_HEIGHT * A_WIDTH) * sizeof(TA),
-                                  HB_MC_MEMCPY_TO_DEVICE);
+        // Allocate A, B and C on the device, sized for this test's data
+        // types. The previous test's buffers are released first: its
+        // pending copy-back is performed before this test's uploads.
+        arena.reset();
+        eva_t A_device, B_device, C_device;
+        rc = arena.alloc((A_HEIGHT * A_WIDTH) * sizeof(TA), &A_device);
+        if (rc == HB_MC_SUCCESS)
+                rc = arena.alloc((B_HEIGHT * B_WIDTH) * sizeof(TB), &B_device);
+        if (rc == HB_MC_SUCCESS)
+                rc = arena.alloc((C_HEIGHT * C_WIDTH) * sizeof(TC), &C_device);
         if (rc != HB_MC_SUCCESS) {
-                bsg_pr_test_err("failed to copy memory to device.\n");
+                bsg_pr_test_err("failed to allocate memory on device.\n");
                 return rc;
         }
 
-
-        dst = (void *) ((intptr_t) B_device);
-        src = (void *) &B[0];
-        rc = hb_mc_device_memcpy (&device, dst, src,
-                                  (B_HEIGHT * B_WIDTH) * sizeof(TB),
-                                  HB_MC_MEMCPY_TO_DEVICE);
+        // Copy A & B from host onto device DRAM.
+        transfers.to_device(A_device, A, (A_HEIGHT * A_WIDTH) * sizeof(TA));
+        transfers.to_device(B_device, B, (B_HEIGHT * B_WIDTH) * sizeof(TB));
+        rc = transfers.flush();
         if (rc != HB_MC_SUCCESS) {
                 bsg_pr_test_err("failed to copy memory to device.\n");
                 return rc;
@@ -145,7 +122,8 @@ int run_test(hb_mc_device_t &device, const char* kernel,
         // file for the argument uses.
         uint32_t cuda_argv[10] = {A_device, B_device, C_device,
                                   A_HEIGHT, A_WIDTH, B_WIDTH, 
-                                  tag, NUM_ITER};
+                                  tag, NUM_ITER,
+                                  static_cast<uint32_t>(scale), shift};
 
         // Enquque grid of tile groups, pass in grid and tile group dimensions,
         // kernel name, number and list of input arguments
@@ -166,37 +144,94 @@ int run_test(hb_mc_device_t &device, const char* kernel,
         }
 
 
-        // Copy result matrix back from device DRAM into host memory.
-        src = (void *) ((intptr_t) C_device);
-        dst = (void *) &C[0];
-        rc = hb_mc_device_memcpy (&device, (void *) dst, src,
-                                  (C_HEIGHT * C_WIDTH) * sizeof(TC),
-                                  HB_MC_MEMCPY_TO_HOST);
-        if (rc != HB_MC_SUCCESS) {
-                bsg_pr_test_err("failed to copy memory from device.\n");
-                return rc;
-        }
+        // Queue the copy of the result matrix back from device DRAM
+        // into host memory.
+        transfers.to_host(C, C_device, (C_HEIGHT * C_WIDTH) * sizeof(TC));
+        return HB_MC_SUCCESS;
+}
 
-        // Compare the known-correct matrix (gold) and the result matrix (C)
-        float max = 0.1;
-        double sse = matrix_sse(gold, C, C_HEIGHT, C_WIDTH);
+// The packed kernels (v12) accumulate int8_t and int16_t products in 32
+// bits and requantize them to TC (See matrix_requantize). Choose the
+// shift so that a sum of A_WIDTH products of magnitude at most max_product
+// fits in TC.
+template<typename TC>
+uint32_t requantize_shift(const uint32_t A_WIDTH, const uint64_t max_product){
+        uint64_t max_acc = A_WIDTH * max_product;
+        uint32_t shift = 0;
+        while ((max_acc >> shift) > static_cast<uint64_t>(std::numeric_limits<TC>::max()))
+                ++shift;
+        return shift;
+}
 
-        if (std::isnan(sse) || sse > max) {
-                bsg_pr_test_err(BSG_RED("Matrix Mismatch. SSE: %f\n"), sse);
-                return HB_MC_FAIL;
-        }
-        bsg_pr_test_info(BSG_GREEN("Matrix Match.\n"));
+// Compare the known-correct matrix (gold) and the result matrix (C)
+template<typename TC>
+int check_test(const char *name, const TC *C, const TC *gold,
+               const uint32_t C_HEIGHT, const uint32_t C_WIDTH,
+               host_verify_tolerance tol = HOST_VERIFY_DEFAULT_TOLERANCE){
+        return verify_result(name, gold, C, C_HEIGHT, C_WIDTH, tol);
 }
 
 // Run a series of Matrix-Matrix multiply tsts on the Manycore device
 int kernel_matrix_matrix_multiply (int argc, char **argv) {
         int rc;
         char *bin_path, *test_name;
-        struct arguments_path args = {NULL, NULL};
+        struct arguments_size args = {{NULL, NULL}};
+        args.m = DEFAULT_A_HEIGHT;
+        args.k = DEFAULT_A_WIDTH;
+        args.n = DEFAULT_B_WIDTH;
+        args.iters = DEFAULT_NUM_ITER;
+        args.seed = 42;
+
+        argp_parse (&argp_size, argc, argv, 0, 0, &args);
+        bin_path = args.path.path;
+        test_name = args.path.name;
+
+        const uint32_t A_HEIGHT = args.m, A_WIDTH = args.k, B_WIDTH = args.n;
+        const uint32_t B_HEIGHT = A_WIDTH;
+        const uint32_t C_HEIGHT = A_HEIGHT, C_WIDTH = B_WIDTH;
+        const uint32_t NUM_ITER = args.iters;
+
+        // The unrolled kernels (v5 - v9, v12) compute F columns of C at a
+        // time, so B_WIDTH must be a multiple of F.
+        const char *versions[] = {"v5", "v6", "v7", "v8", "v9", "v12"};
+        const uint32_t unroll[] = {2, 4, 8, 4, 4, 4};
+        for (int i = 0; i < 6; ++i) {
+                if (!strcmp(versions[i], test_name) && (B_WIDTH % unroll[i])) {
+                        bsg_pr_test_err("%s requires N to be a multiple of %u.\n",
+                                        test_name, unroll[i]);
+                        return HB_MC_INVALID;
+                }
+        }
+
+        // The register-blocked kernel (v10) computes 4x4 blocks of C
+        if (!strcmp("v10", test_name) && ((A_HEIGHT % 4) || (B_WIDTH % 4))) {
+                bsg_pr_test_err("%s requires M and N to be multiples of 4.\n",
+                                test_name);
+                return HB_MC_INVALID;
+        }
 
-        argp_parse (&argp_path, argc, argv, 0, 0, &args);
-        bin_path = args.path;
-        test_name = args.name;
+        // The packed kernels (v12) read 4 int8_t (or 2 int16_t)
+        // elements of each row of A and BT at a time
+        const bool packed = !strcmp("v12", test_name);
+        if (packed && (A_WIDTH % 4)) {
+                bsg_pr_test_err("%s requires K to be a multiple of 4.\n",
+                                test_name);
+                return HB_MC_INVALID;
+        }
+
+        // Versions 2 - 10 and 12 copy A, B and C into DMEM (v0 and v1
+        // read DRAM, and v11 streams panels through fixed buffers)
+        const bool staged = strcmp("v0", test_name) && strcmp("v1", test_name) &&
+                strcmp("v11", test_name);
+        const uint64_t staged_bytes = sizeof(float) *
+                ((uint64_t) A_HEIGHT * A_WIDTH + (uint64_t) B_HEIGHT * B_WIDTH +
+                 (uint64_t) C_HEIGHT * C_WIDTH);
+        if (staged && staged_bytes > BSG_TILE_DMEM_DATA_BYTES) {
+                bsg_pr_test_err("%s copies A, B and C into DMEM: %llu bytes do not "
+                                "fit in %u.\n", test_name,
+                                (unsigned long long) staged_bytes, BSG_TILE_DMEM_DATA_BYTES);
+                return HB_MC_INVALID;
+        }
 
         bsg_pr_test_info("Running CUDA Matrix-Matrix Multiplication "
                          "on a single tile.\n");
@@ -206,81 +241,109 @@ int kernel_matrix_matrix_multiply (int argc, char **argv) {
         hb_mc_dimension_t tg_dim = { .x = 1, .y = 1 };
         hb_mc_dimension_t grid_dim = { .x = 1, .y = 1 };
 
-        // Initialize the random number generators
+        // Initialize the random number generators (one stream per input)
         std::numeric_limits<int8_t> lim; // Used to get INT_MIN and INT_MAX in C++
-        std::default_random_engine generator;
-        generator.seed(42);
-        std::uniform_real_distribution<float> distribution(lim.min(),lim.max());
+        host_random A_random(args.seed, 0), B_random(args.seed, 1);
 
         // Allocate A, B, BT (B-Transposed), C and R (result) on the host for each datatype.
         // Allocate pointers for B to abstract between when we use B or BT. B is
         // used on kernel versions v0, v1, and v2. BT is used on all subsequent versions.
-        int32_t A_32[A_HEIGHT * A_WIDTH];
-        int32_t B_32[B_HEIGHT * B_WIDTH], BT_32[B_HEIGHT * B_WIDTH], *B_32p;
-        int32_t C_32[C_HEIGHT * C_WIDTH];
-        int32_t R_32[C_HEIGHT * C_WIDTH];
-
-        int16_t A_16[A_HEIGHT * A_WIDTH];
-        int16_t B_16[B_HEIGHT * B_WIDTH], BT_16[B_HEIGHT * B_WIDTH], *B_16p;
-        int16_t C_16[C_HEIGHT * C_WIDTH];
-        int16_t R_16[C_HEIGHT * C_WIDTH];
-
-        int8_t A_8[A_HEIGHT * A_WIDTH];
-        int8_t B_8[B_HEIGHT * B_WIDTH], BT_8[B_HEIGHT * B_WIDTH], *B_8p;
-        int8_t C_8[C_HEIGHT * C_WIDTH];
-        int8_t R_8[C_HEIGHT * C_WIDTH];
-
-        float A_f[A_HEIGHT * A_WIDTH];
-        float B_f[B_HEIGHT * B_WIDTH], BT_f[B_HEIGHT * B_WIDTH], *B_fp;
-        float C_f[C_HEIGHT * C_WIDTH];
-        float R_f[C_HEIGHT * C_WIDTH];
+        host_buffer<int32_t> A_32(A_HEIGHT * A_WIDTH);
+        host_buffer<int32_t> B_32(B_HEIGHT * B_WIDTH), BT_32(B_HEIGHT * B_WIDTH);
+        host_buffer<int32_t> C_32(C_HEIGHT * C_WIDTH);
+        host_buffer<int32_t> R_32(C_HEIGHT * C_WIDTH);
+        int32_t *B_32p;
+
+        host_buffer<int16_t> A_16(A_HEIGHT * A_WIDTH);
+        host_buffer<int16_t> B_16(B_HEIGHT * B_WIDTH), BT_16(B_HEIGHT * B_WIDTH);
+        host_buffer<int16_t> C_16(C_HEIGHT * C_WIDTH);
+        host_buffer<int16_t> R_16(C_HEIGHT * C_WIDTH);
+        int16_t *B_16p;
+
+        host_buffer<int8_t> A_8(A_HEIGHT * A_WIDTH);
+        host_buffer<int8_t> B_8(B_HEIGHT * B_WIDTH), BT_8(B_HEIGHT * B_WIDTH);
+        host_buffer<int8_t> C_8(C_HEIGHT * C_WIDTH);
+        host_buffer<int8_t> R_8(C_HEIGHT * C_WIDTH);
+        int8_t *B_8p;
+
+        host_buffer<float> A_f(A_HEIGHT * A_WIDTH);
+        host_buffer<float> B_f(B_HEIGHT * B_WIDTH), BT_f(B_HEIGHT * B_WIDTH);
+        host_buffer<float> C_f(C_HEIGHT * C_WIDTH);
+        host_buffer<float> R_f(C_HEIGHT * C_WIDTH);
+        float *B_fp;
 
         if(!strcmp("v0", test_name) || !strcmp("v1", test_name) || !strcmp("v2", test_name)){
-                B_32p = B_32; B_16p = B_16; B_8p = B_8; B_fp = B_f;
+                B_32p = B_32.data(); B_16p = B_16.data(); B_8p = B_8.data(); B_fp = B_f.data();
         } else {
-                B_32p = BT_32; B_16p = BT_16; B_8p = BT_8; B_fp = BT_f;
+                B_32p = BT_32.data(); B_16p = BT_16.data(); B_8p = BT_8.data(); B_fp = BT_f.data();
         }
         
+        // Load the floating-point inputs and the known-correct results
+        // from the dataset cache, or generate them.
+        host_dataset cache("tile_matrix_matrix_multiply", "int32-int16-int8-float",
+                           {A_HEIGHT, A_WIDTH, B_WIDTH}, args.seed);
+        bool cached = cache.load({{"A", A_f.data(), A_f.size_bytes()},
+                                  {"B", B_f.data(), B_f.size_bytes()},
+                                  {"R_32", R_32.data(), R_32.size_bytes()},
+                                  {"R_16", R_16.data(), R_16.size_bytes()},
+                                  {"R_8", R_8.data(), R_8.size_bytes()},
+                                  {"R_f", R_f.data(), R_f.size_bytes()}});
+
         // Generate random numbers. Since the Manycore can't handle infinities,
-        // subnormal numbers, or NANs, filter those out.
-        auto res = distribution(generator);
+        // subnormal numbers, or NANs, host_random filters those out. The
+        // integer inputs are the floating-point inputs, truncated.
+        if (!cached) {
+                A_random.uniform(A_f.data(), A_f.size(), (float) lim.min(), (float) lim.max());
+                B_random.uniform(B_f.data(), B_f.size(), (float) lim.min(), (float) lim.max());
+        }
 
         for (uint64_t i = 0; i < A_HEIGHT * A_WIDTH; i++) {
-                do{
-                        res = distribution(generator);
-                }while(!std::isnormal(res) ||
-                       !std::isfinite(res) ||
-                       std::isnan(res));
-
-                A_32[i] = static_cast<int32_t>(res);
-                A_16[i] = static_cast<int16_t>(res);
-                A_8[i] = static_cast<int8_t>(res);
-                A_f[i] = static_cast<float>(res);
+                A_32[i] = static_cast<int32_t>(A_f[i]);
+                A_16[i] = static_cast<int16_t>(A_f[i]);
+                A_8[i] = static_cast<int8_t>(A_f[i]);
         }
 
         for (uint64_t i = 0; i < B_HEIGHT * B_WIDTH; i++) {
-                do{
-                        res = distribution(generator);
-                }while(!std::isnormal(res) ||
-                       !std::isfinite(res) ||
-                       std::isnan(res));
-
-                B_32[i] = static_cast<int32_t>(res);
-                B_16[i] = static_cast<int16_t>(res);
-                B_8[i] = static_cast<int8_t>(res);
-                B_f[i] = static_cast<float>(res);
+                B_32[i] = static_cast<int32_t>(B_f[i]);
+                B_16[i] = static_cast<int16_t>(B_f[i]);
+                B_8[i] = static_cast<int8_t>(B_f[i]);
         }
 
         // Generate the known-correct results on the host
-        matrix_mult (A_32, B_32, R_32, A_HEIGHT, A_WIDTH, B_WIDTH);
-        matrix_mult (A_16, B_16, R_16, A_HEIGHT, A_WIDTH, B_WIDTH);
-        matrix_mult (A_8, B_8, R_8, A_HEIGHT, A_WIDTH, B_WIDTH);
-        matrix_mult (A_f, B_f, R_f, A_HEIGHT, A_WIDTH, B_WIDTH);
+        if (!cached) {
+                matrix_mult (A_32.data(), B_32.data(), R_32.data(), A_HEIGHT, A_WIDTH, B_WIDTH);
+                matrix_mult (A_16.data(), B_16.data(), R_16.data(), A_HEIGHT, A_WIDTH, B_WIDTH);
+                matrix_mult (A_8.data(), B_8.data(), R_8.data(), A_HEIGHT, A_WIDTH, B_WIDTH);
+                matrix_mult (A_f.data(), B_f.data(), R_f.data(), A_HEIGHT, A_WIDTH, B_WIDTH);
+
+                cache.store({{"A", A_f.data(), A_f.size_bytes()},
+                             {"B", B_f.data(), B_f.size_bytes()},
+                             {"R_32", R_32.data(), R_32.size_bytes()},
+                             {"R_16", R_16.data(), R_16.size_bytes()},
+                             {"R_8", R_8.data(), R_8.size_bytes()},
+                             {"R_f", R_f.data(), R_f.size_bytes()}});
+        }
 
-        matrix_transpose(B_32, BT_32, B_HEIGHT, B_WIDTH);
-        matrix_transpose(B_16, BT_16, B_HEIGHT, B_WIDTH);
-        matrix_transpose(B_8, BT_8, B_HEIGHT, B_WIDTH);
-        matrix_transpose(B_f, BT_f, B_HEIGHT, B_WIDTH);
+        // The packed kernels accumulate int8_t and int16_t products in
+        // 32 bits and requantize them, instead of accumulating in TC.
+        // Their _acc32 variants return the raw 32-bit sums. The inputs
+        // are in the range of int8_t.
+        const int32_t scale = 1;
+        const uint32_t shift_16 = requantize_shift<int16_t>(A_WIDTH, 128 * 128);
+        const uint32_t shift_8 = requantize_shift<int8_t>(A_WIDTH, 128 * 128);
+        host_buffer<int32_t> C_acc16(C_HEIGHT * C_WIDTH), R_acc16(C_HEIGHT * C_WIDTH);
+        host_buffer<int32_t> C_acc8(C_HEIGHT * C_WIDTH), R_acc8(C_HEIGHT * C_WIDTH);
+        if (packed) {
+                matrix_mult (A_16.data(), B_16.data(), R_acc16.data(), A_HEIGHT, A_WIDTH, B_WIDTH);
+                matrix_requantize (R_acc16.data(), R_16.data(), R_acc16.size(), scale, shift_16);
+                matrix_mult (A_8.data(), B_8.data(), R_acc8.data(), A_HEIGHT, A_WIDTH, B_WIDTH);
+                matrix_requantize (R_acc8.data(), R_8.data(), R_acc8.size(), scale, shift_8);
+        }
+
+        matrix_transpose(B_32.data(), BT_32.data(), B_HEIGHT, B_WIDTH);
+        matrix_transpose(B_16.data(), BT_16.data(), B_HEIGHT, B_WIDTH);
+        matrix_transpose(B_8.data(), BT_8.data(), B_HEIGHT, B_WIDTH);
+        matrix_transpose(B_f.data(), BT_f.data(), B_HEIGHT, B_WIDTH);
 
         // Initialize device, load binary and unfreeze tiles.
         hb_mc_device_t device;
@@ -298,78 +361,139 @@ int kernel_matrix_matrix_multiply (int argc, char **argv) {
                 return rc;
         }
 
-        // Allocate memory on the device for A, B and C. Since sizeof(float) ==
-        // sizeof(int32_t) > sizeof(int16_t) > sizeof(int8_t) we'll reuse the
-        // same buffers for each test
+        // Reserve device memory for the largest test (32-bit A, B and
+        // C). Each test allocates its buffers from the arena.
+        device_arena arena(&device);
+        rc = arena.init(device_arena::footprint({A_HEIGHT * A_WIDTH * sizeof(uint32_t),
+                                                 B_HEIGHT * B_WIDTH * sizeof(uint32_t),
+                                                 C_HEIGHT * C_WIDTH * sizeof(uint32_t)}));
+        if (rc != HB_MC_SUCCESS) {
+                bsg_pr_test_err("failed to allocate memory on device.\n");
+                return rc;
+        }
 
-        eva_t A_device, B_device, C_device;
+        // Run the tests. Each test's result is copied back in the same
+        // batch as the next test's inputs.
+        host_transfer_queue transfers(&device);
 
-        // Allocate A on the device
-        rc = hb_mc_device_malloc(&device,
-                                 A_HEIGHT * A_WIDTH * sizeof(uint32_t),
-                                 &A_device);
+        // Run the 32-bit integer test
+        rc = run_test(device, arena, transfers, "kernel_matrix_multiply_int",
+                      A_32.data(), B_32p, C_32.data(),
+                      tg_dim, grid_dim,
+                      A_HEIGHT, A_WIDTH, B_WIDTH, NUM_ITER, 1);
         if (rc != HB_MC_SUCCESS) {
-                bsg_pr_test_err("failed to allocate memory on device.\n");
+                bsg_pr_test_err("int32_t test failed\n");
                 return rc;
         }
 
-        // Allocate B on the device
-        rc = hb_mc_device_malloc(&device,
-                                 B_HEIGHT * B_WIDTH * sizeof(uint32_t),
-                                 &B_device);
+        // Run the 16-bit integer test
+        rc = run_test(device, arena, transfers, "kernel_matrix_multiply_int16",
+                      A_16.data(), B_16p, C_16.data(),
+                      tg_dim, grid_dim,
+                      A_HEIGHT, A_WIDTH, B_WIDTH, NUM_ITER, 2,
+                      scale, shift_16);
         if (rc != HB_MC_SUCCESS) {
-                bsg_pr_test_err("failed to allocate memory on device.\n");
+                bsg_pr_test_err("int16_t test failed\n");
                 return rc;
         }
 
-        // Allocate C on the device
-        rc = hb_mc_device_malloc(&device,
-                                 C_HEIGHT * C_WIDTH * sizeof(uint32_t),
-                                 &C_device);
+        // Run the 8-bit integer test
+        rc = run_test(device, arena, transfers, "kernel_matrix_multiply_int8",
+                      A_8.data(), B_8p, C_8.data(),
+                      tg_dim, grid_dim,
+                      A_HEIGHT, A_WIDTH, B_WIDTH, NUM_ITER, 3,
+                      scale, shift_8);
         if (rc != HB_MC_SUCCESS) {
-                bsg_pr_test_err("failed to allocate memory on device.\n");
+                bsg_pr_test_err("int8_t test failed\n");
+                return rc;
+        }
+
+        // Run the 16-bit and 8-bit integer tests with 32-bit results
+        if (packed) {
+                rc = run_test(device, arena, transfers, "kernel_matrix_multiply_int16_acc32",
+                              A_16.data(), B_16p, C_acc16.data(),
+                              tg_dim, grid_dim,
+                              A_HEIGHT, A_WIDTH, B_WIDTH, NUM_ITER, 5);
+                if (rc != HB_MC_SUCCESS) {
+                        bsg_pr_test_err("int16_t (32-bit result) test failed\n");
+                        return rc;
+                }
+
+                rc = run_test(device, arena, transfers, "kernel_matrix_multiply_int8_acc32",
+                              A_8.data(), B_8p, C_acc8.data(),
+                              tg_dim, grid_dim,
+                              A_HEIGHT, A_WIDTH, B_WIDTH, NUM_ITER, 6);
+                if (rc != HB_MC_SUCCESS) {
+                        bsg_pr_test_err("int8_t (32-bit result) test failed\n");
+                        return rc;
+                }
+        }
+
+        // Run the 32-bit floating-point test
+        rc = run_test(device, arena, transfers, "kernel_matrix_multiply_float",
+                      A_f.data(), B_fp, C_f.data(),
+                      tg_dim, grid_dim,
+                      A_HEIGHT, A_WIDTH, B_WIDTH, NUM_ITER, 4);
+        if (rc != HB_MC_SUCCESS) {
+                bsg_pr_test_err("float test failed\n");
                 return rc;
         }
 
+        // Copy back the last result
+        rc = transfers.flush();
+        if (rc != HB_MC_SUCCESS) {
+                bsg_pr_test_err("failed to copy memory from device.\n");
+                return rc;
+        }
+        transfers.report("Transfers");
+        arena.report("Device arena");
 
-        // Run the 32-bit integer test and check the result
-        rc = run_test(device, "kernel_matrix_multiply_int",
-                      A_32, B_32p, C_32, R_32,
-                      A_device, B_device, C_device,
-                      tg_dim, grid_dim, 1);
+        // Check the results
+        rc = check_test("int32_t", C_32.data(), R_32.data(), C_HEIGHT, C_WIDTH);
         if (rc != HB_MC_SUCCESS) {
                 bsg_pr_test_err("int32_t test failed\n");
                 return rc;
         }
         bsg_pr_test_info("int32_t test passed!\n");
 
-        // Run the 16-bit integer test and check the result
-        rc = run_test(device, "kernel_matrix_multiply_int16",
-                      A_16, B_16p, C_16, R_16,
-                      A_device, B_device, C_device,
-                      tg_dim, grid_dim, 2);
+        rc = check_test("int16_t", C_16.data(), R_16.data(), C_HEIGHT, C_WIDTH);
         if (rc != HB_MC_SUCCESS) {
                 bsg_pr_test_err("int16_t test failed\n");
                 return rc;
         }
         bsg_pr_test_info("int16_t test passed!\n");
 
-        // Run the 8-bit integer test and check the result
-        rc = run_test(device, "kernel_matrix_multiply_int8",
-                      A_8, B_8p, C_8, R_8,
-                      A_device, B_device, C_device,
-                      tg_dim, grid_dim, 3);
+        rc = check_test("int8_t", C_8.data(), R_8.data(), C_HEIGHT, C_WIDTH);
         if (rc != HB_MC_SUCCESS) {
                 bsg_pr_test_err("int8_t test failed\n");
                 return rc;
         }
         bsg_pr_test_info("int8_t test passed!\n");
 
-        // Run the 32-bit floating-point test and check the result
-        rc = run_test(device, "kernel_matrix_multiply_float",
-                      A_f, B_fp, C_f, R_f,
-                      A_device, B_device, C_device,
-                      tg_dim, grid_dim, 4);
+        if (packed) {
+                rc = check_test("int16_t (32-bit result)", C_acc16.data(), R_acc16.data(),
+                                C_HEIGHT, C_WIDTH);
+                if (rc != HB_MC_SUCCESS) {
+                        bsg_pr_test_err("int16_t (32-bit result) test failed\n");
+                        return rc;
+                }
+                bsg_pr_test_info("int16_t (32-bit result) test passed!\n");
+
+                rc = check_test("int8_t (32-bit result)", C_acc8.data(), R_acc8.data(),
+                                C_HEIGHT, C_WIDTH);
+                if (rc != HB_MC_SUCCESS) {
+                        bsg_pr_test_err("int8_t (32-bit result) test failed\n");
+                        return rc;
+                }
+                bsg_pr_test_info("int8_t (32-bit result) test passed!\n");
+        }
+
+        // Each element of C is a sum of A_WIDTH products of magnitude
+        // at most lim.max() squared, which the kernels sum in a
+        // different order than the host (and may contract into FMAs).
+        double mag = (double) A_WIDTH * lim.max() * lim.max();
+        rc = check_test("float", C_f.data(), R_f.data(), C_HEIGHT, C_WIDTH,
+                        host_verify_sum_tolerance<float>(A_WIDTH, mag));
         if (rc != HB_MC_SUCCESS) {
                 bsg_pr_test_err("float test failed\n");
                 return rc;
@@ -30,12 +30,18 @@
 
 #include <cstring>
 #include <cstdlib>
-#include <random>
 #include <limits>
 #include <iostream>
 #include <typeinfo>
 #include <bsg_manycore_errno.h>
 #include <bsg_manycore_cuda.h>
 #include "../common.h"
+#include "../host_buffer.hpp"
+#include "../host_transfer.hpp"
+#include "../device_arena.hpp"
+#include "../host_verify.hpp"
+#include "../host_random.hpp"
+#include "../host_dataset.hpp"
+#include "../host_gemm.hpp"
 
 #endif
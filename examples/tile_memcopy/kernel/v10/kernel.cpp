@@ -32,21 +32,34 @@ void *__bsg_memcpy(void *dest,
                    const void *src,
                    const size_t n){
                  
+#ifdef __riscv
         const float *psrc  asm ("x10") = reinterpret_cast<const float *>(src);
-        uint32_t src_nelements = n / sizeof(psrc[0]);
         float *pdest asm ("x12") = reinterpret_cast<float *>(dest);
+#else
+        const float *psrc = reinterpret_cast<const float *>(src);
+        float *pdest = reinterpret_cast<float *>(dest);
+#endif
+        uint32_t src_nelements = n / sizeof(psrc[0]);
 
         for(int j = 0; j < src_nelements; j+= FACTOR){
                 float rtemp[FACTOR];
 #pragma GCC unroll 32
                 for(int f = 0; f < FACTOR; f++){
+#ifdef __riscv
                         asm volatile ("flw %0,%1" : "=f" (rtemp[f]) : "m" (psrc[f]));
+#else
+                        rtemp[f] = psrc[f];
+#endif
                 }
 
                 // Write
 #pragma GCC unroll 32
                 for(int f = 0; f < FACTOR; f++){
+#ifdef __riscv
                         asm volatile ("fsw %1,%0" : "=m" (pdest[f]) : "f" (rtemp[f]));
+#else
+                        pdest[f] = rtemp[f];
+#endif
                 }
                 psrc += FACTOR;
                 pdest += FACTOR;
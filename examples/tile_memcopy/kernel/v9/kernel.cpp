@@ -101,20 +101,33 @@ void bsg_memcopy(const int *src,
                  const uint32_t i_nelements,
                  int *dest){
 
+#ifdef __riscv
         const float *psrc  asm ("x10") = reinterpret_cast<const float *>(&src[0]);
         float *pdest asm ("x12") = reinterpret_cast<float *>(&dest[0]);
+#else
+        const float *psrc = reinterpret_cast<const float *>(&src[0]);
+        float *pdest = reinterpret_cast<float *>(&dest[0]);
+#endif
 
         for(int j = 0; j < i_nelements; j+= FACTOR){
                 float rtemp[FACTOR];
 #pragma GCC unroll 32
                 for(int f = 0; f < FACTOR; f++){
+#ifdef __riscv
                         asm volatile ("flw %0,%1" : "=f" (rtemp[f]) : "m" (psrc[f]));
+#else
+                        rtemp[f] = psrc[f];
+#endif
                 }
 
                 // Write
 #pragma GCC unroll 32
                 for(int f = 0; f < FACTOR; f++){
+#ifdef __riscv
                         asm volatile ("fsw %1,%0" : "=m" (pdest[f]) : "f" (rtemp[f]));
+#else
+                        pdest[f] = rtemp[f];
+#endif
                 }
                 psrc += FACTOR;
                 pdest += FACTOR;
@@ -28,7 +28,8 @@
 #include "tile_memcopy.hpp"
 #include <iostream>
 
-#define C_LENGTH 256
+// Default vector length (--size)
+#define DEFAULT_C_LENGTH 256
 
 // Print matrix A (M x N). This works well for small matricies.
 template <typename T>
@@ -43,30 +44,16 @@ void matrix_print(T *A, uint64_t M, uint64_t N) {
         }
 }
 
-// Compute the sum of squared error between matricies A and B (M x N)
-template <typename T>
-double matrix_sse (const T *A, const T *B, uint64_t M, uint64_t N) {
-        double sum = 0;
-        for (uint64_t y = 0; y < M; y ++) {
-                for (uint64_t x = 0; x < N; x ++) {
-                        T diff = A[y * N + x] - B[y * N + x];
-                        if(std::isnan(diff)){
-                                return diff;
-                        }
-                        sum += diff * diff;
-                }
-        }
-        return sum;
-}
-
 int kernel_memcopy(int argc, char **argv)
 {       
         bsg_pr_test_info("Running CUDA Memcopy Kernel on a 1x1 tile group.\n\n");
         char *elf, *test_name;
-        struct arguments_path args = { NULL, NULL };
-        argp_parse(&argp_path, argc, argv, 0, 0, &args);
-        elf = args.path;
-        test_name = args.name;
+        struct arguments_size args = {{NULL, NULL}};
+        args.size = DEFAULT_C_LENGTH;
+        args.seed = 42;
+        argp_parse(&argp_size, argc, argv, 0, 0, &args);
+        elf = args.path.path;
+        test_name = args.path.name;
 
         int rc;
         hb_mc_device_t manycore, *mc = &manycore;
@@ -84,43 +71,63 @@ int kernel_memcopy(int argc, char **argv)
                 return rc;
         }
 
-        // Initialize the random number generators
+        // Initialize the random number generator
         std::numeric_limits<int32_t> lim_int32; // Used to get INT_MIN and INT_MAX in C++
-        std::default_random_engine generator;
-        generator.seed(42);
-        std::uniform_int_distribution<int> data_distribution(lim_int32.min(),lim_int32.max());
+        host_random data_random(args.seed);
 
         // N: Number of elements in the 1-D input vector
-        uint32_t N = C_LENGTH;
-        
-        int A[N];
-        int B[N], B_result[N];
+        uint32_t N = args.size;
+
+        // The unrolled kernels (v4 - v10) copy F words per loop
+        // iteration, so N must be a multiple of F.
+        const char *versions[] = {"v4", "v5", "v6", "v7", "v8", "v9", "v10"};
+        const uint32_t unroll[] = {4, 8, 16, 16, 32, 32, 32};
+        for (int i = 0; i < 7; ++i) {
+                if (!strcmp(versions[i], test_name) && (N % unroll[i])) {
+                        bsg_pr_test_err("%s requires N to be a multiple of %u.\n",
+                                        test_name, unroll[i]);
+                        return HB_MC_INVALID;
+                }
+        }
+
+        host_buffer<int> A(N);
+        host_buffer<int> B(N), B_result(N);
+
+        // Reserve device memory for A and B, and allocate them from it
+        device_arena arena(mc);
+        rc = arena.init(device_arena::footprint({A.size_bytes(),
+                                                 B.size_bytes()}));
+        if(rc != HB_MC_SUCCESS)
+        {
+                bsg_pr_test_err("Failed to reserve device memory.\n");
+                return rc;
+        }
 
         eva_t A_device, B_device;
-        rc = hb_mc_device_malloc(mc, sizeof(A), &A_device);
+        rc = arena.alloc(A.size_bytes(), &A_device);
         if(rc != HB_MC_SUCCESS)
         {
                 bsg_pr_test_err("Failed to allocate A on the manycore.\n");
                 return rc;
         }
         
-        rc = hb_mc_device_malloc(mc, sizeof(B), &B_device);
+        rc = arena.alloc(B.size_bytes(), &B_device);
         if(rc != HB_MC_SUCCESS)
         {
                 bsg_pr_test_err("Failed to allocate B on the manycore.\n");
                 return rc;
         }
 
-        for(int i = 0; i < sizeof(A) / sizeof(A[0]); i++)
+        data_random.uniform(A.data(), A.size(), lim_int32.min(), lim_int32.max());
+        for(int i = 0; i < A.size(); i++)
         {
-                A[i] = data_distribution(generator);
                 B[i] = A[i] + 1;
         }
         
         rc = hb_mc_device_memcpy(mc,
                                  (void *) ((intptr_t) A_device),
                                  (void *) &A[0],
-                                 sizeof(A), HB_MC_MEMCPY_TO_DEVICE);
+                                 A.size_bytes(), HB_MC_MEMCPY_TO_DEVICE);
         if(rc != HB_MC_SUCCESS)
         {
                 bsg_pr_test_err("Failed to copy A to the manycore.\n");
@@ -147,9 +154,9 @@ int kernel_memcopy(int argc, char **argv)
                 return rc;
         }
 
-        rc = hb_mc_device_memcpy(mc, (void *) B_result,
+        rc = hb_mc_device_memcpy(mc, (void *) B_result.data(),
                                  (void *) ((intptr_t) B_device),
-                                 sizeof(B), HB_MC_MEMCPY_TO_HOST);
+                                 B.size_bytes(), HB_MC_MEMCPY_TO_HOST);
         if(rc != HB_MC_SUCCESS)
         {
                 bsg_pr_test_err("Failed to copy result to host.\n");
@@ -163,16 +170,7 @@ int kernel_memcopy(int argc, char **argv)
                 return rc;
         }
 
-        float sse;
-        sse = matrix_sse(B, B_result, 1, N);
-
-        if(std::isnan(sse) || sse > .01)
-        {
-                bsg_pr_test_err(BSG_RED("Result mismatch! SSE: %f\n"), sse);
-                return HB_MC_FAIL;
-        }
-        bsg_pr_test_info(BSG_GREEN("Result match! (SSE: %f)\n"), sse);
-        return HB_MC_SUCCESS;
+        return verify_result("B", B.data(), B_result.data(), 1, N);
 }
 
 #ifdef COSIM
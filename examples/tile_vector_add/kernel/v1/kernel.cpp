@@ -17,7 +17,7 @@
 #include <bsg_tile_group_barrier.h>
 
 #include <vector_add.hpp>
-#include <cstring>
+#include <bsg_memcpy.hpp>
 
 extern int bsg_printf(const char*, ...);
 
@@ -37,14 +37,14 @@ extern "C" {
 
                 float A_local[nels], B_local[nels], C_local[nels];
 
-                memcpy (A_local, A, sizeof(A[0])*nels);
-                memcpy (B_local, B, sizeof(B[0])*nels);
+                bsg_memcpy_dram_to_dmem (A_local, A, sizeof(A[0])*nels);
+                bsg_memcpy_dram_to_dmem (B_local, B, sizeof(B[0])*nels);
 
                 bsg_cuda_print_stat_start(tag);
                 rc = kernel_tile_vector_add(A_local, B_local, C_local, nels);
                 bsg_cuda_print_stat_end(tag);
 
-                memcpy (C, C_local, sizeof(C[0])*nels);
+                bsg_memcpy_dmem_to_dram (C, C_local, sizeof(C[0])*nels);
                 bsg_cuda_print_stat_kernel_end();
 
                 return rc;
@@ -17,7 +17,7 @@
 #include <bsg_tile_group_barrier.h>
 
 #include <vector_add.hpp>
-#include <cstring>
+#include <bsg_memcpy.hpp>
 
 extern int bsg_printf(const char*, ...);
 
@@ -36,8 +36,8 @@ extern "C" {
                 int rc, temp = 0;
                 float A_local[nels], B_local[nels], C_local[nels];
 
-                memcpy (A_local, A, sizeof(A[0])*nels);
-                memcpy (B_local, B, sizeof(B[0])*nels);
+                bsg_memcpy_dram_to_dmem (A_local, A, sizeof(A[0])*nels);
+                bsg_memcpy_dram_to_dmem (B_local, B, sizeof(B[0])*nels);
 
                 for(int i = 0 ; i < 2; ++i){
                         bsg_cuda_print_stat_start(temp);
@@ -46,7 +46,7 @@ extern "C" {
                         temp = tag;
                 }
 
-                memcpy (C, C_local, sizeof(C[0])*nels);
+                bsg_memcpy_dmem_to_dram (C, C_local, sizeof(C[0])*nels);
                 bsg_cuda_print_stat_kernel_end();
 
                 return rc;
@@ -27,18 +27,17 @@
 
 // Vector-Vector Addition (A + B = C).
 
-// A,B, and C's sizes are WIDTH.
+// A,B, and C's sizes are A_WIDTH (--size, default DEFAULT_WIDTH).
 // Each time the kernel is called, it is run for (NUM_ITER + 1)
 // iterations and the first iteration is discarded.
 // 
-// NOTE: 3 * WIDTH <= 4KB, the size of DMEM on the tile.
+// NOTE: Versions 1 - 3 copy A, B and C into DMEM, so 3 * 4 * WIDTH
+// bytes must fit in BSG_TILE_DMEM_DATA_BYTES.
 
 #include "vector_add.hpp"
 
-// Matrix sizes:
-#define A_WIDTH  128
-#define B_WIDTH  A_WIDTH
-#define C_WIDTH  A_WIDTH
+// Default vector size:
+#define DEFAULT_WIDTH  128
 #define NUM_ITER 1
 #define FLOAT_TAG 1
 
@@ -51,20 +50,6 @@ void vector_add (TA *A, TB *B, TC *C, uint64_t N) {
         return;
 }
 
-// Compute the sum of squared error between vectors A and B (M x N)
-template <typename T>
-double vector_sse (const T *A, const T *B, uint64_t N) {
-        double sum = 0;
-        for (uint64_t x = 0; x < N; x ++) {
-                T diff = A[x] - B[x];
-                if(std::isnan(diff)){
-                        return diff;
-                }
-                sum += diff * diff;
-        }
-        return sum;
-}
-
 // Run a Vector Addition test on the Manycore, and compare the result.
 // A and B are the input vectors, C is the destination, and gold is
 // the known-good result computed by the host.
@@ -77,7 +62,9 @@ int run_test(hb_mc_device_t &device, const char* kernel,
              const hb_mc_dimension_t &tg_dim,
              const hb_mc_dimension_t &grid_dim,
              const hb_mc_dimension_t block_size,
+             const uint32_t A_WIDTH,
              const unsigned int tag){
+        const uint32_t B_WIDTH = A_WIDTH, C_WIDTH = A_WIDTH;
         int rc;
 
         // Copy A & B from host onto device DRAM.
@@ -140,25 +127,30 @@ int run_test(hb_mc_device_t &device, const char* kernel,
         }
 
         // Compare the known-correct vector (gold) and the result vector (C)
-        float max = 0.1;
-        double sse = vector_sse(gold, C, C_WIDTH);
-
-        if (sse > max) {
-                bsg_pr_test_err(BSG_RED("Vector Mismatch. SSE: %f\n"), sse);
-                return HB_MC_FAIL;
-        }
-        bsg_pr_test_info(BSG_GREEN("Vector Match.\n"));
+        return verify_result("C", gold, C, 1, C_WIDTH);
 }
 
 // Run a series of Vector Addition tests on the Manycore device
 int kernel_vector_add (int argc, char **argv) {
         int rc;
         char *bin_path, *test_name;
-        struct arguments_path args = {NULL, NULL};
-
-        argp_parse (&argp_path, argc, argv, 0, 0, &args);
-        bin_path = args.path;
-        test_name = args.name;
+        struct arguments_size args = {{NULL, NULL}};
+        args.size = DEFAULT_WIDTH;
+        args.seed = 42;
+
+        argp_parse (&argp_size, argc, argv, 0, 0, &args);
+        bin_path = args.path.path;
+        test_name = args.path.name;
+        const uint32_t A_WIDTH = args.size, B_WIDTH = A_WIDTH, C_WIDTH = A_WIDTH;
+
+        // Versions 1 - 3 copy A, B and C into DMEM
+        const uint64_t staged_bytes = 3 * sizeof(float) * (uint64_t) A_WIDTH;
+        if (strcmp("v0", test_name) && staged_bytes > BSG_TILE_DMEM_DATA_BYTES) {
+                bsg_pr_test_err("%s copies A, B and C into DMEM: %llu bytes do not "
+                                "fit in %u.\n", test_name,
+                                (unsigned long long) staged_bytes, BSG_TILE_DMEM_DATA_BYTES);
+                return HB_MC_INVALID;
+        }
 
         bsg_pr_test_info("Running CUDA Single-tile Vector Addition.\n");
 
@@ -174,44 +166,23 @@ int kernel_vector_add (int argc, char **argv) {
         grid_dim = { .x = 1, .y = 1};
 
 
-        // Initialize the random number generators
+        // Initialize the random number generators (one stream per input)
         std::numeric_limits<int8_t> lim; // Used to get INT_MIN and INT_MAX in C++
-        std::default_random_engine generator;
-        generator.seed(42);
-        std::uniform_real_distribution<float> distribution(lim.min(),lim.max());
+        host_random A_random(args.seed, 0), B_random(args.seed, 1);
 
         // Allocate A, B, C and R (result) on the host for each datatype.
-        float A[A_WIDTH];
-        float B[B_WIDTH];
-        float C[C_WIDTH];
-        float R[C_WIDTH];
+        host_buffer<float> A(A_WIDTH);
+        host_buffer<float> B(B_WIDTH);
+        host_buffer<float> C(C_WIDTH);
+        host_buffer<float> R(C_WIDTH);
         
         // Generate random numbers. Since the Manycore can't handle infinities,
-        // subnormal numbers, or NANs, filter those out.
-        auto res = distribution(generator);
-
-        for (uint64_t i = 0; i < A_WIDTH; i++) {
-                do{
-                        res = distribution(generator);
-                }while(!std::isnormal(res) ||
-                       !std::isfinite(res) ||
-                       std::isnan(res));
-
-                A[i] = static_cast<float>(res);
-        }
-
-        for (uint64_t i = 0; i < B_WIDTH; i++) {
-                do{
-                        res = distribution(generator);
-                }while(!std::isnormal(res) ||
-                       !std::isfinite(res) ||
-                       std::isnan(res));
-
-                B[i] = static_cast<float>(res);
-        }
+        // subnormal numbers, or NANs, host_random filters those out.
+        A_random.uniform(A.data(), A.size(), (float) lim.min(), (float) lim.max());
+        B_random.uniform(B.data(), B.size(), (float) lim.min(), (float) lim.max());
 
         // Generate the known-correct results on the host
-        vector_add (A, B, R, A_WIDTH);
+        vector_add (A.data(), B.data(), R.data(), A_WIDTH);
 
         // Initialize device, load binary and unfreeze tiles.
         hb_mc_device_t device;
@@ -228,31 +199,35 @@ int kernel_vector_add (int argc, char **argv) {
                 return rc;
         }
 
+        // Reserve device memory for A, B and C, and allocate them from it
+        device_arena arena(&device);
+        rc = arena.init(device_arena::footprint({A_WIDTH * sizeof(float),
+                                                 B_WIDTH * sizeof(float),
+                                                 C_WIDTH * sizeof(float)}));
+        if (rc != HB_MC_SUCCESS) {
+                bsg_pr_test_err("failed to reserve device memory.\n");
+                return rc;
+        }
+
         // Allocate memory on the device for A, B and C.
         eva_t A_device, B_device, C_device;
 
         // Allocate A on the device
-        rc = hb_mc_device_malloc(&device,
-                                 A_WIDTH * sizeof(float),
-                                 &A_device);
+        rc = arena.alloc(A_WIDTH * sizeof(float), &A_device);
         if (rc != HB_MC_SUCCESS) {
                 bsg_pr_test_err("failed to allocate memory on device.\n");
                 return rc;
         }
 
         // Allocate B on the device
-        rc = hb_mc_device_malloc(&device,
-                                 B_WIDTH * sizeof(float),
-                                 &B_device);
+        rc = arena.alloc(B_WIDTH * sizeof(float), &B_device);
         if (rc != HB_MC_SUCCESS) {
                 bsg_pr_test_err("failed to allocate memory on device.\n");
                 return rc;
         }
 
         // Allocate C on the device
-        rc = hb_mc_device_malloc(&device,
-                                 C_WIDTH * sizeof(float),
-                                 &C_device);
+        rc = arena.alloc(C_WIDTH * sizeof(float), &C_device);
         if (rc != HB_MC_SUCCESS) {
                 bsg_pr_test_err("failed to allocate memory on device.\n");
                 return rc;
@@ -260,9 +235,9 @@ int kernel_vector_add (int argc, char **argv) {
 
         // Run the 32-bit floating-point test and check the result
         rc = run_test(device, "kernel_vector_add_float",
-                      A, B, C, R,
+                      A.data(), B.data(), C.data(), R.data(),
                       A_device, B_device, C_device,
-                      tg_dim, grid_dim, block_size, FLOAT_TAG);
+                      tg_dim, grid_dim, block_size, A_WIDTH, FLOAT_TAG);
         if (rc != HB_MC_SUCCESS) {
                 bsg_pr_test_err("float test failed\n");
                 return rc;
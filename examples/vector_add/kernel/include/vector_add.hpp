@@ -88,6 +88,10 @@ int __attribute__ ((noinline)) kernel_vector_add_1D_grid_2D_tile_groups(TA *A, T
         // first we calculate the porition of each specific tile group
         uint32_t start = __bsg_tile_group_id_x * block_size_x;
         uint32_t end = start + block_size_x;
+
+        // The last tile group may have less than block_size_x elements
+        if (end > WIDTH)
+                end = WIDTH;
         
 
         // A tile group's share (block_size_x) is divided among tiles in the tile group
@@ -27,17 +27,18 @@
 
 // Vector-Vector Addition (A + B = C).
 
-// A,B, and C's sizes are WIDTH.
+// A,B, and C's sizes are WIDTH (--size, default DEFAULT_WIDTH).
 // Each time the kernel is called, it is run for (NUM_ITER + 1)
-// iterations and the first iteration is discarded.
+// iterations and the first iteration is discarded (--iters, default
+// DEFAULT_NUM_ITER).
 // 
 // NOTE: 3 * WIDTH <= 4KB, the size of DMEM on the tile.
 
 #include "vector_add.hpp"
 
-// Matrix sizes:
-#define WIDTH  64
-#define NUM_ITER 1
+// Default vector size and iterations:
+#define DEFAULT_WIDTH  64
+#define DEFAULT_NUM_ITER 1
 
 // Host Vector Addition code (to compare results)
 template <typename TA, typename TB, typename TC>
@@ -49,53 +50,43 @@ void vector_add (TA *A, TB *B, TC *C, uint64_t N) {
 }
 
 
-// Compute the sum of squared error between vectors A and B (M x N)
-template <typename T>
-double vector_sse (const T *A, const T *B, uint64_t N) {
-        double sum = 0;
-        for (uint64_t x = 0; x < N; x ++) {
-                T diff = A[x] - B[x];
-                if(std::isnan(diff)){
-                        return diff;
-                }
-                sum += diff * diff;
-        }
-        return sum;
-}
 
-
-// Run a Vector Addition test on the Manycore, and compare the result.  A
-// and B are the input vectors, C is the destination, and gold is the
-// known-good result computed by the host.
+// Run a Vector Addition test on the Manycore. A and B are the input
+// vectors and C is the destination. The copies of A and B are batched
+// with the copy-back of the previous test in transfers, and the
+// copy-back of C is left queued in transfers: C is not valid until
+// transfers is next flushed.
 template<typename TA, typename TB, typename TC>
-int run_test(hb_mc_device_t &device, const char* kernel,
-             const TA *A, const TB *B, TC *C, const TC *gold,
-             const eva_t &A_device,
-             const eva_t &B_device,
-             const eva_t &C_device,
+int run_test(hb_mc_device_t &device, device_arena &arena,
+             host_transfer_queue &transfers,
+             const char* kernel,
+             const TA *A, const TB *B, TC *C,
              const hb_mc_dimension_t &tg_dim,
              const hb_mc_dimension_t &grid_dim,
              const hb_mc_dimension_t block_size,
+             const uint32_t WIDTH, const uint32_t NUM_ITER,
              const unsigned int tag){
         int rc;
 
-        // Copy A & B from host onto device DRAM.
-        void *dst = (void *) ((intptr_t) A_device);
-        void *src = (void *) &A[0];
-        rc = hb_mc_device_memcpy (&device, dst, src,
-                                  (WIDTH) * sizeof(TA),
-                                  HB_MC_MEMCPY_TO_DEVICE);
+        // Allocate A, B and C on the device, sized for this test's data
+        // types. The previous test's buffers are released first: its
+        // pending copy-back is performed before this test's uploads.
+        arena.reset();
+        eva_t A_device, B_device, C_device;
+        rc = arena.alloc(WIDTH * sizeof(TA), &A_device);
+        if (rc == HB_MC_SUCCESS)
+                rc = arena.alloc(WIDTH * sizeof(TB), &B_device);
+        if (rc == HB_MC_SUCCESS)
+                rc = arena.alloc(WIDTH * sizeof(TC), &C_device);
         if (rc != HB_MC_SUCCESS) {
-                bsg_pr_test_err("failed to copy memory to device.\n");
+                bsg_pr_test_err("failed to allocate memory on device.\n");
                 return rc;
         }
 
-
-        dst = (void *) ((intptr_t) B_device);
-        src = (void *) &B[0];
-        rc = hb_mc_device_memcpy (&device, dst, src,
-                                  WIDTH * sizeof(TB),
-                                  HB_MC_MEMCPY_TO_DEVICE);
+        // Copy A & B from host onto device DRAM.
+        transfers.to_device(A_device, A, WIDTH * sizeof(TA));
+        transfers.to_device(B_device, B, WIDTH * sizeof(TB));
+        rc = transfers.flush();
         if (rc != HB_MC_SUCCESS) {
                 bsg_pr_test_err("failed to copy memory to device.\n");
                 return rc;
@@ -127,37 +118,33 @@ int run_test(hb_mc_device_t &device, const char* kernel,
         }
 
 
-        // Copy result vector back from device DRAM into host memory.
-        src = (void *) ((intptr_t) C_device);
-        dst = (void *) &C[0];
-        rc = hb_mc_device_memcpy (&device, (void *) dst, src,
-                                  WIDTH * sizeof(TC),
-                                  HB_MC_MEMCPY_TO_HOST);
-        if (rc != HB_MC_SUCCESS) {
-                bsg_pr_test_err("failed to copy memory from device.\n");
-                return rc;
-        }
-
-        // Compare the known-correct vector (gold) and the result vector (C)
-        float max = 0.1;
-        double sse = vector_sse(gold, C, WIDTH);
+        // Queue the copy of the result vector back from device DRAM
+        // into host memory.
+        transfers.to_host(C, C_device, WIDTH * sizeof(TC));
+        return HB_MC_SUCCESS;
+}
 
-        if (sse > max) {
-                bsg_pr_test_err(BSG_RED("Vector Mismatch. SSE: %f\n"), sse);
-                return HB_MC_FAIL;
-        }
-        bsg_pr_test_info(BSG_GREEN("Vector Match.\n"));
+// Compare the known-correct vector (gold) and the result vector (C)
+template<typename TC>
+int check_test(const char *name, const TC *C, const TC *gold,
+               const uint32_t WIDTH){
+        return verify_result(name, gold, C, 1, WIDTH);
 }
 
 // Run a series of Vector Addition tests on the Manycore device
 int kernel_vector_add (int argc, char **argv) {
         int rc;
         char *bin_path, *test_name;
-        struct arguments_path args = {NULL, NULL};
+        struct arguments_size args = {{NULL, NULL}};
+        args.size = DEFAULT_WIDTH;
+        args.iters = DEFAULT_NUM_ITER;
+        args.seed = 42;
 
-        argp_parse (&argp_path, argc, argv, 0, 0, &args);
-        bin_path = args.path;
-        test_name = args.name;
+        argp_parse (&argp_size, argc, argv, 0, 0, &args);
+        bin_path = args.path.path;
+        test_name = args.path.name;
+        const uint32_t WIDTH = args.size;
+        const uint32_t NUM_ITER = args.iters;
 
         bsg_pr_test_info("Running CUDA Vector Addition.\n");
 
@@ -181,7 +168,7 @@ int kernel_vector_add (int argc, char **argv) {
         } else if (!strcmp("v3", test_name)){
                 tg_dim = { .x = 2, .y = 2 };
                 block_size = {.x = 4, .y = 1};
-                grid_dim = {.x = WIDTH / block_size.x, .y = 1};
+                grid_dim = {.x = (WIDTH + block_size.x - 1) / block_size.x, .y = 1};
         } else {
                 bsg_pr_test_err("Invalid version provided!.\n");
                 return HB_MC_INVALID;
@@ -190,69 +177,53 @@ int kernel_vector_add (int argc, char **argv) {
 
 
 
-        // Initialize the random number generators
+        // Initialize the random number generators (one stream per input)
         std::numeric_limits<int8_t> lim; // Used to get INT_MIN and INT_MAX in C++
-        std::default_random_engine generator;
-        generator.seed(42);
-        std::uniform_real_distribution<float> distribution(lim.min(),lim.max());
+        host_random A_random(args.seed, 0), B_random(args.seed, 1);
 
         // Allocate A, B, C and R (result) on the host for each datatype.
-        int32_t A_32[WIDTH];
-        int32_t B_32[WIDTH];
-        int32_t C_32[WIDTH];
-        int32_t R_32[WIDTH];
-
-        int16_t A_16[WIDTH];
-        int16_t B_16[WIDTH];
-        int16_t C_16[WIDTH];
-        int16_t R_16[WIDTH];
-
-        int8_t A_8[WIDTH];
-        int8_t B_8[WIDTH];
-        int8_t C_8[WIDTH];
-        int8_t R_8[WIDTH];
-
-        float A_f[WIDTH];
-        float B_f[WIDTH];
-        float C_f[WIDTH];
-        float R_f[WIDTH];
+        host_buffer<int32_t> A_32(WIDTH);
+        host_buffer<int32_t> B_32(WIDTH);
+        host_buffer<int32_t> C_32(WIDTH);
+        host_buffer<int32_t> R_32(WIDTH);
+
+        host_buffer<int16_t> A_16(WIDTH);
+        host_buffer<int16_t> B_16(WIDTH);
+        host_buffer<int16_t> C_16(WIDTH);
+        host_buffer<int16_t> R_16(WIDTH);
+
+        host_buffer<int8_t> A_8(WIDTH);
+        host_buffer<int8_t> B_8(WIDTH);
+        host_buffer<int8_t> C_8(WIDTH);
+        host_buffer<int8_t> R_8(WIDTH);
+
+        host_buffer<float> A_f(WIDTH);
+        host_buffer<float> B_f(WIDTH);
+        host_buffer<float> C_f(WIDTH);
+        host_buffer<float> R_f(WIDTH);
 
         
         // Generate random numbers. Since the Manycore can't handle infinities,
-        // subnormal numbers, or NANs, filter those out.
-        auto res = distribution(generator);
+        // subnormal numbers, or NANs, host_random filters those out. The
+        // integer inputs are the floating-point inputs, truncated.
+        A_random.uniform(A_f.data(), WIDTH, (float) lim.min(), (float) lim.max());
+        B_random.uniform(B_f.data(), WIDTH, (float) lim.min(), (float) lim.max());
 
         for (uint64_t i = 0; i < WIDTH; i++) {
-                do{
-                        res = distribution(generator);
-                }while(!std::isnormal(res) ||
-                       !std::isfinite(res) ||
-                       std::isnan(res));
-
-                A_32[i] = static_cast<int32_t>(res);
-                A_16[i] = static_cast<int16_t>(res);
-                A_8[i] = static_cast<int8_t>(res);
-                A_f[i] = static_cast<float>(res);
-        }
+                A_32[i] = static_cast<int32_t>(A_f[i]);
+                A_16[i] = static_cast<int16_t>(A_f[i]);
+                A_8[i] = static_cast<int8_t>(A_f[i]);
 
-        for (uint64_t i = 0; i < WIDTH; i++) {
-                do{
-                        res = distribution(generator);
-                }while(!std::isnormal(res) ||
-                       !std::isfinite(res) ||
-                       std::isnan(res));
-
-                B_32[i] = static_cast<int32_t>(res);
-                B_16[i] = static_cast<int16_t>(res);
-                B_8[i] = static_cast<int8_t>(res);
-                B_f[i] = static_cast<float>(res);
+                B_32[i] = static_cast<int32_t>(B_f[i]);
+                B_16[i] = static_cast<int16_t>(B_f[i]);
+                B_8[i] = static_cast<int8_t>(B_f[i]);
         }
 
         // Generate the known-correct results on the host
-        vector_add (A_32, B_32, R_32, WIDTH);
-        vector_add (A_16, B_16, R_16, WIDTH);
-        vector_add (A_8, B_8, R_8, WIDTH);
-        vector_add (A_f, B_f, R_f, WIDTH);
+        vector_add (A_32.data(), B_32.data(), R_32.data(), WIDTH);
+        vector_add (A_16.data(), B_16.data(), R_16.data(), WIDTH);
+        vector_add (A_8.data(), B_8.data(), R_8.data(), WIDTH);
+        vector_add (A_f.data(), B_f.data(), R_f.data(), WIDTH);
 
 
         // Initialize device, load binary and unfreeze tiles.
@@ -271,78 +242,89 @@ int kernel_vector_add (int argc, char **argv) {
                 return rc;
         }
 
-        // Allocate memory on the device for A, B and C. Since sizeof(float) ==
-        // sizeof(int32_t) > sizeof(int16_t) > sizeof(int8_t) we'll reuse the
-        // same buffers for each test
+        // Reserve device memory for the largest test (32-bit A, B and
+        // C). Each test allocates its buffers from the arena.
+        device_arena arena(&device);
+        rc = arena.init(device_arena::footprint({WIDTH * sizeof(uint32_t),
+                                                 WIDTH * sizeof(uint32_t),
+                                                 WIDTH * sizeof(uint32_t)}));
+        if (rc != HB_MC_SUCCESS) {
+                bsg_pr_test_err("failed to allocate memory on device.\n");
+                return rc;
+        }
 
-        eva_t A_device, B_device, C_device;
+        // Run the tests. Each test's result is copied back in the same
+        // batch as the next test's inputs.
+        host_transfer_queue transfers(&device);
 
-        // Allocate A on the device
-        rc = hb_mc_device_malloc(&device,
-                                 WIDTH * sizeof(uint32_t),
-                                 &A_device);
+        // Run the 32-bit integer test
+        rc = run_test(device, arena, transfers, "kernel_vector_add_int",
+                      A_32.data(), B_32.data(), C_32.data(),
+                      tg_dim, grid_dim, block_size, WIDTH, NUM_ITER, 1);
         if (rc != HB_MC_SUCCESS) {
-                bsg_pr_test_err("failed to allocate memory on device.\n");
+                bsg_pr_test_err("int32_t test failed\n");
                 return rc;
         }
 
-        // Allocate B on the device
-        rc = hb_mc_device_malloc(&device,
-                                 WIDTH * sizeof(uint32_t),
-                                 &B_device);
+        // Run the 16-bit integer test
+        rc = run_test(device, arena, transfers, "kernel_vector_add_int16",
+                      A_16.data(), B_16.data(), C_16.data(),
+                      tg_dim, grid_dim, block_size, WIDTH, NUM_ITER, 2);
         if (rc != HB_MC_SUCCESS) {
-                bsg_pr_test_err("failed to allocate memory on device.\n");
+                bsg_pr_test_err("int16_t test failed\n");
                 return rc;
         }
 
-        // Allocate C on the device
-        rc = hb_mc_device_malloc(&device,
-                                 WIDTH * sizeof(uint32_t),
-                                 &C_device);
+        // Run the 8-bit integer test
+        rc = run_test(device, arena, transfers, "kernel_vector_add_int8",
+                      A_8.data(), B_8.data(), C_8.data(),
+                      tg_dim, grid_dim, block_size, WIDTH, NUM_ITER, 3);
         if (rc != HB_MC_SUCCESS) {
-                bsg_pr_test_err("failed to allocate memory on device.\n");
+                bsg_pr_test_err("int8_t test failed\n");
+                return rc;
+        }
+
+        // Run the 32-bit floating-point test
+        rc = run_test(device, arena, transfers, "kernel_vector_add_float",
+                      A_f.data(), B_f.data(), C_f.data(),
+                      tg_dim, grid_dim, block_size, WIDTH, NUM_ITER, 4);
+        if (rc != HB_MC_SUCCESS) {
+                bsg_pr_test_err("float test failed\n");
                 return rc;
         }
 
+        // Copy back the last result
+        rc = transfers.flush();
+        if (rc != HB_MC_SUCCESS) {
+                bsg_pr_test_err("failed to copy memory from device.\n");
+                return rc;
+        }
+        transfers.report("Transfers");
+        arena.report("Device arena");
 
-        // Run the 32-bit integer test and check the result
-        rc = run_test(device, "kernel_vector_add_int",
-                      A_32, B_32, C_32, R_32,
-                      A_device, B_device, C_device,
-                      tg_dim, grid_dim, block_size, 1);
+        // Check the results
+        rc = check_test("int32_t", C_32.data(), R_32.data(), WIDTH);
         if (rc != HB_MC_SUCCESS) {
                 bsg_pr_test_err("int32_t test failed\n");
                 return rc;
         }
         bsg_pr_test_info("int32_t test passed!\n");
 
-        // Run the 16-bit integer test and check the result
-        rc = run_test(device, "kernel_vector_add_int16",
-                      A_16, B_16, C_16, R_16,
-                      A_device, B_device, C_device,
-                      tg_dim, grid_dim, block_size, 2);
+        rc = check_test("int16_t", C_16.data(), R_16.data(), WIDTH);
         if (rc != HB_MC_SUCCESS) {
                 bsg_pr_test_err("int16_t test failed\n");
                 return rc;
         }
         bsg_pr_test_info("int16_t test passed!\n");
 
-        // Run the 8-bit integer test and check the result
-        rc = run_test(device, "kernel_vector_add_int8",
-                      A_8, B_8, C_8, R_8,
-                      A_device, B_device, C_device,
-                      tg_dim, grid_dim, block_size, 3);
+        rc = check_test("int8_t", C_8.data(), R_8.data(), WIDTH);
         if (rc != HB_MC_SUCCESS) {
                 bsg_pr_test_err("int8_t test failed\n");
                 return rc;
         }
         bsg_pr_test_info("int8_t test passed!\n");
 
-        // Run the 32-bit floating-point test and check the result
-        rc = run_test(device, "kernel_vector_add_float",
-                      A_f, B_f, C_f, R_f,
-                      A_device, B_device, C_device,
-                      tg_dim, grid_dim, block_size, 4);
+        rc = check_test("float", C_f.data(), R_f.data(), WIDTH);
         if (rc != HB_MC_SUCCESS) {
                 bsg_pr_test_err("float test failed\n");
                 return rc;
@@ -43,8 +43,13 @@ CCPPDEFINES    += -DCOSIM -DVCS
 CXXDEFINES     += $(CCPPDEFINES)
 CDEFINES       += $(CCPPDEFINES)
 
-CFLAGS         += -std=c99 $(CDEFINES) $(INCLUDES)
-CXXFLAGS       += -std=c++11 -lstdc++ $(CXXDEFINES) $(INCLUDES)
+# Host reference computations (e.g. examples/host_gemm.hpp) rely on the
+# optimizer for vectorization, and are multi-threaded.
+HOST_OPT       ?= -O2
+
+CFLAGS         += -std=c99 $(HOST_OPT) $(CDEFINES) $(INCLUDES)
+CXXFLAGS       += -std=c++11 -lstdc++ $(HOST_OPT) -pthread $(CXXDEFINES) $(INCLUDES)
+LDFLAGS        += -pthread
 
 # HOST_OBJECTS defines the object files that that are linked as part of
 # the kernel. It is derived from HOST_*SOURCES (see below) but other
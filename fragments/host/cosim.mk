@@ -31,6 +31,10 @@
 _REPO_ROOT ?= $(shell git rev-parse --show-toplevel)
 -include $(_REPO_ROOT)/environment.mk
 
+# Native-only builds (see fragments/native.mk) do not use the
+# cosimulation rules, which require Bladerunner.
+ifndef BSG_NATIVE_ONLY
+
 ################################################################################
 # Include the host compilation rules. These define how to generate host object
 # files
@@ -48,10 +52,19 @@ _REPO_ROOT ?= $(shell git rev-parse --show-toplevel)
 ################################################################################
 -include $(FRAGMENTS_PATH)/host/analysis.mk
 
+endif # Matches: ifndef BSG_NATIVE_ONLY
+
 ################################################################################
 # The following rules define how to RUN cosimulation tests:
 ################################################################################
 
+# HOST_ARGS are appended to the host program's command line (see
+# examples/common.h), so that one cosimulation binary can be run at many
+# problem sizes without relinking, e.g.:
+#     make v2 HOST_ARGS="--size 256 --seed 7"
+# Existing logs are not re-run when HOST_ARGS changes; remove them first.
+HOST_ARGS ?=
+
 # This rule defines the `make <version name>` rule (e.g. `make v2`). For all
 # kernel versions defined in $(VERSIONS) you can run `make <version name` and
 # the cosimulation results ($(HOST_TARGET).log
@@ -71,7 +84,7 @@ ALIASES = vanilla_stats.csv vcache_stats.csv
 $(ALIASES): $(HOST_TARGET).log ;
 $(HOST_TARGET).log: kernel.riscv $(HOST_TARGET)
 	./$(HOST_TARGET) +ntb_random_seed_automatic +rad \
-		+c_args="kernel.riscv $(DEFAULT_VERSION)" | tee $@
+		+c_args="kernel.riscv $(DEFAULT_VERSION) $(HOST_ARGS)" | tee $@
 
 ################################################################################
 # Define rules for version-specific cosimulation execution. EXEC_PATH and
@@ -99,7 +112,7 @@ kernel/%/$(HOST_TARGET).log: kernel/%/kernel.riscv $(HOST_TARGET)
 	$(eval _VERSION    := $(notdir $(EXEC_PATH)))
 	cd $(EXEC_PATH) && \
 	$(CURRENT_PATH)/$(HOST_TARGET) +ntb_random_seed_automatic \
-		+c_args="$(KERNEL_PATH)/kernel.riscv $(_VERSION)" | tee $(notdir $@)
+		+c_args="$(KERNEL_PATH)/kernel.riscv $(_VERSION) $(HOST_ARGS)" | tee $(notdir $@)
 
 cosim.clean: host.link.clean host.compile.clean
 	rm -rf *{.daidir,.tmp,.log} 64
@@ -37,6 +37,10 @@ _REPO_ROOT ?= $(shell git rev-parse --show-toplevel)
 
 -include $(_REPO_ROOT)/environment.mk
 
+# Native-only builds (see fragments/native.mk) do not use the RISC-V
+# kernel rules, which require Bladerunner.
+ifndef BSG_NATIVE_ONLY
+
 ################################################################################
 # BSG Manycore Machine Configuration
 ################################################################################
@@ -85,4 +89,6 @@ _KERNEL_COMPILER ?= GCC
 ################################################################################
 -include $(FRAGMENTS_PATH)/kernel/link.mk
 
+endif # Matches: ifndef BSG_NATIVE_ONLY
+
 cudalite.clean: kernel.link.clean kernel.compile.clean
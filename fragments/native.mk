@@ -0,0 +1,148 @@
+# Copyright (c) 2020, University of Washington All rights reserved.
+# 
+# Redistribution and use in source and binary forms, with or without modification,
+# are permitted provided that the following conditions are met:
+# 
+# Redistributions of source code must retain the above copyright notice, this list
+# of conditions and the following disclaimer.
+# 
+# Redistributions in binary form must reproduce the above copyright notice, this
+# list of conditions and the following disclaimer in the documentation and/or
+# other materials provided with the distribution.
+# 
+# Neither the name of the copyright holder nor the names of its contributors may
+# be used to endorse or promote products derived from this software without
+# specific prior written permission.
+# 
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+# ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+# WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+# DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+# ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+# (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+# LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+# ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+# SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+# This fragment builds and runs CUDA-Lite programs natively on x86
+# (see native/README.md). It does not need Bladerunner, the RISC-V
+# toolchain, or VCS: each kernel/<version>/kernel.cpp is compiled to
+# kernel/<version>/kernel.so and the unmodified host program is
+# compiled against the native runtime as $(HOST_TARGET).native.
+#
+# This must be included after HOST_*SOURCES, HOST_TARGET, HOST_INCLUDES,
+# KERNEL_*LIBRARIES, KERNEL_INCLUDES, etc.
+
+################################################################################
+# Paths / Environment Configuration
+################################################################################
+_REPO_ROOT ?= $(shell git rev-parse --show-toplevel)
+
+-include $(_REPO_ROOT)/environment.mk
+
+NATIVE_PATH          := $(_REPO_ROOT)/native
+
+NATIVE_CC            ?= gcc
+NATIVE_CXX           ?= g++
+NATIVE_OPT           ?= -O2 -g
+
+NATIVE_CFLAGS        += -std=gnu99 $(NATIVE_OPT) -fPIC -I$(NATIVE_PATH)/include
+NATIVE_CXXFLAGS      += -std=c++11 $(NATIVE_OPT) -fPIC -I$(NATIVE_PATH)/include
+
+NATIVE_KERNEL_FLAGS  += -DBSG_NATIVE $(KERNEL_INCLUDES)
+# The native runtime implements hb_mc_device_dma_to_{device,host} (see
+# examples/host_transfer.hpp)
+NATIVE_HOST_FLAGS    += -DHOST_TRANSFER_DMA $(HOST_INCLUDES)
+NATIVE_HOST_LDFLAGS  += -rdynamic -pthread -ldl
+
+# Extra host program arguments, e.g. HOST_ARGS="--size 4096" (see
+# examples/common.h and fragments/host/cosim.mk)
+HOST_ARGS            ?=
+
+################################################################################
+# Kernel rules
+################################################################################
+# The kernel is linked with -Bsymbolic so that it never binds to
+# symbols of the same name in the host executable; the only symbols
+# it takes from the host are the runtime hooks in bsg_manycore.h.
+NATIVE_KERNEL_OBJECTS += bsg_tile_config_vars.native.o
+NATIVE_KERNEL_OBJECTS += $(KERNEL_CLIBRARIES:.c=.native.o)
+NATIVE_KERNEL_OBJECTS += $(KERNEL_CXXLIBRARIES:.cpp=.native.o)
+
+NATIVE_KERNEL_HEADERS := $(wildcard $(CURRENT_PATH)/kernel/include/*.h*)
+NATIVE_KERNEL_HEADERS += $(wildcard $(NATIVE_PATH)/include/*.h)
+
+bsg_tile_config_vars.native.o: $(NATIVE_PATH)/bsg_tile_config_vars.c
+	$(NATIVE_CC) $(NATIVE_CFLAGS) -c $< -o $@
+
+%.native.o: %.c
+	$(NATIVE_CC) $(NATIVE_CFLAGS) $(NATIVE_KERNEL_FLAGS) -c $< -o $@
+
+%.native.o: %.cpp
+	$(NATIVE_CXX) $(NATIVE_CXXFLAGS) $(NATIVE_KERNEL_FLAGS) -c $< -o $@
+
+.PRECIOUS: kernel/%/kernel.so
+NATIVE_KERNEL_LINK = $(NATIVE_CXX) $(NATIVE_CXXFLAGS) $(NATIVE_KERNEL_FLAGS) \
+	-shared -Wl,-Bsymbolic $< $(NATIVE_KERNEL_OBJECTS) -o $@
+
+kernel.so: $(KERNEL_DEFAULT) $(NATIVE_KERNEL_OBJECTS) $(NATIVE_KERNEL_HEADERS)
+	$(NATIVE_KERNEL_LINK)
+
+kernel/%/kernel.so: kernel/%/kernel.cpp $(NATIVE_KERNEL_OBJECTS) $(NATIVE_KERNEL_HEADERS)
+	$(NATIVE_KERNEL_LINK)
+
+################################################################################
+# Host rules
+################################################################################
+NATIVE_HOST_SOURCES   := $(HOST_CXXSOURCES) $(HOST_CSOURCES)
+NATIVE_HOST_SOURCES   += $(NATIVE_PATH)/bsg_manycore_native.cpp
+NATIVE_HOST_HEADERS   := $(wildcard $(CURRENT_PATH)/*.h*) $(wildcard $(CURRENT_PATH)/../*.h*)
+NATIVE_HOST_HEADERS   += $(wildcard $(NATIVE_PATH)/include/*.h)
+
+$(HOST_TARGET).native: $(NATIVE_HOST_SOURCES) $(NATIVE_HOST_HEADERS)
+	$(NATIVE_CXX) $(NATIVE_CXXFLAGS) $(NATIVE_HOST_FLAGS) \
+		$(filter %.c %.cpp,$^) -o $@ $(NATIVE_HOST_LDFLAGS)
+
+################################################################################
+# Run rules. These mirror host/cosim.mk: `make native` runs every
+# version in $(VERSIONS) and `make <version>.native` runs one of them,
+# leaving $(HOST_TARGET).native.log and native_stats.csv in
+# kernel/<version>/. A run that fails leaves its output in
+# $(HOST_TARGET).native.log.fail instead, so that it is re-run next
+# time.
+################################################################################
+$(HOST_TARGET).native.log: kernel.so $(HOST_TARGET).native
+	./$(HOST_TARGET).native kernel.so $(DEFAULT_VERSION) $(HOST_ARGS) > $@.fail 2>&1; \
+		rc=$$?; cat $@.fail; [ $$rc -eq 0 ] && mv $@.fail $@
+
+kernel/%/$(HOST_TARGET).native.log: kernel/%/kernel.so $(HOST_TARGET).native
+	$(eval EXEC_PATH   := $(patsubst %/,%,$(dir $@)))
+	$(eval KERNEL_PATH := $(CURRENT_PATH)/$(EXEC_PATH))
+	$(eval _VERSION    := $(notdir $(EXEC_PATH)))
+	cd $(EXEC_PATH) && \
+	$(CURRENT_PATH)/$(HOST_TARGET).native $(KERNEL_PATH)/kernel.so $(_VERSION) $(HOST_ARGS) \
+		> $(notdir $@).fail 2>&1; \
+		rc=$$?; cat $(notdir $@).fail; [ $$rc -eq 0 ] && mv $(notdir $@).fail $(notdir $@)
+
+$(addsuffix .native,$(VERSIONS)): %.native: kernel/%/$(HOST_TARGET).native.log
+
+native: $(foreach v,$(VERSIONS),kernel/$v/$(HOST_TARGET).native.log)
+	@grep -H "BSG REGRESSION TEST" $^
+
+native.clean:
+	rm -rf $(HOST_TARGET).native *.native.o kernel.so
+	rm -rf $(HOST_TARGET).native.log* native_stats.csv
+	rm -rf kernel/*/kernel.so kernel/*/$(HOST_TARGET).native.log* kernel/*/native_stats.csv
+
+.PHONY: native native.clean $(addsuffix .native,$(VERSIONS))
+
+_HELP_STRING := "Rules from native.mk\n"
+_HELP_STRING += "    native: \n"
+_HELP_STRING += "        - Run every kernel version natively on x86 (no cosimulation)\n"
+_HELP_STRING += "    <version>.native | $(HOST_TARGET).native.log : \n"
+_HELP_STRING += "        - Run $(HOST_TARGET) natively on the [<version> | default] kernel\n"
+_HELP_STRING += "\n"
+_HELP_STRING += $(HELP_STRING)
+
+HELP_STRING := $(_HELP_STRING)
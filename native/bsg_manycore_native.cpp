@@ -0,0 +1,806 @@
+// Copyright (c) 2020, University of Washington All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+//
+// Redistributions of source code must retain the above copyright notice, this list
+// of conditions and the following disclaimer.
+//
+// Redistributions in binary form must reproduce the above copyright notice, this
+// list of conditions and the following disclaimer in the documentation and/or
+// other materials provided with the distribution.
+//
+// Neither the name of the copyright holder nor the names of its contributors may
+// be used to endorse or promote products derived from this software without
+// specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+// ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/*
+ * Native (x86) emulation of the HammerBlade Manycore for CUDA-Lite
+ * programs. See README.md in this directory.
+ *
+ * Device DRAM: one anonymous mapping at BSG_NATIVE_DRAM_BASE so a
+ * 32-bit eva_t is a valid host pointer. hb_mc_device_malloc is a
+ * first-fit allocator on top of it.
+ *
+ * Tiles: every tile of a tile group is a pthread. Tile i runs in
+ * its own dlopen()ed copy of kernel.so, so kernel globals and statics
+ * are private to the tile just like DMEM. Tile stacks are allocated
+ * by the runtime so that a pointer into one tile's stack (or image)
+ * can be translated into the same offset in another tile's stack (or
+ * image) by bsg_native_remote_ptr().
+ *
+ * Tile groups run one at a time, in the order they were enqueued
+ * (kernel by kernel, in tile group id order). This is an artifact of
+ * the emulation: see "Kernel ordering" in native/README.md.
+ */
+
+#include <bsg_manycore_cuda.h>
+#include <bsg_manycore_errno.h>
+
+#include <dlfcn.h>
+#include <link.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#define bsg_native_err(fmt, ...)                                        \
+        fprintf(stderr, "BSG NATIVE ERR: %s: " fmt, __func__, ##__VA_ARGS__)
+
+#define BSG_NATIVE_DRAM_BASE       0x80000000UL
+#define BSG_NATIVE_DRAM_SIZE       (1UL << 30)
+#define BSG_NATIVE_DRAM_ALIGN      64
+#define BSG_NATIVE_STACK_SIZE      (16UL << 20)
+#define BSG_NATIVE_MAX_ARGC        16
+#define BSG_NATIVE_STATS_FILE      "native_stats.csv"
+#define BSG_CUDA_PRINT_STAT_KERNEL_TAG 0xFFFFFFFF
+
+typedef int (*kernel_fn_t)(uint64_t, uint64_t, uint64_t, uint64_t,
+                           uint64_t, uint64_t, uint64_t, uint64_t,
+                           uint64_t, uint64_t, uint64_t, uint64_t,
+                           uint64_t, uint64_t, uint64_t, uint64_t);
+
+namespace {
+
+        typedef std::chrono::steady_clock clock_type;
+
+        // One private copy of kernel.so and the stack of the tile
+        // that runs in it.
+        struct tile_image {
+                void *handle;
+                std::string path;
+                uintptr_t data_lo, data_hi;
+                uint8_t *stack;
+                size_t stack_size;
+        };
+
+        struct tile_stat {
+                uint64_t calls = 0;
+                uint64_t ns = 0;
+                uint64_t min_ns = UINT64_MAX;
+                uint64_t max_ns = 0;
+                bool running = false;
+                clock_type::time_point start;
+        };
+
+        struct tile_group;
+
+        struct tile {
+                tile_group *group;
+                tile_image *image;
+                hb_mc_idx_t x, y;
+                kernel_fn_t fn;
+                const uint64_t *argv;
+                size_t shmem_seq;
+                std::map<uint32_t, tile_stat> stats;
+                pthread_t thread;
+        };
+
+        struct tile_group {
+                hb_mc_dimension_t dim;
+                std::vector<tile> tiles;
+
+                std::mutex lock;
+                std::condition_variable cv;
+                size_t arrived = 0;
+                size_t generation = 0;
+
+                std::vector<std::vector<uint8_t> > shmem;
+        };
+
+        struct kernel_launch {
+                hb_mc_dimension_t grid_dim;
+                hb_mc_dimension_t tg_dim;
+                std::string name;
+                std::vector<uint64_t> argv;
+        };
+
+        thread_local tile *current_tile = nullptr;
+        std::mutex print_lock;
+}
+
+struct bsg_native_device {
+        uint8_t *dram;
+        size_t dram_size;
+        std::map<uintptr_t, size_t> free_list;
+        std::map<uintptr_t, size_t> allocated;
+
+        std::string bin_path;
+        std::string image_dir;
+        std::vector<tile_image> images;
+
+        std::vector<kernel_launch> queue;
+        std::map<uint32_t, tile_stat> stats;
+};
+
+extern "C" const char *hb_mc_strerror(int err)
+{
+        switch (err) {
+        case HB_MC_SUCCESS:           return "Success";
+        case HB_MC_FAIL:              return "Failure";
+        case HB_MC_TIMEOUT:           return "Timeout";
+        case HB_MC_UNINITIALIZED:     return "Not initialized";
+        case HB_MC_INVALID:           return "Invalid input";
+        case HB_MC_INITIALIZED_TWICE: return "Initialized twice";
+        case HB_MC_NOMEM:             return "Out of memory";
+        case HB_MC_NOIMPL:            return "Not implemented";
+        case HB_MC_NOTFOUND:          return "Not found";
+        case HB_MC_BUSY:              return "Busy";
+        default:                      return "Unknown error";
+        }
+}
+
+static size_t env_size(const char *name, size_t dflt)
+{
+        const char *v = getenv(name);
+        if (v == nullptr || *v == '\0')
+                return dflt;
+        return strtoull(v, nullptr, 0);
+}
+
+/*
+ * Device DRAM
+ */
+
+static int dram_map(bsg_native_device *nd)
+{
+        size_t size = env_size("BSG_NATIVE_DRAM_SIZE", BSG_NATIVE_DRAM_SIZE);
+        int flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE;
+        void *p = mmap((void *) BSG_NATIVE_DRAM_BASE, size, PROT_READ | PROT_WRITE,
+                       flags | MAP_FIXED_NOREPLACE, -1, 0);
+        if (p == MAP_FAILED)
+                p = mmap(nullptr, size, PROT_READ | PROT_WRITE, flags | MAP_32BIT, -1, 0);
+
+        if (p == MAP_FAILED || (uintptr_t) p + size > (1UL << 32)) {
+                bsg_native_err("failed to map %zu bytes of device DRAM below 4 GB\n", size);
+                if (p != MAP_FAILED)
+                        munmap(p, size);
+                return HB_MC_NOMEM;
+        }
+
+        nd->dram = (uint8_t *) p;
+        nd->dram_size = size;
+        nd->free_list[(uintptr_t) p] = size;
+        return HB_MC_SUCCESS;
+}
+
+static bool dram_contains(bsg_native_device *nd, uintptr_t addr, size_t count)
+{
+        uintptr_t lo = (uintptr_t) nd->dram;
+        return addr >= lo && addr <= lo + nd->dram_size
+                && count <= lo + nd->dram_size - addr;
+}
+
+/*
+ * Kernel images
+ */
+
+static int image_find_data(struct dl_phdr_info *info, size_t, void *arg)
+{
+        tile_image *img = (tile_image *) arg;
+        struct link_map *lm;
+        dlinfo(img->handle, RTLD_DI_LINKMAP, &lm);
+        if (info->dlpi_addr != lm->l_addr)
+                return 0;
+
+        img->data_lo = UINTPTR_MAX;
+        img->data_hi = 0;
+        for (int i = 0; i < info->dlpi_phnum; ++i) {
+                const ElfW(Phdr) *ph = &info->dlpi_phdr[i];
+                if (ph->p_type != PT_LOAD || !(ph->p_flags & PF_W))
+                        continue;
+                uintptr_t lo = info->dlpi_addr + ph->p_vaddr;
+                uintptr_t hi = lo + ph->p_memsz;
+                img->data_lo = lo < img->data_lo ? lo : img->data_lo;
+                img->data_hi = hi > img->data_hi ? hi : img->data_hi;
+        }
+        return 1;
+}
+
+static int copy_file(const std::string &src, const std::string &dst)
+{
+        FILE *in = fopen(src.c_str(), "rb");
+        if (in == nullptr)
+                return HB_MC_NOTFOUND;
+        FILE *out = fopen(dst.c_str(), "wb");
+        if (out == nullptr) {
+                fclose(in);
+                return HB_MC_FAIL;
+        }
+
+        char buf[1 << 16];
+        size_t n;
+        int rc = HB_MC_SUCCESS;
+        while ((n = fread(buf, 1, sizeof(buf), in)) > 0)
+                if (fwrite(buf, 1, n, out) != n)
+                        rc = HB_MC_FAIL;
+
+        fclose(in);
+        if (fclose(out) != 0)
+                rc = HB_MC_FAIL;
+        return rc;
+}
+
+// Make sure there is one image (and stack) for each of the first
+// ntiles tiles.
+static int images_reserve(bsg_native_device *nd, size_t ntiles)
+{
+        size_t stack_size = env_size("BSG_NATIVE_STACK_SIZE", BSG_NATIVE_STACK_SIZE);
+        long page = sysconf(_SC_PAGESIZE);
+
+        while (nd->images.size() < ntiles) {
+                tile_image img;
+                img.path = nd->image_dir + "/tile" + std::to_string(nd->images.size()) + ".so";
+
+                int rc = copy_file(nd->bin_path, img.path);
+                if (rc != HB_MC_SUCCESS) {
+                        bsg_native_err("failed to copy %s to %s\n",
+                                       nd->bin_path.c_str(), img.path.c_str());
+                        return rc;
+                }
+
+                img.handle = dlopen(img.path.c_str(), RTLD_NOW | RTLD_LOCAL);
+                if (img.handle == nullptr) {
+                        bsg_native_err("%s\n", dlerror());
+                        return HB_MC_FAIL;
+                }
+                dl_iterate_phdr(image_find_data, &img);
+
+                img.stack_size = stack_size;
+                img.stack = (uint8_t *) mmap(nullptr, stack_size, PROT_READ | PROT_WRITE,
+                                             MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_STACK,
+                                             -1, 0);
+                if (img.stack == MAP_FAILED) {
+                        bsg_native_err("failed to allocate a %zu byte tile stack\n", stack_size);
+                        dlclose(img.handle);
+                        return HB_MC_NOMEM;
+                }
+                // Guard page
+                mprotect(img.stack, page, PROT_NONE);
+
+                nd->images.push_back(img);
+        }
+        return HB_MC_SUCCESS;
+}
+
+static void image_set(tile_image *img, const char *sym, int value)
+{
+        int *p = (int *) dlsym(img->handle, sym);
+        if (p != nullptr)
+                *p = value;
+}
+
+/*
+ * Host API
+ */
+
+extern "C" int hb_mc_device_init(hb_mc_device_t *device,
+                                 const char *name,
+                                 hb_mc_manycore_id_t id)
+{
+        (void) id;
+        if (device == nullptr)
+                return HB_MC_INVALID;
+
+        bsg_native_device *nd = new bsg_native_device();
+        int rc = dram_map(nd);
+        if (rc != HB_MC_SUCCESS) {
+                delete nd;
+                return rc;
+        }
+
+        device->name = name;
+        device->mesh_dim = { .x = 16, .y = 8 };
+        device->native = nd;
+        return HB_MC_SUCCESS;
+}
+
+extern "C" int hb_mc_device_program_init(hb_mc_device_t *device,
+                                         const char *bin_name,
+                                         const char *alloc_name,
+                                         hb_mc_allocator_id_t id)
+{
+        (void) alloc_name;
+        (void) id;
+        if (device == nullptr || device->native == nullptr)
+                return HB_MC_UNINITIALIZED;
+
+        bsg_native_device *nd = device->native;
+        if (!nd->bin_path.empty())
+                return HB_MC_INITIALIZED_TWICE;
+
+        char dir[] = "/tmp/bsg_native.XXXXXX";
+        if (mkdtemp(dir) == nullptr) {
+                bsg_native_err("mkdtemp: %s\n", strerror(errno));
+                return HB_MC_FAIL;
+        }
+
+        nd->bin_path = bin_name;
+        nd->image_dir = dir;
+        return images_reserve(nd, 1);
+}
+
+extern "C" int hb_mc_device_malloc(hb_mc_device_t *device,
+                                   uint32_t size,
+                                   hb_mc_eva_t *eva)
+{
+        if (device == nullptr || device->native == nullptr)
+                return HB_MC_UNINITIALIZED;
+        if (eva == nullptr || size == 0)
+                return HB_MC_INVALID;
+
+        bsg_native_device *nd = device->native;
+        size_t sz = (size + BSG_NATIVE_DRAM_ALIGN - 1) & ~(size_t) (BSG_NATIVE_DRAM_ALIGN - 1);
+
+        for (auto it = nd->free_list.begin(); it != nd->free_list.end(); ++it) {
+                if (it->second < sz)
+                        continue;
+
+                uintptr_t addr = it->first;
+                size_t left = it->second - sz;
+                nd->free_list.erase(it);
+                if (left)
+                        nd->free_list[addr + sz] = left;
+
+                nd->allocated[addr] = sz;
+                *eva = (hb_mc_eva_t) addr;
+                return HB_MC_SUCCESS;
+        }
+
+        bsg_native_err("out of device memory allocating %u bytes\n", size);
+        return HB_MC_NOMEM;
+}
+
+extern "C" int hb_mc_device_free(hb_mc_device_t *device, hb_mc_eva_t eva)
+{
+        if (device == nullptr || device->native == nullptr)
+                return HB_MC_UNINITIALIZED;
+
+        bsg_native_device *nd = device->native;
+        auto a = nd->allocated.find(eva);
+        if (a == nd->allocated.end()) {
+                bsg_native_err("0x%08x was not allocated\n", eva);
+                return HB_MC_INVALID;
+        }
+
+        uintptr_t addr = a->first;
+        size_t sz = a->second;
+        nd->allocated.erase(a);
+
+        // Coalesce with the neighbouring free blocks
+        auto next = nd->free_list.lower_bound(addr);
+        if (next != nd->free_list.end() && next->first == addr + sz) {
+                sz += next->second;
+                next = nd->free_list.erase(next);
+        }
+        if (next != nd->free_list.begin()) {
+                auto prev = std::prev(next);
+                if (prev->first + prev->second == addr) {
+                        prev->second += sz;
+                        return HB_MC_SUCCESS;
+                }
+        }
+        nd->free_list[addr] = sz;
+        return HB_MC_SUCCESS;
+}
+
+extern "C" int hb_mc_device_memcpy(hb_mc_device_t *device,
+                                   void *dst,
+                                   const void *src,
+                                   uint32_t count,
+                                   enum hb_mc_memcpy_kind kind)
+{
+        if (device == nullptr || device->native == nullptr)
+                return HB_MC_UNINITIALIZED;
+
+        bsg_native_device *nd = device->native;
+        const void *dev = kind == HB_MC_MEMCPY_TO_DEVICE ? dst : src;
+        if (!dram_contains(nd, (uintptr_t) dev, count)) {
+                bsg_native_err("[%p, %p) is not device memory\n",
+                               dev, (const uint8_t *) dev + count);
+                return HB_MC_INVALID;
+        }
+
+        memcpy(dst, src, count);
+        return HB_MC_SUCCESS;
+}
+
+extern "C" int hb_mc_device_memset(hb_mc_device_t *device,
+                                   const hb_mc_eva_t *eva,
+                                   uint8_t data,
+                                   uint32_t sz)
+{
+        if (device == nullptr || device->native == nullptr)
+                return HB_MC_UNINITIALIZED;
+        if (eva == nullptr || !dram_contains(device->native, *eva, sz))
+                return HB_MC_INVALID;
+
+        memset((void *) (uintptr_t) *eva, data, sz);
+        return HB_MC_SUCCESS;
+}
+
+extern "C" int hb_mc_device_dma_to_device(hb_mc_device_t *device,
+                                          const hb_mc_dma_htod_t *jobs,
+                                          size_t count)
+{
+        if (device == nullptr || device->native == nullptr)
+                return HB_MC_UNINITIALIZED;
+
+        // Validate the whole batch before copying anything
+        for (size_t i = 0; i < count; ++i)
+                if (!dram_contains(device->native, jobs[i].d_addr, jobs[i].size))
+                        return HB_MC_INVALID;
+
+        for (size_t i = 0; i < count; ++i)
+                memcpy((void *) (uintptr_t) jobs[i].d_addr, jobs[i].h_addr, jobs[i].size);
+        return HB_MC_SUCCESS;
+}
+
+extern "C" int hb_mc_device_dma_to_host(hb_mc_device_t *device,
+                                        const hb_mc_dma_dtoh_t *jobs,
+                                        size_t count)
+{
+        if (device == nullptr || device->native == nullptr)
+                return HB_MC_UNINITIALIZED;
+
+        for (size_t i = 0; i < count; ++i)
+                if (!dram_contains(device->native, jobs[i].d_addr, jobs[i].size))
+                        return HB_MC_INVALID;
+
+        for (size_t i = 0; i < count; ++i)
+                memcpy(jobs[i].h_addr, (const void *) (uintptr_t) jobs[i].d_addr, jobs[i].size);
+        return HB_MC_SUCCESS;
+}
+
+extern "C" int hb_mc_kernel_enqueue(hb_mc_device_t *device,
+                                    hb_mc_dimension_t grid_dim,
+                                    hb_mc_dimension_t tg_dim,
+                                    const char *name,
+                                    const uint32_t argc,
+                                    const uint32_t *argv)
+{
+        if (device == nullptr || device->native == nullptr)
+                return HB_MC_UNINITIALIZED;
+
+        bsg_native_device *nd = device->native;
+        if (nd->images.empty())
+                return HB_MC_UNINITIALIZED;
+
+        if (grid_dim.x == 0 || grid_dim.y == 0 || tg_dim.x == 0 || tg_dim.y == 0) {
+                bsg_native_err("%s: empty grid or tile group\n", name);
+                return HB_MC_INVALID;
+        }
+
+        if (argc > BSG_NATIVE_MAX_ARGC) {
+                bsg_native_err("%s: %u arguments, at most %d are supported\n",
+                               name, argc, BSG_NATIVE_MAX_ARGC);
+                return HB_MC_INVALID;
+        }
+
+        if (dlsym(nd->images[0].handle, name) == nullptr) {
+                bsg_native_err("kernel %s not found in %s\n", name, nd->bin_path.c_str());
+                return HB_MC_NOTFOUND;
+        }
+
+        kernel_launch k;
+        k.grid_dim = grid_dim;
+        k.tg_dim = tg_dim;
+        k.name = name;
+        k.argv.assign(BSG_NATIVE_MAX_ARGC, 0);
+        for (uint32_t i = 0; i < argc; ++i)
+                k.argv[i] = argv[i];
+
+        nd->queue.push_back(k);
+        return HB_MC_SUCCESS;
+}
+
+static void *tile_main(void *arg)
+{
+        tile *t = (tile *) arg;
+        const uint64_t *a = t->argv;
+        current_tile = t;
+        t->fn(a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7],
+              a[8], a[9], a[10], a[11], a[12], a[13], a[14], a[15]);
+        current_tile = nullptr;
+        return nullptr;
+}
+
+static int tile_group_run(bsg_native_device *nd, const kernel_launch &k,
+                          hb_mc_idx_t tg_x, hb_mc_idx_t tg_y)
+{
+        tile_group tg;
+        tg.dim = k.tg_dim;
+        size_t ntiles = k.tg_dim.x * k.tg_dim.y;
+        tg.tiles.resize(ntiles);
+
+        for (size_t i = 0; i < ntiles; ++i) {
+                tile &t = tg.tiles[i];
+                tile_image *img = &nd->images[i];
+
+                t.group = &tg;
+                t.image = img;
+                t.x = i % k.tg_dim.x;
+                t.y = i / k.tg_dim.x;
+                t.fn = (kernel_fn_t) dlsym(img->handle, k.name.c_str());
+                t.argv = k.argv.data();
+                t.shmem_seq = 0;
+
+                image_set(img, "__bsg_x", t.x);
+                image_set(img, "__bsg_y", t.y);
+                image_set(img, "__bsg_id", i);
+                image_set(img, "__bsg_grp_org_x", 0);
+                image_set(img, "__bsg_grp_org_y", 1);
+                image_set(img, "__bsg_grid_dim_x", k.grid_dim.x);
+                image_set(img, "__bsg_grid_dim_y", k.grid_dim.y);
+                image_set(img, "__bsg_tile_group_id_x", tg_x);
+                image_set(img, "__bsg_tile_group_id_y", tg_y);
+                image_set(img, "__bsg_tile_group_id", tg_y * k.grid_dim.x + tg_x);
+        }
+
+        size_t started = 0;
+        int rc = HB_MC_SUCCESS;
+        for (; started < ntiles; ++started) {
+                tile &t = tg.tiles[started];
+                pthread_attr_t attr;
+                pthread_attr_init(&attr);
+                pthread_attr_setstack(&attr, t.image->stack, t.image->stack_size);
+                int err = pthread_create(&t.thread, &attr, tile_main, &t);
+                pthread_attr_destroy(&attr);
+                if (err != 0) {
+                        bsg_native_err("pthread_create: %s\n", strerror(err));
+                        rc = HB_MC_FAIL;
+                        break;
+                }
+        }
+
+        // A tile group that could not be started completely would
+        // deadlock in its first barrier, so this only happens when
+        // the host is out of threads.
+        for (size_t i = 0; i < started; ++i)
+                pthread_join(tg.tiles[i].thread, nullptr);
+
+        for (tile &t : tg.tiles) {
+                for (auto &s : t.stats) {
+                        tile_stat &d = nd->stats[s.first];
+                        d.calls += s.second.calls;
+                        d.ns += s.second.ns;
+                        d.min_ns = s.second.min_ns < d.min_ns ? s.second.min_ns : d.min_ns;
+                        d.max_ns = s.second.max_ns > d.max_ns ? s.second.max_ns : d.max_ns;
+                }
+        }
+        return rc;
+}
+
+extern "C" int hb_mc_device_tile_groups_execute(hb_mc_device_t *device)
+{
+        if (device == nullptr || device->native == nullptr)
+                return HB_MC_UNINITIALIZED;
+
+        bsg_native_device *nd = device->native;
+        int rc = HB_MC_SUCCESS;
+        for (const kernel_launch &k : nd->queue) {
+                rc = images_reserve(nd, k.tg_dim.x * k.tg_dim.y);
+                if (rc != HB_MC_SUCCESS)
+                        break;
+
+                for (hb_mc_idx_t y = 0; y < k.grid_dim.y && rc == HB_MC_SUCCESS; ++y)
+                        for (hb_mc_idx_t x = 0; x < k.grid_dim.x && rc == HB_MC_SUCCESS; ++x)
+                                rc = tile_group_run(nd, k, x, y);
+                if (rc != HB_MC_SUCCESS)
+                        break;
+        }
+        nd->queue.clear();
+        return rc;
+}
+
+static void stats_write(bsg_native_device *nd)
+{
+        if (nd->stats.empty())
+                return;
+
+        FILE *f = fopen(BSG_NATIVE_STATS_FILE, "w");
+        if (f == nullptr)
+                return;
+
+        fprintf(f, "tag,calls,total_ns,min_ns,max_ns\n");
+        for (auto &s : nd->stats) {
+                if (s.first == BSG_CUDA_PRINT_STAT_KERNEL_TAG)
+                        fprintf(f, "kernel,");
+                else
+                        fprintf(f, "%u,", s.first);
+                fprintf(f, "%lu,%lu,%lu,%lu\n",
+                        (unsigned long) s.second.calls, (unsigned long) s.second.ns,
+                        (unsigned long) s.second.min_ns, (unsigned long) s.second.max_ns);
+        }
+        fclose(f);
+}
+
+extern "C" int hb_mc_device_finish(hb_mc_device_t *device)
+{
+        if (device == nullptr || device->native == nullptr)
+                return HB_MC_UNINITIALIZED;
+
+        bsg_native_device *nd = device->native;
+        stats_write(nd);
+
+        for (tile_image &img : nd->images) {
+                dlclose(img.handle);
+                munmap(img.stack, img.stack_size);
+                unlink(img.path.c_str());
+        }
+        if (!nd->image_dir.empty())
+                rmdir(nd->image_dir.c_str());
+
+        munmap(nd->dram, nd->dram_size);
+        delete nd;
+        device->native = nullptr;
+        return HB_MC_SUCCESS;
+}
+
+/*
+ * Kernel-side hooks. These are called from kernel.so (see
+ * include/bsg_manycore.h) and resolved against the host executable,
+ * which must be linked with -rdynamic.
+ */
+
+static tile *this_tile(const char *fn)
+{
+        if (current_tile == nullptr) {
+                bsg_native_err("%s called outside of a tile\n", fn);
+                abort();
+        }
+        return current_tile;
+}
+
+extern "C" int bsg_printf(const char *fmt, ...)
+{
+        std::lock_guard<std::mutex> guard(print_lock);
+        va_list ap;
+        va_start(ap, fmt);
+        int n = vprintf(fmt, ap);
+        va_end(ap);
+        fflush(stdout);
+        return n;
+}
+
+extern "C" void bsg_native_print_int(int v)
+{
+        tile *t = this_tile(__func__);
+        std::lock_guard<std::mutex> guard(print_lock);
+        printf("BSG INFO: tile (%u,%u): %d\n", t->x, t->y, v);
+        fflush(stdout);
+}
+
+extern "C" void bsg_native_print_hexadecimal(unsigned int v)
+{
+        tile *t = this_tile(__func__);
+        std::lock_guard<std::mutex> guard(print_lock);
+        printf("BSG INFO: tile (%u,%u): 0x%08x\n", t->x, t->y, v);
+        fflush(stdout);
+}
+
+extern "C" void *bsg_native_tile_group_shared_mem(uint32_t size)
+{
+        tile *t = this_tile(__func__);
+        tile_group *tg = t->group;
+        std::lock_guard<std::mutex> guard(tg->lock);
+
+        size_t seq = t->shmem_seq++;
+        if (seq == tg->shmem.size())
+                tg->shmem.emplace_back(size, 0);
+
+        if (tg->shmem[seq].size() != size) {
+                bsg_native_err("tile (%u,%u): shared memory #%zu is %zu bytes here but %u bytes on another tile\n",
+                               t->x, t->y, seq, tg->shmem[seq].size(), size);
+                abort();
+        }
+        return tg->shmem[seq].data();
+}
+
+extern "C" void *bsg_native_remote_ptr(int x, int y, const volatile void *local_addr)
+{
+        tile *t = this_tile(__func__);
+        tile_group *tg = t->group;
+        if (x < 0 || y < 0 || (hb_mc_idx_t) x >= tg->dim.x || (hb_mc_idx_t) y >= tg->dim.y) {
+                bsg_native_err("tile (%u,%u): remote tile (%d,%d) is outside of the tile group\n",
+                               t->x, t->y, x, y);
+                abort();
+        }
+
+        tile_image *src = t->image;
+        tile_image *dst = tg->tiles[y * tg->dim.x + x].image;
+        uintptr_t a = (uintptr_t) local_addr;
+
+        if (a >= src->data_lo && a < src->data_hi)
+                return (void *) (a - src->data_lo + dst->data_lo);
+
+        uintptr_t stack = (uintptr_t) src->stack;
+        if (a >= stack && a < stack + src->stack_size)
+                return (void *) (a - stack + (uintptr_t) dst->stack);
+
+        // DRAM (and anything else) is global
+        return (void *) local_addr;
+}
+
+extern "C" void bsg_native_tile_group_barrier(void)
+{
+        tile *t = this_tile(__func__);
+        tile_group *tg = t->group;
+        std::unique_lock<std::mutex> guard(tg->lock);
+
+        size_t gen = tg->generation;
+        if (++tg->arrived == tg->tiles.size()) {
+                tg->arrived = 0;
+                tg->generation++;
+                tg->cv.notify_all();
+                return;
+        }
+        tg->cv.wait(guard, [tg, gen] { return tg->generation != gen; });
+}
+
+extern "C" void bsg_native_print_stat_start(uint32_t tag)
+{
+        tile *t = this_tile(__func__);
+        tile_stat &s = t->stats[tag];
+        s.running = true;
+        s.start = clock_type::now();
+}
+
+extern "C" void bsg_native_print_stat_end(uint32_t tag)
+{
+        clock_type::time_point now = clock_type::now();
+        tile *t = this_tile(__func__);
+        tile_stat &s = t->stats[tag];
+        if (!s.running)
+                return;
+
+        uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(now - s.start).count();
+        s.running = false;
+        s.calls++;
+        s.ns += ns;
+        s.min_ns = ns < s.min_ns ? ns : s.min_ns;
+        s.max_ns = ns > s.max_ns ? ns : s.max_ns;
+}
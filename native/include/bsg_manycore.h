@@ -0,0 +1,105 @@
+// Copyright (c) 2020, University of Washington All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+//
+// Redistributions of source code must retain the above copyright notice, this list
+// of conditions and the following disclaimer.
+//
+// Redistributions in binary form must reproduce the above copyright notice, this
+// list of conditions and the following disclaimer in the documentation and/or
+// other materials provided with the distribution.
+//
+// Neither the name of the copyright holder nor the names of its contributors may
+// be used to endorse or promote products derived from this software without
+// specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+// ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/*
+ * Native (x86) stand-in for the kernel-side bsg_manycore.h. Tile
+ * coordinates are per-image globals (see bsg_tile_config_vars.c) that
+ * the native runtime sets before each tile group launches, exactly as
+ * bsg_set_tile_x_y() does on the manycore. Everything that needs the
+ * runtime (printing, shared memory, remote pointers, statistics) is a
+ * call into the host executable.
+ */
+#ifndef __BSG_MANYCORE_H
+#define __BSG_MANYCORE_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern int __bsg_x;
+extern int __bsg_y;
+extern int __bsg_id;
+extern int __bsg_grp_org_x;
+extern int __bsg_grp_org_y;
+extern int __bsg_grid_dim_x;
+extern int __bsg_grid_dim_y;
+extern int __bsg_tile_group_id_x;
+extern int __bsg_tile_group_id_y;
+extern int __bsg_tile_group_id;
+
+int bsg_printf(const char *fmt, ...);
+
+void bsg_native_print_int(int v);
+void bsg_native_print_hexadecimal(unsigned int v);
+void *bsg_native_tile_group_shared_mem(uint32_t size);
+void *bsg_native_remote_ptr(int x, int y, const volatile void *local_addr);
+void bsg_native_tile_group_barrier(void);
+void bsg_native_print_stat_start(uint32_t tag);
+void bsg_native_print_stat_end(uint32_t tag);
+
+#ifdef __cplusplus
+}
+#endif
+
+#define bsg_x __bsg_x
+#define bsg_y __bsg_y
+#define bsg_id __bsg_id
+
+#define bsg_print_int(x) bsg_native_print_int((int)(x))
+#define bsg_print_hexadecimal(x) bsg_native_print_hexadecimal((unsigned int)(x))
+
+// Remote pointers are ordinary host pointers into the other tile's
+// image or stack.
+#define bsg_remote_ptr(x, y, local_addr)                                \
+        ((int *) bsg_native_remote_ptr((x), (y), (local_addr)))
+#define bsg_tile_group_remote_ptr(type, x, y, local_addr)               \
+        ((type *) bsg_native_remote_ptr((x), (y), (local_addr)))
+
+// Remote stores are ordinary host stores, which x86 keeps in order, so
+// a fence only has to stop the compiler from reordering them.
+#define bsg_fence() asm volatile ("" ::: "memory")
+
+// Tile group shared memory is one buffer per declaration, shared by
+// every tile in the group and matched up by declaration order.
+#define bsg_tile_group_shared_mem(type, lc_addr, size)                  \
+        type *lc_addr = (type *) bsg_native_tile_group_shared_mem(sizeof(type) * (size))
+#define bsg_tile_group_shared_load(type, lc_addr, offset, res)          \
+        do { (res) = (lc_addr)[(offset)]; } while (0)
+#define bsg_tile_group_shared_store(type, lc_addr, offset, val)         \
+        do { (lc_addr)[(offset)] = (val); } while (0)
+
+// The stat tags are timed with the host clock and written to
+// native_stats.csv when the device is finished.
+#define BSG_CUDA_PRINT_STAT_KERNEL_TAG 0xFFFFFFFF
+#define bsg_cuda_print_stat_kernel_start() bsg_native_print_stat_start(BSG_CUDA_PRINT_STAT_KERNEL_TAG)
+#define bsg_cuda_print_stat_kernel_end() bsg_native_print_stat_end(BSG_CUDA_PRINT_STAT_KERNEL_TAG)
+#define bsg_cuda_print_stat_start(tag) bsg_native_print_stat_start(tag)
+#define bsg_cuda_print_stat_end(tag) bsg_native_print_stat_end(tag)
+
+#endif // __BSG_MANYCORE_H
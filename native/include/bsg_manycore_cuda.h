@@ -0,0 +1,135 @@
+// Copyright (c) 2020, University of Washington All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+//
+// Redistributions of source code must retain the above copyright notice, this list
+// of conditions and the following disclaimer.
+//
+// Redistributions in binary form must reproduce the above copyright notice, this
+// list of conditions and the following disclaimer in the documentation and/or
+// other materials provided with the distribution.
+//
+// Neither the name of the copyright holder nor the names of its contributors may
+// be used to endorse or promote products derived from this software without
+// specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+// ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/*
+ * Native (x86) implementation of the CUDA-Lite host API.
+ *
+ * Device DRAM is a host mapping placed below 4 GB so that a 32-bit
+ * eva_t is also a valid host pointer. Kernels are shared objects
+ * (kernel.so) compiled from the unmodified kernel sources; each tile
+ * of a tile group runs as a host thread with a private copy of the
+ * kernel image, so globals and statics behave like tile DMEM.
+ *
+ * Only the subset of the API used by the examples is provided.
+ */
+#ifndef __BSG_MANYCORE_CUDA_H
+#define __BSG_MANYCORE_CUDA_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <bsg_manycore_errno.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef uint32_t hb_mc_eva_t;
+typedef hb_mc_eva_t eva_t;
+typedef uint32_t hb_mc_idx_t;
+typedef uint8_t hb_mc_manycore_id_t;
+typedef uint32_t hb_mc_allocator_id_t;
+
+typedef struct {
+        hb_mc_idx_t x;
+        hb_mc_idx_t y;
+} hb_mc_dimension_t;
+
+enum hb_mc_memcpy_kind {
+        HB_MC_MEMCPY_TO_DEVICE = 0,
+        HB_MC_MEMCPY_TO_HOST = 1,
+};
+
+/* A host-to-device DMA job: copy size bytes from h_addr to d_addr */
+typedef struct {
+        hb_mc_eva_t d_addr;
+        const void *h_addr;
+        size_t size;
+} hb_mc_dma_htod_t;
+
+/* A device-to-host DMA job: copy size bytes from d_addr to h_addr */
+typedef struct {
+        hb_mc_eva_t d_addr;
+        void *h_addr;
+        size_t size;
+} hb_mc_dma_dtoh_t;
+
+typedef struct {
+        const char *name;
+        hb_mc_dimension_t mesh_dim;
+        struct bsg_native_device *native;
+} hb_mc_device_t;
+
+int hb_mc_device_init(hb_mc_device_t *device,
+                      const char *name,
+                      hb_mc_manycore_id_t id);
+
+int hb_mc_device_program_init(hb_mc_device_t *device,
+                              const char *bin_name,
+                              const char *alloc_name,
+                              hb_mc_allocator_id_t id);
+
+int hb_mc_device_malloc(hb_mc_device_t *device,
+                        uint32_t size,
+                        hb_mc_eva_t *eva);
+
+int hb_mc_device_free(hb_mc_device_t *device, hb_mc_eva_t eva);
+
+int hb_mc_device_memcpy(hb_mc_device_t *device,
+                        void *dst,
+                        const void *src,
+                        uint32_t count,
+                        enum hb_mc_memcpy_kind kind);
+
+int hb_mc_device_memset(hb_mc_device_t *device,
+                        const hb_mc_eva_t *eva,
+                        uint8_t data,
+                        uint32_t sz);
+
+int hb_mc_device_dma_to_device(hb_mc_device_t *device,
+                               const hb_mc_dma_htod_t *jobs,
+                               size_t count);
+
+int hb_mc_device_dma_to_host(hb_mc_device_t *device,
+                             const hb_mc_dma_dtoh_t *jobs,
+                             size_t count);
+
+int hb_mc_kernel_enqueue(hb_mc_device_t *device,
+                         hb_mc_dimension_t grid_dim,
+                         hb_mc_dimension_t tg_dim,
+                         const char *name,
+                         const uint32_t argc,
+                         const uint32_t *argv);
+
+int hb_mc_device_tile_groups_execute(hb_mc_device_t *device);
+
+int hb_mc_device_finish(hb_mc_device_t *device);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __BSG_MANYCORE_CUDA_H
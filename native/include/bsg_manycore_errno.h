@@ -0,0 +1,57 @@
+// Copyright (c) 2020, University of Washington All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+//
+// Redistributions of source code must retain the above copyright notice, this list
+// of conditions and the following disclaimer.
+//
+// Redistributions in binary form must reproduce the above copyright notice, this
+// list of conditions and the following disclaimer in the documentation and/or
+// other materials provided with the distribution.
+//
+// Neither the name of the copyright holder nor the names of its contributors may
+// be used to endorse or promote products derived from this software without
+// specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+// ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/*
+ * Native (x86) stand-in for the BSG Replicant error codes. The values
+ * match bsg_manycore_errno.h in BSG Replicant so host programs can be
+ * compiled against either header without modification.
+ */
+#ifndef __BSG_MANYCORE_ERRNO_H
+#define __BSG_MANYCORE_ERRNO_H
+
+#define HB_MC_SUCCESS           (0)
+#define HB_MC_FAIL              (-1)
+#define HB_MC_TIMEOUT           (-2)
+#define HB_MC_UNINITIALIZED     (-3)
+#define HB_MC_INVALID           (-4)
+#define HB_MC_INITIALIZED_TWICE (-5)
+#define HB_MC_NOMEM             (-6)
+#define HB_MC_NOIMPL            (-7)
+#define HB_MC_NOTFOUND          (-8)
+#define HB_MC_BUSY              (-9)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+const char *hb_mc_strerror(int err);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __BSG_MANYCORE_ERRNO_H
@@ -0,0 +1,59 @@
+// Copyright (c) 2020, University of Washington All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+//
+// Redistributions of source code must retain the above copyright notice, this list
+// of conditions and the following disclaimer.
+//
+// Redistributions in binary form must reproduce the above copyright notice, this
+// list of conditions and the following disclaimer in the documentation and/or
+// other materials provided with the distribution.
+//
+// Neither the name of the copyright holder nor the names of its contributors may
+// be used to endorse or promote products derived from this software without
+// specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+// ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/*
+ * Native (x86) stand-in for bsg_tile_group_barrier.h. The row/column
+ * barrier objects are kept so kernels compile unmodified, but the
+ * native barrier always spans every tile launched in the tile group.
+ */
+#ifndef __BSG_TILE_GROUP_BARRIER_H
+#define __BSG_TILE_GROUP_BARRIER_H
+
+#include <bsg_manycore.h>
+
+typedef struct _bsg_row_barrier_ {
+        unsigned char _x_cord_start;
+        unsigned char _x_cord_end;
+} bsg_row_barrier;
+
+typedef struct _bsg_col_barrier_ {
+        unsigned char _y_cord_start;
+        unsigned char _y_cord_end;
+} bsg_col_barrier;
+
+#define INIT_TILE_GROUP_BARRIER(ROW_BARRIER_NAME, COL_BARRIER_NAME, x_cord_start, x_cord_end, y_cord_start, y_cord_end) \
+        bsg_row_barrier ROW_BARRIER_NAME = { (x_cord_start), (x_cord_end) }; \
+        bsg_col_barrier COL_BARRIER_NAME = { (y_cord_start), (y_cord_end) }
+
+static inline void bsg_tile_group_barrier(bsg_row_barrier *p_row_b, bsg_col_barrier *p_col_b)
+{
+        (void) p_row_b;
+        (void) p_col_b;
+        bsg_native_tile_group_barrier();
+}
+
+#endif // __BSG_TILE_GROUP_BARRIER_H